@@ -6,6 +6,12 @@
 #include "src/views/common/ExampleUsageWidget.h"
 #include "src/views/common/UIStyleManager.h"
 #include "src/core/DatabaseManager.h"
+#include "src/core/AsyncDatabaseManager.h"
+#include "src/core/ChatChangeNotifier.h"
+#include "src/core/ChatArchiver.h"
+#include "src/core/RetentionManager.h"
+#include "src/core/BackupManager.h"
+#include "src/core/AnswerCache.h"
 #include "src/views/common/LoginDialog.h"
 #include <QApplication>
 #include <QStyleFactory>
@@ -110,6 +116,24 @@ int main(int argc, char *argv[])
     }
     
     qDebug() << "数据库初始化成功";
+
+    // 启动数据库工作线程，界面侧的查询都投递到该线程执行
+    AsyncDatabaseManager::instance()->start();
+
+    // 接入本机实例间的聊天变更通知总线，替代各聊天窗口的定时轮询
+    ChatChangeNotifier::instance()->start();
+
+    // 定期把结束已久的会话移到归档库，保持热表精简
+    ChatArchiver::instance()->startSchedule();
+
+    // 后台分块清除已删除的消息和超出保留期的记录
+    RetentionManager::instance()->start();
+
+    // 按设置的间隔在后台生成各数据库的一致快照
+    BackupManager::instance()->startSchedule();
+
+    // 载入常见问题的缓存回答，重复提问不再请求远程模型
+    AnswerCache::instance()->load();
     
     // 显示登录对话框
     LoginDialog loginDialog;
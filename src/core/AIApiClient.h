@@ -9,18 +9,22 @@
 #include <QJsonArray>
 #include <QString>
 #include <QTimer>
+#include <QHash>
+#include <QList>
+#include <QElapsedTimer>
 
 // AI诊断结果结构
 struct AIAnalysisResult {
     QString qualityAnalysis;      // 品质分析
     QString recommendedDepartment; // 推荐部门
-    QString fitnessLevel;       // 合适程度 (low/medium/high/critical)
+    QString fitnessLevel;       // 合适程度 (low/medium/high/critical)，回答中没有评价时为空
     QStringList possibleCauses;   // 可能原因 //对于建议你去的部门
     QStringList suggestions;      // 未来工作建议
     bool needsHumanConsult;       // 是否需要人工咨询
     QString aiResponse;           // AI完整回复
     bool containsImage = false;   // 新增：是否包含图片
     QString imageUrl;             // 新增：图片URL
+    int requestId = 0;            // 对应的请求ID，由 send* 返回
 };
 
 class AIApiClient : public QObject
@@ -31,14 +35,35 @@ public:
     explicit AIApiClient(QObject *parent = nullptr);
     ~AIApiClient();
 
-    // 发送智能HR请求
-    void sendChatRequest(const QString& userInput, const QString& conversationHistory = "");
+    // 以下请求均返回请求ID，响应与错误信号通过该ID对应到请求；
+    // 同时进行的请求数超过上限时进入队列，按提交顺序发出
+
+    // 发送智能HR请求，常见问题命中回答缓存（AnswerCache）时不访问网络
+    int sendChatRequest(const QString& userInput, const QString& conversationHistory = "");
 
     // 发送品质分析请求
-    void sendQualityAnalysis(const QString& qualities, int age = 0, const QString& gender = "");
+    int sendQualityAnalysis(const QString& qualities, int age = 0, const QString& gender = "");
 
     // 发送部门推荐请求
-    void sendDepartmentRecommendation(const QString& qualities, const QString& analysis = "");
+    int sendDepartmentRecommendation(const QString& qualities, const QString& analysis = "");
+
+    // 把 conversation 中的对话并入 previousSummary，结果通过 summaryReceived 返回
+    int sendSummaryRequest(const QString& previousSummary, const QString& conversation);
+
+    // 取消排队中或进行中的请求，之后只会收到 requestCancelled；ID 不存在时返回 false
+    bool cancelRequest(int requestId);
+    void cancelAllRequests();
+    bool isRequestPending(int requestId) const;
+
+    // 并发上限（至少为 1），调高后立即从队列补发
+    void setMaxConcurrentRequests(int count);
+    int maxConcurrentRequests() const;
+    int activeRequestCount() const;
+    int queuedRequestCount() const;
+
+    // 智能HR请求是否以 SSE 流式返回（默认开启），生成过程中逐段发出 chatChunkReceived
+    void setStreamingEnabled(bool enabled);
+    bool isStreamingEnabled() const;
 
     // 设置API配置
     void setApiConfig(const QString& baseUrl, const QString& apiKey, const QString& model);
@@ -53,29 +78,67 @@ public:
     void checkAndSendImage(const QString& userInput);
 
 signals:
-    // AI响应信号
+    // AI响应信号，result.requestId 为对应的请求ID
     void chatResponseReceived(const AIAnalysisResult& result);
     void qualityAnalysisReceived(const AIAnalysisResult& result);
     void departmentRecommendationReceived(const AIAnalysisResult& result);
+    // 流式请求收到的增量文本，结束时仍会发出 chatResponseReceived（完整内容）
+    void chatChunkReceived(int requestId, const QString& delta);
+    void summaryReceived(int requestId, const QString& summary);
 
     // 错误和状态信号
-    void apiError(const QString& error);
+    void apiError(int requestId, const QString& error);
     void connectionStatusChanged(bool connected);
-    void requestStarted();
-    void requestFinished();
+    void requestStarted(int requestId);    // 请求真正发出（离开队列）时
+    void requestFinished(int requestId);   // 成功或失败结束时，取消的请求不发送
+    void requestCancelled(int requestId);
     void imageResponseReceived(const QString& imageUrl);
 
 private slots:
-    void handleChatResponse();
-    void handleQualityResponse();
-    void handleDepartmentResponse();
-    void handleNetworkError(QNetworkReply::NetworkError error);
     void handleSslErrors(const QList<QSslError>& errors);
 
 private:
+    // 请求类型枚举
+    enum RequestType {
+        ChatRequest,
+        QualityRequest,
+        DepartmentRequest,
+        SummaryRequest
+    };
+
+    // 排队中的请求
+    struct QueuedRequest {
+        int id;
+        RequestType type;
+        QByteArray body;
+        bool streaming;
+        QString cacheQuestion;      // 非空时成功的回答写入回答缓存
+    };
+
+    // 进行中的请求，按 reply 索引
+    struct ActiveRequest {
+        int id;
+        RequestType type;
+        QTimer* timeoutTimer;  // 以 reply 为父对象，随 reply 一起释放
+        bool timedOut;
+        bool cancelled;
+        bool streaming;
+        QString cacheQuestion;
+        QByteArray streamBuffer;    // 尚未凑成完整行的 SSE 数据
+        QByteArray rawBody;         // 服务端未按 SSE 返回时按普通 JSON 解析
+        QString streamedContent;    // 已收到的增量文本
+        bool sawStreamEvent;
+        QElapsedTimer elapsed;      // 用于记录首个分片的延迟
+    };
+
     // 网络管理
     QNetworkAccessManager* m_networkManager;
-    QNetworkReply* m_currentReply;
+    QHash<QNetworkReply*, ActiveRequest> m_activeRequests;
+    QList<QueuedRequest> m_queuedRequests;
+    QHash<int, QString> m_cachedAnswers;  // 命中回答缓存、等待排队发送的请求
+    int m_nextRequestId;
+    int m_maxConcurrentRequests;
+    bool m_streamingEnabled;
 
     // API配置
     QString m_baseUrl;
@@ -85,25 +148,29 @@ private:
     // 状态管理
     bool m_isConnected;
     QString m_lastError;
-    QTimer* m_timeoutTimer;
-
-    // 请求类型枚举
-    enum RequestType {
-        ChatRequest,
-        QualityRequest,
-        DepartmentRequest
-    };
-    RequestType m_currentRequestType;
 
     // 私有方法
-    QNetworkRequest createApiRequest();
-    QJsonObject createRequestBody(const QString& systemPrompt, const QString& userMessage);
-    AIAnalysisResult parseApiResponse(const QJsonDocument& response);
+    int enqueueRequest(RequestType type, const QJsonObject& requestBody, bool streaming = false,
+                       const QString& cacheQuestion = QString());
+    void deliverCachedAnswer(int requestId);
+    void dispatchQueuedRequests();
+    void startRequest(const QueuedRequest& queued);
+    void handleReplyFinished(QNetworkReply* reply);
+    void handleStreamData(QNetworkReply* reply);
+    QStringList processStreamLines(ActiveRequest& active, bool flush);
+    QString describeReplyError(QNetworkReply* reply, RequestType type) const;
+    QNetworkReply* findReply(int requestId) const;
+    QNetworkRequest createApiRequest(bool streaming = false);
+    QJsonObject createRequestBody(const QString& systemPrompt, const QString& userMessage,
+                                  bool streaming = false);
+    QString extractMessageContent(const QJsonDocument& response);
+    AIAnalysisResult resultFromContent(const QString& content);
     void parseAIResponseContent(AIAnalysisResult& result);
     void setupDefaultConfig();
     QString createChatPrompt(const QString& userInput, const QString& history);
     QString createQualityPrompt(const QString& qualities, int age, const QString& gender);
     QString createDepartmentPrompt(const QString& qualities, const QString& analysis);
+    QString createSummaryPrompt(const QString& previousSummary);
 };
 
 #endif // AIAPICLIENT_H
@@ -0,0 +1,293 @@
+#include "AnswerCache.h"
+#include "AsyncDatabaseManager.h"
+#include "StorageManager.h"
+#include "EpochTime.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QSettings>
+#include <QList>
+#include <QDebug>
+
+namespace {
+const int DEFAULT_TTL_HOURS = 7 * 24;
+const int DEFAULT_MAX_ENTRIES = 500;
+// 规范化后超过这个长度的问题不缓存
+const int MAX_QUESTION_LENGTH = 48;
+// 出现这些词的问题指向访客本人或上文（"我适合哪个部门"、"那需要多久"），回答因人而异
+const QStringList CONTEXT_MARKERS = {
+    "我", "俺", "咱", "你刚", "你说", "那", "这", "它", "他", "她", "上面", "刚才", "之前", "前面", "上述", "还有", "呢"
+};
+}
+
+AnswerCache* AnswerCache::m_instance = nullptr;
+
+AnswerCache* AnswerCache::instance()
+{
+    if (!m_instance) {
+        m_instance = new AnswerCache;
+    }
+    return m_instance;
+}
+
+AnswerCache::AnswerCache(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<AnswerCacheStats>();
+
+    // 查找在每次提问时执行，设置只在启动和修改时读写 storage.ini
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    m_enabled = settings.value("answerCache/enabled", true).toBool();
+    m_ttlHours = qMax(1, settings.value("answerCache/ttlHours", DEFAULT_TTL_HOURS).toInt());
+    m_entries.setMaxCost(qMax(1, settings.value("answerCache/maxEntries", DEFAULT_MAX_ENTRIES).toInt()));
+}
+
+QString AnswerCache::normalizeQuestion(const QString& question)
+{
+    // NFKC 把全角字母、数字、标点和全角空格折叠为半角，再统一大小写
+    const QString folded = question.normalized(QString::NormalizationForm_KC).toCaseFolded();
+
+    QString normalized;
+    normalized.reserve(folded.size());
+    for (char32_t ch : folded.toUcs4()) {
+        if (QChar::isSpace(ch) || QChar::isPunct(ch) || QChar::isSymbol(ch)) {
+            continue;
+        }
+        normalized += QString::fromUcs4(&ch, 1);
+    }
+    return normalized;
+}
+
+bool AnswerCache::isCacheableQuestion(const QString& question)
+{
+    const int length = normalizeQuestion(question).size();
+    return length > 0 && length <= MAX_QUESTION_LENGTH;
+}
+
+bool AnswerCache::isStandaloneQuestion(const QString& question)
+{
+    const QString normalized = normalizeQuestion(question);
+    for (const QString& marker : CONTEXT_MARKERS) {
+        if (normalized.contains(marker)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AnswerCache::isEnabled() const
+{
+    return m_enabled;
+}
+
+void AnswerCache::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    settings.setValue("answerCache/enabled", enabled);
+}
+
+int AnswerCache::ttlHours() const
+{
+    return m_ttlHours;
+}
+
+void AnswerCache::setTtlHours(int hours)
+{
+    m_ttlHours = qMax(1, hours);
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    settings.setValue("answerCache/ttlHours", m_ttlHours);
+}
+
+int AnswerCache::maxEntries() const
+{
+    return static_cast<int>(m_entries.maxCost());
+}
+
+void AnswerCache::setMaxEntries(int count)
+{
+    // 调小时 QCache 立即挤出最久未用的条目，磁盘上的在下次写入时一并清理
+    m_entries.setMaxCost(qMax(1, count));
+    m_stats.entries = static_cast<int>(m_entries.size());
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    settings.setValue("answerCache/maxEntries", maxEntries());
+}
+
+qint64 AnswerCache::ttlMs() const
+{
+    return static_cast<qint64>(m_ttlHours) * 60 * 60 * 1000;
+}
+
+QString AnswerCache::cacheKey(const QString& model, int promptVersion, const QString& questionKey)
+{
+    return model + QChar(0x1f) + QString::number(promptVersion) + QChar(0x1f) + questionKey;
+}
+
+void AnswerCache::insertEntry(Entry* entry)
+{
+    const QString key = cacheKey(entry->model, entry->promptVersion, entry->questionKey);
+    if (!m_entries.contains(key) && m_entries.size() >= m_entries.maxCost()) {
+        m_stats.evictions++;
+    }
+    m_entries.insert(key, entry);
+    m_stats.entries = static_cast<int>(m_entries.size());
+}
+
+void AnswerCache::load()
+{
+    const qint64 cutoff = EpochTime::nowMs() - ttlMs();
+    const int limit = maxEntries();
+
+    AsyncDatabaseManager::instance()->post(this, [cutoff, limit]() {
+        QList<Entry> entries;
+        QSqlDatabase db = StorageManager::instance()->connection(StorageManager::AIChatStore);
+        QSqlQuery query(db);
+        query.prepare("SELECT model, prompt_version, question_key, question, answer, "
+                      "created_at, last_hit_at, hit_count FROM ai_answer_cache "
+                      "WHERE created_at >= ? ORDER BY last_hit_at DESC LIMIT ?");
+        query.addBindValue(cutoff);
+        query.addBindValue(limit);
+        if (!query.exec()) {
+            qWarning() << "AnswerCache: 载入失败:" << query.lastError().text();
+            return entries;
+        }
+        while (query.next()) {
+            Entry entry;
+            entry.model = query.value(0).toString();
+            entry.promptVersion = query.value(1).toInt();
+            entry.questionKey = query.value(2).toString();
+            entry.question = query.value(3).toString();
+            entry.answer = query.value(4).toString();
+            entry.createdAt = query.value(5).toLongLong();
+            entry.lastHitAt = query.value(6).toLongLong();
+            entry.hitCount = query.value(7).toInt();
+            entries.append(entry);
+        }
+        return entries;
+    }, [this](const QList<Entry>& entries) {
+        // 从最久未用的开始插入，最近命中的排在 LRU 前端；载入前已写入的新条目不覆盖
+        for (auto it = entries.crbegin(); it != entries.crend(); ++it) {
+            if (!m_entries.contains(cacheKey(it->model, it->promptVersion, it->questionKey))) {
+                insertEntry(new Entry(*it));
+            }
+        }
+        qDebug() << "AnswerCache: 已载入" << entries.size() << "条缓存回答";
+        emit statsChanged(m_stats);
+    });
+}
+
+bool AnswerCache::lookup(const QString& model, int promptVersion, const QString& question, QString* answer)
+{
+    if (!m_enabled || !isCacheableQuestion(question)) {
+        return false;
+    }
+
+    const QString questionKey = normalizeQuestion(question);
+    const QString key = cacheKey(model, promptVersion, questionKey);
+    const qint64 now = EpochTime::nowMs();
+
+    Entry* entry = m_entries.object(key);
+    if (entry && now - entry->createdAt > ttlMs()) {
+        m_entries.remove(key);
+        m_stats.expired++;
+        m_stats.entries = static_cast<int>(m_entries.size());
+        entry = nullptr;
+    }
+    if (!entry) {
+        m_stats.misses++;
+        emit statsChanged(m_stats);
+        return false;
+    }
+
+    entry->lastHitAt = now;
+    entry->hitCount++;
+    *answer = entry->answer;
+    m_stats.hits++;
+    emit statsChanged(m_stats);
+
+    AsyncDatabaseManager::instance()->post([model, promptVersion, questionKey, now]() {
+        QSqlDatabase db = StorageManager::instance()->connection(StorageManager::AIChatStore);
+        QSqlQuery query(db);
+        query.prepare("UPDATE ai_answer_cache SET last_hit_at = ?, hit_count = hit_count + 1 "
+                      "WHERE model = ? AND prompt_version = ? AND question_key = ?");
+        query.addBindValue(now);
+        query.addBindValue(model);
+        query.addBindValue(promptVersion);
+        query.addBindValue(questionKey);
+        if (!query.exec()) {
+            qWarning() << "AnswerCache: 更新命中时间失败:" << query.lastError().text();
+        }
+    });
+    return true;
+}
+
+void AnswerCache::store(const QString& model, int promptVersion, const QString& question, const QString& answer)
+{
+    if (!m_enabled || answer.isEmpty() || !isCacheableQuestion(question)) {
+        return;
+    }
+
+    Entry* entry = new Entry;
+    entry->model = model;
+    entry->promptVersion = promptVersion;
+    entry->questionKey = normalizeQuestion(question);
+    entry->question = question;
+    entry->answer = answer;
+    entry->createdAt = EpochTime::nowMs();
+    entry->lastHitAt = entry->createdAt;
+    const Entry row = *entry;
+    insertEntry(entry);
+    m_stats.stores++;
+    emit statsChanged(m_stats);
+
+    const qint64 cutoff = row.createdAt - ttlMs();
+    const int limit = maxEntries();
+    AsyncDatabaseManager::instance()->post([row, cutoff, limit]() {
+        QSqlDatabase db = StorageManager::instance()->connection(StorageManager::AIChatStore);
+        QSqlQuery query(db);
+        query.prepare("INSERT OR REPLACE INTO ai_answer_cache "
+                      "(model, prompt_version, question_key, question, answer, created_at, last_hit_at, hit_count) "
+                      "VALUES (?, ?, ?, ?, ?, ?, ?, 0)");
+        query.addBindValue(row.model);
+        query.addBindValue(row.promptVersion);
+        query.addBindValue(row.questionKey);
+        query.addBindValue(row.question);
+        query.addBindValue(row.answer);
+        query.addBindValue(row.createdAt);
+        query.addBindValue(row.lastHitAt);
+        if (!query.exec()) {
+            qWarning() << "AnswerCache: 写入失败:" << query.lastError().text();
+            return;
+        }
+
+        // 磁盘上同样只保留有效期内、最近使用的 limit 条
+        query.prepare("DELETE FROM ai_answer_cache WHERE created_at < ?");
+        query.addBindValue(cutoff);
+        query.exec();
+        query.prepare("DELETE FROM ai_answer_cache WHERE last_hit_at < "
+                      "(SELECT last_hit_at FROM ai_answer_cache ORDER BY last_hit_at DESC LIMIT 1 OFFSET ?)");
+        query.addBindValue(limit - 1);
+        if (!query.exec()) {
+            qWarning() << "AnswerCache: 清理旧条目失败:" << query.lastError().text();
+        }
+    });
+}
+
+void AnswerCache::clear()
+{
+    m_entries.clear();
+    m_stats = AnswerCacheStats();
+    emit statsChanged(m_stats);
+
+    AsyncDatabaseManager::instance()->post([]() {
+        QSqlDatabase db = StorageManager::instance()->connection(StorageManager::AIChatStore);
+        QSqlQuery query(db);
+        if (!query.exec("DELETE FROM ai_answer_cache")) {
+            qWarning() << "AnswerCache: 清空失败:" << query.lastError().text();
+        }
+    });
+}
+
+AnswerCacheStats AnswerCache::stats() const
+{
+    return m_stats;
+}
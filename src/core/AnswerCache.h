@@ -0,0 +1,91 @@
+#ifndef ANSWERCACHE_H
+#define ANSWERCACHE_H
+
+#include <QObject>
+#include <QString>
+#include <QCache>
+
+// 回答缓存的命中统计（本进程启动以来）
+struct AnswerCacheStats {
+    qint64 hits = 0;
+    qint64 misses = 0;
+    qint64 stores = 0;
+    qint64 evictions = 0;   // 超出条目上限被挤出内存的
+    qint64 expired = 0;     // 查找时发现已超过有效期的
+    int entries = 0;
+
+    double hitRate() const { return hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0; }
+};
+
+// AI 回答缓存：访客反复询问的常见问题（请假制度、入职流程、部门位置等）直接从缓存回答，
+// 不再请求远程模型。
+// - 问题先规范化（全角转半角、忽略大小写、去掉空白和标点），再与模型名、提示词版本一起作为键；
+// - 键里没有对话历史：会话第一轮（没有历史）或与上文无关的常见问题（isStandaloneQuestion）才查找和写入；
+// - 内存中按最近使用淘汰（QCache），超过有效期的条目在查找时丢弃；
+// - 持久化在 ai_chat_history.db 的 ai_answer_cache 表，读写都投递到数据库工作线程，
+//   启动时按最近使用顺序载入，重启后仍然命中；
+// - 有效期、条目上限保存在 storage.ini 的 answerCache/。
+// 只在主线程使用。
+class AnswerCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static AnswerCache* instance();
+
+    // 规范化后的问题，作为缓存键的一部分
+    static QString normalizeQuestion(const QString& question);
+    // 只缓存短问题：长文本多是自我介绍等个人内容，重复的可能性很小
+    static bool isCacheableQuestion(const QString& question);
+    // 不指向访客本人或上文的问题（"年假有几天"），回答与对话历史无关，任何一轮都可以走缓存
+    static bool isStandaloneQuestion(const QString& question);
+
+    // storage.ini 的 answerCache/enabled、answerCache/ttlHours、answerCache/maxEntries
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+    int ttlHours() const;
+    void setTtlHours(int hours);
+    int maxEntries() const;
+    void setMaxEntries(int count);
+
+    // 从磁盘载入（数据库工作线程启动后调用一次），载入完成前的查找都不命中
+    void load();
+
+    bool lookup(const QString& model, int promptVersion, const QString& question, QString* answer);
+    void store(const QString& model, int promptVersion, const QString& question, const QString& answer);
+    void clear();
+
+    AnswerCacheStats stats() const;
+
+signals:
+    void statsChanged(const AnswerCacheStats& stats);
+
+private:
+    struct Entry {
+        QString model;
+        int promptVersion = 0;
+        QString questionKey;
+        QString question;
+        QString answer;
+        qint64 createdAt = 0;   // 纪元毫秒
+        qint64 lastHitAt = 0;
+        int hitCount = 0;
+    };
+
+    explicit AnswerCache(QObject *parent = nullptr);
+
+    static QString cacheKey(const QString& model, int promptVersion, const QString& questionKey);
+    void insertEntry(Entry* entry);
+    qint64 ttlMs() const;
+
+    static AnswerCache* m_instance;
+
+    QCache<QString, Entry> m_entries;
+    AnswerCacheStats m_stats;
+    bool m_enabled;
+    int m_ttlHours;
+};
+
+Q_DECLARE_METATYPE(AnswerCacheStats)
+
+#endif // ANSWERCACHE_H
@@ -0,0 +1,228 @@
+#include "AsyncDatabaseManager.h"
+#include "GroupCommitWriter.h"
+#include <QCoreApplication>
+#include <QPair>
+#include <QDebug>
+
+AsyncDatabaseManager* AsyncDatabaseManager::m_instance = nullptr;
+
+AsyncDatabaseManager* AsyncDatabaseManager::instance()
+{
+    if (!m_instance) {
+        m_instance = new AsyncDatabaseManager;
+    }
+    return m_instance;
+}
+
+AsyncDatabaseManager::AsyncDatabaseManager(QObject *parent)
+    : QObject(parent)
+    , m_thread(new QThread)
+    , m_worker(new QObject)
+    , m_groupCommit(new GroupCommitWriter)
+{
+    qRegisterMetaType<UserInfo>("UserInfo");
+    qRegisterMetaType<ChatSession>("ChatSession");
+    qRegisterMetaType<ChatMessage>("ChatMessage");
+
+    m_thread->setObjectName("DatabaseWorker");
+    m_worker->moveToThread(m_thread);
+    m_groupCommit->moveToThread(m_thread);
+
+    // 工作线程退出前释放它自己的数据库连接
+    connect(m_thread, &QThread::finished, m_worker, []() {
+        DatabaseManager::instance()->releaseThreadConnection();
+    }, Qt::DirectConnection);
+
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+                this, &AsyncDatabaseManager::shutdown);
+    }
+}
+
+AsyncDatabaseManager::~AsyncDatabaseManager()
+{
+    shutdown();
+    delete m_groupCommit;
+    delete m_worker;
+    delete m_thread;
+}
+
+void AsyncDatabaseManager::start()
+{
+    if (!m_thread->isRunning()) {
+        m_thread->start();
+        qDebug() << "数据库工作线程已启动";
+    }
+}
+
+void AsyncDatabaseManager::shutdown()
+{
+    if (m_thread->isRunning()) {
+        // 先提交窗口内尚未写入的消息
+        QMetaObject::invokeMethod(m_groupCommit, &GroupCommitWriter::flush, Qt::BlockingQueuedConnection);
+        m_thread->quit();
+        m_thread->wait();
+        qDebug() << "数据库工作线程已停止";
+    }
+}
+
+bool AsyncDatabaseManager::isRunning() const
+{
+    return m_thread->isRunning();
+}
+
+GroupCommitWriter* AsyncDatabaseManager::groupCommitWriter() const
+{
+    return m_groupCommit;
+}
+
+// ========== 用户 ==========
+
+void AsyncDatabaseManager::loginUser(const QString& username, const QString& password, QObject* context,
+                                     std::function<void(bool, const UserInfo&)> callback)
+{
+    post(context, [username, password]() {
+        UserInfo userInfo;
+        bool ok = DatabaseManager::instance()->loginUser(username, password, userInfo);
+        return qMakePair(ok, userInfo);
+    }, [callback](const QPair<bool, UserInfo>& result) {
+        callback(result.first, result.second);
+    });
+}
+
+void AsyncDatabaseManager::getUserInfo(int userId, QObject* context, std::function<void(const UserInfo&)> callback)
+{
+    post(context, [userId]() {
+        return DatabaseManager::instance()->getUserInfo(userId);
+    }, callback);
+}
+
+void AsyncDatabaseManager::updateUserOnlineStatus(int userId, bool isOnline)
+{
+    post([userId, isOnline]() {
+        DatabaseManager::instance()->updateUserOnlineStatus(userId, isOnline);
+    });
+}
+
+// ========== 会话 ==========
+
+void AsyncDatabaseManager::createChatSession(int visitorId, int staffId, QObject* context,
+                                             std::function<void(int)> callback)
+{
+    post(context, [visitorId, staffId]() {
+        return DatabaseManager::instance()->createChatSession(visitorId, staffId);
+    }, callback);
+}
+
+void AsyncDatabaseManager::updateChatSession(int sessionId, int staffId, QObject* context,
+                                             std::function<void(bool)> callback)
+{
+    post(context, [sessionId, staffId]() {
+        return DatabaseManager::instance()->updateChatSession(sessionId, staffId);
+    }, callback);
+}
+
+void AsyncDatabaseManager::closeChatSession(int sessionId, QObject* context, std::function<void(bool)> callback)
+{
+    post(context, [sessionId]() {
+        return DatabaseManager::instance()->closeChatSession(sessionId);
+    }, callback);
+}
+
+void AsyncDatabaseManager::getActiveSessions(int viewerId, QObject* context,
+                                             std::function<void(const QList<ChatSession>&)> callback)
+{
+    post(context, [viewerId]() {
+        return DatabaseManager::instance()->getActiveSessions(viewerId);
+    }, callback);
+}
+
+void AsyncDatabaseManager::getvisitorSessions(int visitorId, QObject* context,
+                                              std::function<void(const QList<ChatSession>&)> callback)
+{
+    post(context, [visitorId]() {
+        return DatabaseManager::instance()->getvisitorSessions(visitorId);
+    }, callback);
+}
+
+void AsyncDatabaseManager::getChatSession(int sessionId, QObject* context,
+                                          std::function<void(const ChatSession&)> callback)
+{
+    post(context, [sessionId]() {
+        return DatabaseManager::instance()->getChatSession(sessionId);
+    }, callback);
+}
+
+// ========== 消息 ==========
+
+void AsyncDatabaseManager::sendMessage(int sessionId, int senderId, const QString& content, int messageType,
+                                       QObject* context, std::function<void(int)> callback)
+{
+    // 与同一时间窗口内的其他发送合并为一个事务，写入完成后在 context 所在线程回调
+    QFuture<int> future = m_groupCommit->submit({QString(), sessionId, senderId, content, messageType});
+    future.then(context, [callback](int messageId) {
+        callback(messageId);
+    });
+}
+
+void AsyncDatabaseManager::getChatMessages(int sessionId, int limit, QObject* context,
+                                           std::function<void(const QList<ChatMessage>&)> callback)
+{
+    post(context, [sessionId, limit]() {
+        return DatabaseManager::instance()->getChatMessages(sessionId, limit);
+    }, callback);
+}
+
+void AsyncDatabaseManager::getChatMessagesBefore(int sessionId, int beforeMessageId, int limit, QObject* context,
+                                                 std::function<void(const QList<ChatMessage>&)> callback)
+{
+    post(context, [sessionId, beforeMessageId, limit]() {
+        return DatabaseManager::instance()->getChatMessagesBefore(sessionId, beforeMessageId, limit);
+    }, callback);
+}
+
+void AsyncDatabaseManager::getMessagesSince(int sessionId, int lastSeenMessageId, int limit, QObject* context,
+                                            std::function<void(const QList<ChatMessage>&)> callback)
+{
+    post(context, [sessionId, lastSeenMessageId, limit]() {
+        return DatabaseManager::instance()->getMessagesSince(sessionId, lastSeenMessageId, limit);
+    }, callback);
+}
+
+void AsyncDatabaseManager::searchMessages(const QString& text, int sessionId, int limit, QObject* context,
+                                          std::function<void(const QList<ChatSearchResult>&)> callback)
+{
+    post(context, [text, sessionId, limit]() {
+        return DatabaseManager::instance()->searchMessages(text, sessionId, limit);
+    }, callback);
+}
+
+void AsyncDatabaseManager::getUnreadMessages(int userId, QObject* context,
+                                             std::function<void(const QList<ChatMessage>&)> callback)
+{
+    post(context, [userId]() {
+        return DatabaseManager::instance()->getUnreadMessages(userId);
+    }, callback);
+}
+
+void AsyncDatabaseManager::getUnreadSessionMessages(int sessionId, int userId, QObject* context,
+                                                    std::function<void(const QList<ChatMessage>&)> callback)
+{
+    post(context, [sessionId, userId]() {
+        return DatabaseManager::instance()->getUnreadSessionMessages(sessionId, userId);
+    }, callback);
+}
+
+void AsyncDatabaseManager::markReadUpTo(int sessionId, int userId, int messageId)
+{
+    post([sessionId, userId, messageId]() {
+        DatabaseManager::instance()->markReadUpTo(sessionId, userId, messageId);
+    });
+}
+
+void AsyncDatabaseManager::markSessionAsRead(int sessionId, int userId)
+{
+    post([sessionId, userId]() {
+        DatabaseManager::instance()->markSessionAsRead(sessionId, userId);
+    });
+}
@@ -0,0 +1,125 @@
+#ifndef ASYNCDATABASEMANAGER_H
+#define ASYNCDATABASEMANAGER_H
+
+#include <QObject>
+#include <QThread>
+#include <QPointer>
+#include <QList>
+#include <functional>
+#include <type_traits>
+#include "DatabaseManager.h"
+
+class GroupCommitWriter;
+
+// 异步数据库门面：所有查询串行投递到独立的数据库工作线程执行，
+// 工作线程持有自己的 SQLite 连接，结果通过排队调用回到调用者所在线程，
+// 避免数据库加锁或变慢时卡住界面事件循环。
+class AsyncDatabaseManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    static AsyncDatabaseManager* instance();
+
+    // 启动/停止工作线程（initDatabase 成功后启动）
+    void start();
+    void shutdown();
+    bool isRunning() const;
+
+    // sendMessage 使用的组提交写入器（窗口、批量上限与统计）
+    GroupCommitWriter* groupCommitWriter() const;
+
+    // 通用投递：task 在工作线程执行，callback 在主线程执行；
+    // context 被销毁后回调自动丢弃
+    template <typename Task, typename Callback>
+    void post(QObject* context, Task task, Callback callback);
+
+    // 只执行不关心结果
+    template <typename Task>
+    void post(Task task);
+
+    // 用户
+    void loginUser(const QString& username, const QString& password, QObject* context,
+                   std::function<void(bool, const UserInfo&)> callback);
+    void getUserInfo(int userId, QObject* context, std::function<void(const UserInfo&)> callback);
+    void updateUserOnlineStatus(int userId, bool isOnline);
+
+    // 会话
+    void createChatSession(int visitorId, int staffId, QObject* context,
+                           std::function<void(int)> callback);
+    void updateChatSession(int sessionId, int staffId, QObject* context,
+                           std::function<void(bool)> callback);
+    void closeChatSession(int sessionId, QObject* context, std::function<void(bool)> callback);
+    void getActiveSessions(int viewerId, QObject* context, std::function<void(const QList<ChatSession>&)> callback);
+    void getvisitorSessions(int visitorId, QObject* context,
+                            std::function<void(const QList<ChatSession>&)> callback);
+    void getChatSession(int sessionId, QObject* context, std::function<void(const ChatSession&)> callback);
+
+    // 消息（sendMessage 经组提交写入器合并提交）
+    void sendMessage(int sessionId, int senderId, const QString& content, int messageType,
+                     QObject* context, std::function<void(int)> callback);
+    void getChatMessages(int sessionId, int limit, QObject* context,
+                         std::function<void(const QList<ChatMessage>&)> callback);
+    void getChatMessagesBefore(int sessionId, int beforeMessageId, int limit, QObject* context,
+                               std::function<void(const QList<ChatMessage>&)> callback);
+    void getMessagesSince(int sessionId, int lastSeenMessageId, int limit, QObject* context,
+                          std::function<void(const QList<ChatMessage>&)> callback);
+    void searchMessages(const QString& text, int sessionId, int limit, QObject* context,
+                        std::function<void(const QList<ChatSearchResult>&)> callback);
+    void getUnreadMessages(int userId, QObject* context,
+                           std::function<void(const QList<ChatMessage>&)> callback);
+    void getUnreadSessionMessages(int sessionId, int userId, QObject* context,
+                                  std::function<void(const QList<ChatMessage>&)> callback);
+    void markReadUpTo(int sessionId, int userId, int messageId);
+    void markSessionAsRead(int sessionId, int userId);
+
+private:
+    explicit AsyncDatabaseManager(QObject *parent = nullptr);
+    ~AsyncDatabaseManager();
+
+    static AsyncDatabaseManager* m_instance;
+    QThread* m_thread;
+    QObject* m_worker;
+    GroupCommitWriter* m_groupCommit;
+};
+
+template <typename Task, typename Callback>
+void AsyncDatabaseManager::post(QObject* context, Task task, Callback callback)
+{
+    using Result = std::decay_t<std::invoke_result_t<Task>>;
+    QPointer<QObject> guard(context);
+
+    // 工作线程未运行（启动前或退出后）时退化为在调用线程同步执行
+    if (!isRunning()) {
+        Result result = task();
+        QMetaObject::invokeMethod(this, [callback, guard, result]() {
+            if (guard) {
+                callback(result);
+            }
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    QMetaObject::invokeMethod(m_worker, [this, task, callback, guard]() {
+        Result result = task();
+        // 回到 AsyncDatabaseManager 所在的主线程再检查 context 是否存活
+        QMetaObject::invokeMethod(this, [callback, guard, result]() {
+            if (guard) {
+                callback(result);
+            }
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+template <typename Task>
+void AsyncDatabaseManager::post(Task task)
+{
+    // 退出阶段（如窗口析构时更新在线状态）工作线程已停止，直接同步执行
+    if (!isRunning()) {
+        task();
+        return;
+    }
+    QMetaObject::invokeMethod(m_worker, task, Qt::QueuedConnection);
+}
+
+#endif // ASYNCDATABASEMANAGER_H
@@ -0,0 +1,384 @@
+#include "BackupManager.h"
+#include "ChatArchiver.h"
+#include "EpochTime.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QSettings>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <QPair>
+#include <QThread>
+#include <QPointer>
+#include <QDebug>
+#include <memory>
+#ifdef CYANLA_HAVE_SQLITE3
+#include <sqlite3.h>
+#endif
+
+namespace {
+// 需要备份的库；outbox.db 只是本实例尚未送达的发送队列，不做备份
+const QList<StorageManager::Store> BACKUP_STORES = {
+    StorageManager::MainStore,
+    StorageManager::ChatHistoryStore,
+    StorageManager::AIChatStore,
+    StorageManager::StatsStore
+};
+const int DEFAULT_INTERVAL_HOURS = 24;
+const int DEFAULT_KEEP_COUNT = 7;
+// 启动后先等界面和归档、清理任务跑完，再按小时检查是否到了备份时间
+const int FIRST_CHECK_DELAY_MS = 5 * 60 * 1000;
+const int CHECK_INTERVAL_MS = 60 * 60 * 1000;
+#ifdef CYANLA_HAVE_SQLITE3
+// 每步复制的页数（默认 4 KB 页时为 1 MB），步与步之间释放源库的读锁
+const int PAGES_PER_STEP = 256;
+const int STEP_PAUSE_MS = 5;
+const int BUSY_RETRY_MS = 50;
+const int BUSY_TIMEOUT_MS = 5000;
+// 写入频繁时分步复制可能不断被打断重来，超过次数后剩余部分一次复制完
+const int MAX_RESTARTS = 10;
+#endif
+}
+
+BackupManager* BackupManager::m_instance = nullptr;
+
+BackupManager* BackupManager::instance()
+{
+    if (!m_instance) {
+        m_instance = new BackupManager;
+    }
+    return m_instance;
+}
+
+BackupManager::BackupManager(QObject *parent)
+    : QObject(parent)
+    , m_running(false)
+{
+    qRegisterMetaType<BackupRunStats>("BackupRunStats");
+
+    m_scheduleTimer.setSingleShot(true);
+    connect(&m_scheduleTimer, &QTimer::timeout, this, &BackupManager::runScheduledBackup);
+}
+
+bool BackupManager::isEnabled() const
+{
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    return settings.value("backup/enabled", true).toBool();
+}
+
+void BackupManager::setEnabled(bool enabled)
+{
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    settings.setValue("backup/enabled", enabled);
+}
+
+int BackupManager::intervalHours() const
+{
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    return settings.value("backup/intervalHours", DEFAULT_INTERVAL_HOURS).toInt();
+}
+
+void BackupManager::setIntervalHours(int hours)
+{
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    settings.setValue("backup/intervalHours", qMax(1, hours));
+}
+
+int BackupManager::keepCount() const
+{
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    return settings.value("backup/keep", DEFAULT_KEEP_COUNT).toInt();
+}
+
+void BackupManager::setKeepCount(int count)
+{
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    settings.setValue("backup/keep", qMax(1, count));
+}
+
+QString BackupManager::backupDirectory() const
+{
+    QString path = StorageManager::instance()->dataDirectory() + "/backup";
+    QDir().mkpath(path);
+    return path;
+}
+
+void BackupManager::startSchedule()
+{
+    m_scheduleTimer.start(FIRST_CHECK_DELAY_MS);
+}
+
+bool BackupManager::isRunning() const
+{
+    return m_running;
+}
+
+void BackupManager::runScheduledBackup()
+{
+    m_scheduleTimer.start(CHECK_INTERVAL_MS);
+    if (!isEnabled()) {
+        return;
+    }
+
+    // 上次成功备份的时间记在 storage.ini，共享数据目录的多个实例不会重复备份
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    const qint64 lastRunAt = settings.value("backup/lastRunAt", 0).toLongLong();
+    if (EpochTime::nowMs() - lastRunAt >= qint64(intervalHours()) * 60 * 60 * 1000) {
+        backupNow();
+    }
+}
+
+void BackupManager::backupNow()
+{
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+
+    const QString directory = backupDirectory() + "/"
+                              + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss");
+    const QString archiveDirectory = ChatArchiver::instance()->archiveDirectory();
+
+    // 整个备份可能持续数秒到数分钟，不占用数据库工作线程
+    auto stats = std::make_shared<BackupRunStats>();
+    QThread* thread = QThread::create([stats, directory, archiveDirectory]() {
+        *stats = runBackup(directory, archiveDirectory);
+        StorageManager::instance()->releaseThreadConnections();
+    });
+
+    QPointer<BackupManager> self(this);
+    connect(thread, &QThread::finished, this, [self, stats, thread]() {
+        thread->deleteLater();
+        if (!self) return;
+
+        self->m_running = false;
+        if (stats->verified) {
+            QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+            settings.setValue("backup/lastRunAt", EpochTime::nowMs());
+            self->pruneSnapshots();
+        }
+        emit self->backupFinished(*stats);
+    });
+    thread->start(QThread::LowPriority);
+}
+
+BackupRunStats BackupManager::runBackup(const QString& directory, const QString& archiveDirectory)
+{
+    BackupRunStats stats;
+    stats.directory = directory;
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!QDir().mkpath(directory)) {
+        stats.error = "无法创建备份目录: " + directory;
+        qWarning() << "BackupManager:" << stats.error;
+        return stats;
+    }
+
+    // 各存储库，加上已移出热表的月度归档库
+    QList<QPair<QString, QString>> sources;
+    StorageManager* storage = StorageManager::instance();
+    for (StorageManager::Store store : BACKUP_STORES) {
+        const QString source = storage->databasePath(store);
+        if (QFileInfo::exists(source)) {
+            sources.append({source, directory + "/" + QFileInfo(source).fileName()});
+        }
+    }
+    const QStringList archives = QDir(archiveDirectory).entryList({"chat_archive_*.db"}, QDir::Files, QDir::Name);
+    if (!archives.isEmpty() && !QDir().mkpath(directory + "/archive")) {
+        stats.error = "无法创建备份目录: " + directory + "/archive";
+        qWarning() << "BackupManager:" << stats.error;
+        QDir(directory).removeRecursively();
+        return stats;
+    }
+    for (const QString& archive : archives) {
+        sources.append({archiveDirectory + "/" + archive, directory + "/archive/" + archive});
+    }
+
+    bool ok = true;
+    for (const auto& source : sources) {
+        QString error;
+        if (!backupFile(source.first, source.second, &stats, &error)) {
+            stats.error = QString("%1: %2").arg(QFileInfo(source.first).fileName(), error);
+            ok = false;
+            break;
+        }
+    }
+
+    stats.verified = ok && !stats.files.isEmpty();
+    stats.elapsedMs = timer.elapsed();
+
+    if (!ok) {
+        // 不完整的快照没有意义，整个目录删掉
+        qWarning() << "BackupManager: 备份失败:" << stats.error;
+        QDir(directory).removeRecursively();
+        stats.files.clear();
+    } else {
+        qDebug() << QString("BackupManager: 备份 %1 个库，%2 KB，%3 页 / %4 步，耗时 %5 ms，%6 MB/s")
+                        .arg(stats.files.size()).arg(stats.bytes / 1024)
+                        .arg(stats.pages).arg(stats.steps).arg(stats.elapsedMs)
+                        .arg(stats.megabytesPerSecond(), 0, 'f', 1);
+    }
+    return stats;
+}
+
+bool BackupManager::backupFile(const QString& source, const QString& target, BackupRunStats* stats, QString* error)
+{
+    const QString partial = target + ".part";
+    QFile::remove(partial);
+
+    if (!copyDatabase(source, partial, stats, error) || !verifyDatabase(partial, error)) {
+        QFile::remove(partial);
+        return false;
+    }
+
+    QFile::remove(target);
+    if (!QFile::rename(partial, target)) {
+        *error = "无法保存备份文件: " + target;
+        QFile::remove(partial);
+        return false;
+    }
+    stats->bytes += QFileInfo(target).size();
+    stats->files.append(target);
+    return true;
+}
+
+#ifdef CYANLA_HAVE_SQLITE3
+
+bool BackupManager::copyDatabase(const QString& source, const QString& target,
+                                 BackupRunStats* stats, QString* error)
+{
+    sqlite3* sourceDb = nullptr;
+    sqlite3* targetDb = nullptr;
+    sqlite3_backup* backup = nullptr;
+    bool ok = false;
+
+    // 源库以读写方式打开：只读连接在 WAL 库上需要 -shm 已存在，且备份本身只读取源库
+    if (sqlite3_open_v2(source.toUtf8().constData(), &sourceDb, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+        *error = QString("打开源库失败: %1").arg(sqlite3_errmsg(sourceDb));
+    } else if (sqlite3_open_v2(target.toUtf8().constData(), &targetDb,
+                               SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK) {
+        *error = QString("创建备份文件失败: %1").arg(sqlite3_errmsg(targetDb));
+    } else if (!(backup = sqlite3_backup_init(targetDb, "main", sourceDb, "main"))) {
+        *error = QString("初始化在线备份失败: %1").arg(sqlite3_errmsg(targetDb));
+    } else {
+        sqlite3_busy_timeout(sourceDb, BUSY_TIMEOUT_MS);
+
+        // 其他连接修改源库后，下一步会从头复制；剩余页数回升即为一次重来
+        int restarts = 0;
+        int lastRemaining = -1;
+        int rc = SQLITE_OK;
+        while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+            const int pages = restarts < MAX_RESTARTS ? PAGES_PER_STEP : -1;
+            rc = sqlite3_backup_step(backup, pages);
+            ++stats->steps;
+
+            const int remaining = sqlite3_backup_remaining(backup);
+            if (lastRemaining >= 0 && remaining > lastRemaining) {
+                ++restarts;
+            }
+            lastRemaining = remaining;
+
+            if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+                QThread::msleep(BUSY_RETRY_MS);
+            } else if (rc == SQLITE_OK) {
+                QThread::msleep(STEP_PAUSE_MS);
+            }
+        }
+
+        stats->pages += sqlite3_backup_pagecount(backup);
+        stats->restarts += restarts;
+        ok = rc == SQLITE_DONE;
+        if (!ok) {
+            *error = QString("在线备份失败: %1").arg(sqlite3_errstr(rc));
+        }
+    }
+
+    if (backup) {
+        sqlite3_backup_finish(backup);
+    }
+    sqlite3_close(targetDb);
+    sqlite3_close(sourceDb);
+    return ok;
+}
+
+#else
+
+bool BackupManager::copyDatabase(const QString& source, const QString& target,
+                                 BackupRunStats* stats, QString* error)
+{
+    // 未启用在线备份 API 时退回 VACUUM INTO：在一个读事务中生成整理过的一致副本，
+    // WAL 模式下读事务不阻塞写入，但无法分步让出，也不能中途报告进度。
+    // 归档库不在 StorageManager 中，统一用本线程的临时连接执行
+    const QString name = QString("Cyan_backup_copy_%1")
+                             .arg(reinterpret_cast<quintptr>(QThread::currentThread()), 0, 16);
+    bool ok = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+        db.setDatabaseName(source);
+        db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+        if (!db.open()) {
+            *error = "打开源库失败: " + db.lastError().text();
+        } else {
+            QSqlQuery query(db);
+            query.prepare("VACUUM INTO ?");
+            query.addBindValue(target);
+            ++stats->steps;
+            ok = query.exec();
+            if (!ok) {
+                *error = "VACUUM INTO 失败: " + query.lastError().text();
+            }
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(name);
+    return ok;
+}
+
+#endif
+
+bool BackupManager::verifyDatabase(const QString& path, QString* error)
+{
+    const QString name = QString("Cyan_backup_verify_%1")
+                             .arg(reinterpret_cast<quintptr>(QThread::currentThread()), 0, 16);
+    bool ok = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+        db.setDatabaseName(path);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY");
+        if (!db.open()) {
+            *error = "无法打开备份文件: " + db.lastError().text();
+        } else {
+            QSqlQuery query(db);
+            if (query.exec("PRAGMA integrity_check") && query.next()) {
+                const QString result = query.value(0).toString();
+                ok = result == "ok";
+                if (!ok) {
+                    *error = "完整性检查未通过: " + result;
+                }
+            } else {
+                *error = "完整性检查失败: " + query.lastError().text();
+            }
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(name);
+    return ok;
+}
+
+void BackupManager::pruneSnapshots()
+{
+    // 快照目录名即时间，按名称排序就是按时间排序
+    QDir root(backupDirectory());
+    QStringList snapshots = root.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    const int keep = keepCount();
+    while (snapshots.size() > keep) {
+        const QString oldest = snapshots.takeFirst();
+        if (QDir(root.filePath(oldest)).removeRecursively()) {
+            qDebug() << "BackupManager: 删除旧快照" << oldest;
+        }
+    }
+}
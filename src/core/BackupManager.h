@@ -0,0 +1,80 @@
+#ifndef BACKUPMANAGER_H
+#define BACKUPMANAGER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include "StorageManager.h"
+
+// 一次备份的统计
+struct BackupRunStats {
+    QString directory;      // 本次快照所在目录
+    QStringList files;      // 已通过校验的备份文件
+    qint64 bytes = 0;
+    qint64 pages = 0;
+    int steps = 0;          // 分步复制的步数
+    int restarts = 0;       // 源库在复制期间被修改、从头重来的次数
+    qint64 elapsedMs = 0;
+    bool verified = false;  // 全部备份文件 integrity_check 通过
+    QString error;
+
+    double megabytesPerSecond() const { return bytes / 1048576.0 * 1000.0 / qMax<qint64>(1, elapsedMs); }
+};
+
+// 在线备份：在独立线程上为各数据库生成一致的快照，写入数据目录 backup/yyyyMMdd_hhmmss/，
+// ChatArchiver 的月度归档库（archive/chat_archive_*.db）一并写入快照的 archive/ 子目录。
+// - 启用 CYANLA_HAVE_SQLITE3 时使用 SQLite 在线备份 API，每步复制 PAGES_PER_STEP 页，
+//   步与步之间让出锁，写入方不会被长时间阻塞；
+// - 否则使用 VACUUM INTO，WAL 模式下它只持有读事务，同样不阻塞写入；
+// - 先写入 .part 临时文件，integrity_check 通过后才改名，残缺的快照不会被当作备份；
+// - 按 storage.ini 的 backup/ 设置定时执行，只保留最近 N 份快照。
+// 只在主线程使用。
+class BackupManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    static BackupManager* instance();
+
+    // storage.ini 的 backup/enabled、backup/intervalHours、backup/keep
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+    int intervalHours() const;
+    void setIntervalHours(int hours);
+    int keepCount() const;
+    void setKeepCount(int count);
+
+    QString backupDirectory() const;
+
+    // 启动定时备份：启动后稍等片刻检查一次，之后按间隔执行
+    void startSchedule();
+    // 立即在后台执行一次，已在执行时忽略
+    void backupNow();
+    bool isRunning() const;
+
+signals:
+    void backupFinished(const BackupRunStats& stats);
+
+private slots:
+    void runScheduledBackup();
+
+private:
+    explicit BackupManager(QObject *parent = nullptr);
+
+    static BackupRunStats runBackup(const QString& directory, const QString& archiveDirectory);
+    static bool backupFile(const QString& source, const QString& target, BackupRunStats* stats, QString* error);
+    static bool copyDatabase(const QString& source, const QString& target,
+                             BackupRunStats* stats, QString* error);
+    static bool verifyDatabase(const QString& path, QString* error);
+    void pruneSnapshots();
+
+    static BackupManager* m_instance;
+
+    QTimer m_scheduleTimer;
+    bool m_running;
+};
+
+Q_DECLARE_METATYPE(BackupRunStats)
+
+#endif // BACKUPMANAGER_H
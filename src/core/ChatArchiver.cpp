@@ -0,0 +1,540 @@
+#include "ChatArchiver.h"
+#include "AsyncDatabaseManager.h"
+#include "StorageManager.h"
+#include "RetentionManager.h"
+#include "EpochTime.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QSettings>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QDir>
+#include <QMap>
+#include <QDebug>
+#include <limits>
+
+namespace {
+// 归档库在 Cyan.db 连接上 ATTACH 时使用的库名
+const QString ARCHIVE_SCHEMA = "chat_archive";
+const int DEFAULT_ARCHIVE_AFTER_DAYS = 90;
+// 启动后等界面空闲下来再执行第一次归档
+const int FIRST_RUN_DELAY_MS = 60 * 1000;
+const int RUN_INTERVAL_MS = 24 * 60 * 60 * 1000;
+// 正文短于该长度时压缩反而变大，直接保存
+const int MIN_COMPRESS_BYTES = 64;
+// 归档库结构版本（PRAGMA user_version）：1 起时间列为纪元毫秒
+const int ARCHIVE_VERSION = 1;
+}
+
+ChatArchiver* ChatArchiver::m_instance = nullptr;
+
+ChatArchiver* ChatArchiver::instance()
+{
+    if (!m_instance) {
+        m_instance = new ChatArchiver;
+    }
+    return m_instance;
+}
+
+ChatArchiver::ChatArchiver(QObject *parent)
+    : QObject(parent)
+    , m_running(false)
+{
+    qRegisterMetaType<ArchiveRunStats>("ArchiveRunStats");
+
+    m_scheduleTimer.setSingleShot(true);
+    connect(&m_scheduleTimer, &QTimer::timeout, this, &ChatArchiver::runScheduledArchive);
+}
+
+QSqlDatabase ChatArchiver::database()
+{
+    return DatabaseManager::instance()->connection();
+}
+
+int ChatArchiver::archiveAfterDays() const
+{
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    return settings.value("archive/afterDays", DEFAULT_ARCHIVE_AFTER_DAYS).toInt();
+}
+
+void ChatArchiver::setArchiveAfterDays(int days)
+{
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    settings.setValue("archive/afterDays", qMax(0, days));
+}
+
+void ChatArchiver::startSchedule()
+{
+    m_scheduleTimer.start(FIRST_RUN_DELAY_MS);
+}
+
+void ChatArchiver::runScheduledArchive()
+{
+    m_scheduleTimer.start(RUN_INTERVAL_MS);
+
+    const int days = archiveAfterDays();
+    if (days <= 0 || m_running) {
+        return;
+    }
+
+    m_running = true;
+    AsyncDatabaseManager::instance()->post(this, [this, days]() {
+        return archiveClosedSessions(days);
+    }, [this](const ArchiveRunStats& stats) {
+        m_running = false;
+        if (stats.sessions > 0) {
+            RetentionManager::instance()->requestVacuum(StorageManager::MainStore);
+        }
+        emit archiveFinished(stats);
+    });
+}
+
+QString ChatArchiver::archiveDirectory() const
+{
+    QString path = StorageManager::instance()->dataDirectory() + "/archive";
+    QDir().mkpath(path);
+    return path;
+}
+
+QString ChatArchiver::archiveFileFor(const QDateTime& closedAt) const
+{
+    return QString("chat_archive_%1.db").arg(closedAt.toString("yyyy_MM"));
+}
+
+bool ChatArchiver::attachArchive(QSqlDatabase& db, const QString& fileName, bool create)
+{
+    const QString path = archiveDirectory() + "/" + fileName;
+    if (!create && !QFileInfo::exists(path)) {
+        qWarning() << "ChatArchiver: 归档库不存在:" << path;
+        return false;
+    }
+
+    QSqlQuery query(db);
+    query.prepare(QString("ATTACH DATABASE ? AS %1").arg(ARCHIVE_SCHEMA));
+    query.addBindValue(path);
+    if (!query.exec()) {
+        qWarning() << "ChatArchiver: ATTACH 归档库失败:" << path << query.lastError().text();
+        return false;
+    }
+
+    if (!create) {
+        if (!upgradeArchive(db)) {
+            detachArchive(db);
+            return false;
+        }
+        return true;
+    }
+
+    // 归档库的表结构与热表一致，正文为 BLOB，compressed 标记是否经过 qCompress
+    const QStringList statements = {
+        QString(R"(CREATE TABLE IF NOT EXISTS %1.archived_sessions (
+                       id INTEGER PRIMARY KEY,
+                       visitor_id INTEGER NOT NULL,
+                       staff_id INTEGER,
+                       visitor_name VARCHAR(50),
+                       staff_name VARCHAR(50),
+                       created_at DATETIME,
+                       last_message_at DATETIME,
+                       message_count INTEGER NOT NULL DEFAULT 0
+                   ))"),
+        QString(R"(CREATE TABLE IF NOT EXISTS %1.archived_messages (
+                       id INTEGER PRIMARY KEY,
+                       session_id INTEGER NOT NULL,
+                       sender_id INTEGER NOT NULL,
+                       sender_name VARCHAR(50),
+                       sender_role VARCHAR(20),
+                       content BLOB NOT NULL,
+                       compressed INTEGER NOT NULL DEFAULT 0,
+                       timestamp DATETIME,
+                       message_type INTEGER DEFAULT 0,
+                       is_read INTEGER DEFAULT 0,
+                       client_msg_id TEXT
+                   ))"),
+        QString("CREATE INDEX IF NOT EXISTS %1.idx_archived_messages_session "
+                "ON archived_messages(session_id, id)"),
+        QString("CREATE INDEX IF NOT EXISTS %1.idx_archived_messages_time "
+                "ON archived_messages(timestamp)")
+    };
+    for (const QString& sql : statements) {
+        if (!query.exec(sql.arg(ARCHIVE_SCHEMA))) {
+            qWarning() << "ChatArchiver: 创建归档表失败:" << query.lastError().text();
+            detachArchive(db);
+            return false;
+        }
+    }
+    if (!upgradeArchive(db)) {
+        detachArchive(db);
+        return false;
+    }
+    return true;
+}
+
+bool ChatArchiver::upgradeArchive(QSqlDatabase& db)
+{
+    QSqlQuery query(db);
+    int version = 0;
+    if (query.exec(QString("PRAGMA %1.user_version").arg(ARCHIVE_SCHEMA)) && query.next()) {
+        version = query.value(0).toInt();
+    }
+    query.finish();
+    if (version >= ARCHIVE_VERSION) {
+        return true;
+    }
+
+    // 早期归档库复制的是 Cyan.db 的 UTC 文本时间，首次打开时就地转换为毫秒
+    const QList<QPair<QString, QString>> columns = {
+        {"archived_sessions", "created_at"},
+        {"archived_sessions", "last_message_at"},
+        {"archived_messages", "timestamp"}
+    };
+    for (const auto& column : columns) {
+        if (EpochTime::convertTextColumn(db, ARCHIVE_SCHEMA + "." + column.first,
+                                         column.second, EpochTime::UtcText) < 0) {
+            return false;
+        }
+    }
+
+    if (!query.exec(QString("PRAGMA %1.user_version = %2").arg(ARCHIVE_SCHEMA).arg(ARCHIVE_VERSION))) {
+        qWarning() << "ChatArchiver: 更新归档库版本失败:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+void ChatArchiver::detachArchive(QSqlDatabase& db)
+{
+    QSqlQuery query(db);
+    if (!query.exec(QString("DETACH DATABASE %1").arg(ARCHIVE_SCHEMA))) {
+        qWarning() << "ChatArchiver: DETACH 归档库失败:" << query.lastError().text();
+    }
+}
+
+QByteArray ChatArchiver::packContent(const QString& content, bool* compressed)
+{
+    const QByteArray raw = content.toUtf8();
+    *compressed = false;
+    if (raw.size() < MIN_COMPRESS_BYTES) {
+        return raw;
+    }
+
+    const QByteArray packed = qCompress(raw, 9);
+    if (packed.size() >= raw.size()) {
+        return raw;
+    }
+    *compressed = true;
+    return packed;
+}
+
+QString ChatArchiver::unpackContent(const QByteArray& data, bool compressed)
+{
+    return QString::fromUtf8(compressed ? qUncompress(data) : data);
+}
+
+ArchiveRunStats ChatArchiver::archiveClosedSessions(int olderThanDays, int maxSessions)
+{
+    ArchiveRunStats stats;
+    QElapsedTimer timer;
+    timer.start();
+
+    QSqlDatabase db = database();
+    QSqlQuery query(db);
+
+    // last_message_at 在结束会话时更新为结束时间
+    const qint64 cutoff = EpochTime::toMs(QDateTime::currentDateTime().addDays(-olderThanDays));
+    query.prepare(R"(
+        SELECT s.id, s.last_message_at
+        FROM chat_sessions s
+        WHERE s.status = 0 AND s.last_message_at < ?
+          AND NOT EXISTS (SELECT 1 FROM chat_archive_index a WHERE a.session_id = s.id)
+        ORDER BY s.last_message_at
+        LIMIT ?
+    )");
+    query.addBindValue(cutoff);
+    query.addBindValue(maxSessions);
+    if (!query.exec()) {
+        qWarning() << "ChatArchiver: 查询待归档会话失败:" << query.lastError().text();
+        return stats;
+    }
+
+    // 按结束月份分组，每个归档库一次 ATTACH
+    QMap<QString, QList<int>> sessionsByFile;
+    while (query.next()) {
+        const QDateTime closedAt = EpochTime::fromColumn(query.value(1));
+        sessionsByFile[archiveFileFor(closedAt)].append(query.value(0).toInt());
+    }
+    query.finish();
+
+    // WAL 下跨两个库文件的提交不是原子的，因此分两步：
+    // 1. 只写归档库的事务：复制会话与消息并压缩，提交后逐会话核对归档行数；
+    // 2. 只写 Cyan.db 的事务：删除已核对的热表消息，最后写入 chat_archive_index。
+    // 任一步中断时索引行都不存在，下次运行会重新复制（INSERT OR REPLACE 可重入）并继续。
+    for (auto it = sessionsByFile.constBegin(); it != sessionsByFile.constEnd(); ++it) {
+        const QString& fileName = it.key();
+        if (!attachArchive(db, fileName, true)) {
+            continue;
+        }
+
+        qint64 fileRawBytes = 0;
+        qint64 fileStoredBytes = 0;
+        bool ok = db.transaction();
+
+        for (int sessionId : it.value()) {
+            if (!ok) break;
+
+            // 整行原样复制，时间戳与 Cyan.db 一样是纪元毫秒
+            query.prepare(QString(R"(
+                INSERT OR REPLACE INTO %1.archived_sessions
+                    (id, visitor_id, staff_id, visitor_name, staff_name, created_at, last_message_at, message_count)
+                SELECT id, visitor_id, staff_id, visitor_name, staff_name, created_at, last_message_at, message_count
+                FROM main.chat_sessions WHERE id = ?
+            )").arg(ARCHIVE_SCHEMA));
+            query.addBindValue(sessionId);
+            ok = query.exec();
+
+            if (ok) {
+                query.prepare(QString(R"(
+                    INSERT OR REPLACE INTO %1.archived_messages
+                        (id, session_id, sender_id, sender_name, sender_role, content, compressed,
+                         timestamp, message_type, is_read, client_msg_id)
+                    SELECT id, session_id, sender_id, sender_name, sender_role, content, 0,
+                           timestamp, message_type, is_read, client_msg_id
+                    FROM main.chat_messages WHERE session_id = ?
+                )").arg(ARCHIVE_SCHEMA));
+                query.addBindValue(sessionId);
+                ok = query.exec();
+            }
+
+            // 再逐条压缩正文
+            QList<QPair<int, QString>> contents;
+            if (ok) {
+                query.prepare("SELECT id, content FROM main.chat_messages WHERE session_id = ?");
+                query.addBindValue(sessionId);
+                ok = query.exec();
+                while (ok && query.next()) {
+                    contents.append({query.value(0).toInt(), query.value(1).toString()});
+                }
+                query.finish();
+            }
+
+            if (ok) {
+                query.prepare(QString("UPDATE %1.archived_messages SET content = ?, compressed = 1 WHERE id = ?")
+                                  .arg(ARCHIVE_SCHEMA));
+                for (const auto& content : contents) {
+                    bool compressed = false;
+                    const QByteArray packed = packContent(content.second, &compressed);
+                    const qint64 rawBytes = content.second.toUtf8().size();
+                    fileRawBytes += rawBytes;
+                    fileStoredBytes += packed.size();
+                    if (!compressed) continue;
+
+                    query.addBindValue(packed);
+                    query.addBindValue(content.first);
+                    if (!query.exec()) {
+                        ok = false;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (!ok || !db.commit()) {
+            // 热表尚未改动，归档库中残留的行下次会被覆盖
+            qWarning() << "ChatArchiver: 复制到" << fileName << "失败:" << query.lastError().text();
+            db.rollback();
+            detachArchive(db);
+            continue;
+        }
+
+        // 归档库已落盘，核对每个会话的热表消息都已在归档库中
+        QList<int> verified;
+        for (int sessionId : it.value()) {
+            query.prepare(QString(R"(
+                SELECT COUNT(*) FROM main.chat_messages m
+                WHERE m.session_id = ?
+                  AND NOT EXISTS (SELECT 1 FROM %1.archived_messages a WHERE a.id = m.id)
+            )").arg(ARCHIVE_SCHEMA));
+            query.addBindValue(sessionId);
+            if (query.exec() && query.next() && query.value(0).toInt() == 0) {
+                verified.append(sessionId);
+            } else {
+                qWarning() << "ChatArchiver: 会话" << sessionId << "归档核对未通过，保留热表数据";
+            }
+            query.finish();
+        }
+
+        int fileSessions = 0;
+        int fileMessages = 0;
+        ok = !verified.isEmpty() && db.transaction();
+
+        for (int sessionId : verified) {
+            if (!ok) break;
+
+            // 只删除归档库中确实存在的行
+            query.prepare(QString(R"(
+                DELETE FROM main.chat_messages
+                WHERE session_id = ?
+                  AND id IN (SELECT id FROM %1.archived_messages WHERE session_id = ?)
+            )").arg(ARCHIVE_SCHEMA));
+            query.addBindValue(sessionId);
+            query.addBindValue(sessionId);
+            ok = query.exec();
+
+            // 索引行最后写入；多个实例同时归档时，只有写入成功的一方计入统计
+            if (ok) {
+                query.prepare(QString(R"(
+                    INSERT OR IGNORE INTO chat_archive_index
+                        (session_id, archive_file, message_count, first_message_at, last_message_at, archived_at)
+                    SELECT s.id, ?, COUNT(a.id), MIN(a.timestamp), s.last_message_at, ?
+                    FROM chat_sessions s
+                    LEFT JOIN %1.archived_messages a ON a.session_id = s.id
+                    WHERE s.id = ?
+                    GROUP BY s.id
+                )").arg(ARCHIVE_SCHEMA));
+                query.addBindValue(fileName);
+                query.addBindValue(EpochTime::nowMs());
+                query.addBindValue(sessionId);
+                ok = query.exec();
+            }
+
+            if (ok && query.numRowsAffected() > 0) {
+                ++fileSessions;
+                query.prepare(QString("SELECT COUNT(*) FROM %1.archived_messages WHERE session_id = ?")
+                                  .arg(ARCHIVE_SCHEMA));
+                query.addBindValue(sessionId);
+                if (query.exec() && query.next()) {
+                    fileMessages += query.value(0).toInt();
+                }
+                query.finish();
+            }
+        }
+
+        if (ok && db.commit()) {
+            stats.sessions += fileSessions;
+            stats.messages += fileMessages;
+            stats.rawBytes += fileRawBytes;
+            stats.storedBytes += fileStoredBytes;
+            if (fileSessions > 0) {
+                stats.archiveFiles.append(fileName);
+            }
+        } else if (!verified.isEmpty()) {
+            // 回滚后热表保持原样，归档库中的副本下次运行时覆盖后再删除
+            qWarning() << "ChatArchiver: 清理" << fileName << "对应的热表失败:" << query.lastError().text();
+            db.rollback();
+        }
+
+        detachArchive(db);
+    }
+
+    stats.elapsedMs = timer.elapsed();
+    if (stats.sessions > 0) {
+        qDebug() << QString("ChatArchiver: 归档 %1 个会话、%2 条消息，正文 %3 KB -> %4 KB，耗时 %5 ms")
+                        .arg(stats.sessions).arg(stats.messages)
+                        .arg(stats.rawBytes / 1024).arg(stats.storedBytes / 1024)
+                        .arg(stats.elapsedMs);
+    }
+    return stats;
+}
+
+bool ChatArchiver::isArchived(int sessionId)
+{
+    QSqlQuery query(database());
+    query.prepare("SELECT 1 FROM chat_archive_index WHERE session_id = ?");
+    query.addBindValue(sessionId);
+    return query.exec() && query.next();
+}
+
+QList<ChatMessage> ChatArchiver::loadArchivedMessages(int sessionId, int beforeMessageId, int limit)
+{
+    QList<ChatMessage> messages;
+
+    QSqlDatabase db = database();
+    QSqlQuery query(db);
+    query.prepare("SELECT archive_file FROM chat_archive_index WHERE session_id = ?");
+    query.addBindValue(sessionId);
+    if (!query.exec() || !query.next()) {
+        return messages;
+    }
+    const QString fileName = query.value(0).toString();
+    query.finish();
+
+    if (!attachArchive(db, fileName, false)) {
+        return messages;
+    }
+
+    query.prepare(QString(R"(
+        SELECT id, session_id, sender_id, sender_name, sender_role,
+               content, compressed, timestamp, message_type, is_read, client_msg_id
+        FROM %1.archived_messages
+        WHERE session_id = ? AND id < ?
+        ORDER BY id DESC
+        LIMIT ?
+    )").arg(ARCHIVE_SCHEMA));
+    query.addBindValue(sessionId);
+    query.addBindValue(beforeMessageId > 0 ? beforeMessageId : std::numeric_limits<int>::max());
+    query.addBindValue(limit);
+
+    if (query.exec()) {
+        while (query.next()) {
+            ChatMessage message;
+            message.id = query.value("id").toInt();
+            message.sessionId = query.value("session_id").toInt();
+            message.senderId = query.value("sender_id").toInt();
+            message.senderName = query.value("sender_name").toString();
+            message.senderRole = query.value("sender_role").toString();
+            message.content = unpackContent(query.value("content").toByteArray(),
+                                            query.value("compressed").toBool());
+            message.timestamp = EpochTime::fromColumn(query.value("timestamp"));
+            message.messageType = query.value("message_type").toInt();
+            message.isRead = query.value("is_read").toInt();
+            message.clientMsgId = query.value("client_msg_id").toString();
+            messages.prepend(message);
+        }
+    } else {
+        qWarning() << "ChatArchiver: 读取归档消息失败:" << query.lastError().text();
+    }
+    query.finish();
+
+    detachArchive(db);
+    return messages;
+}
+
+void ChatArchiver::countArchivedActivity(const QDateTime& since, int* sessions, int* messages)
+{
+    *sessions = 0;
+    *messages = 0;
+
+    QSqlDatabase db = database();
+    QSqlQuery query(db);
+
+    // 只 ATTACH 可能包含 since 之后消息的归档库
+    const qint64 sinceMs = EpochTime::toMs(since);
+    query.prepare("SELECT DISTINCT archive_file FROM chat_archive_index WHERE last_message_at >= ?");
+    query.addBindValue(sinceMs);
+    QStringList files;
+    if (query.exec()) {
+        while (query.next()) {
+            files.append(query.value(0).toString());
+        }
+    }
+    query.finish();
+
+    for (const QString& fileName : files) {
+        if (!attachArchive(db, fileName, false)) {
+            continue;
+        }
+
+        query.prepare(QString(R"(
+            SELECT COUNT(DISTINCT session_id), SUM(sender_id > 0)
+            FROM %1.archived_messages
+            WHERE timestamp >= ?
+        )").arg(ARCHIVE_SCHEMA));
+        query.addBindValue(sinceMs);
+        if (query.exec() && query.next()) {
+            *sessions += query.value(0).toInt();
+            *messages += query.value(1).toInt();
+        }
+        query.finish();
+
+        detachArchive(db);
+    }
+}
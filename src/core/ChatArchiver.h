@@ -0,0 +1,82 @@
+#ifndef CHATARCHIVER_H
+#define CHATARCHIVER_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QDateTime>
+#include <QString>
+#include <QList>
+#include <QTimer>
+#include "DatabaseManager.h"
+
+// 一次归档的统计
+struct ArchiveRunStats {
+    int sessions = 0;
+    int messages = 0;
+    qint64 rawBytes = 0;        // 消息正文压缩前的字节数
+    qint64 storedBytes = 0;     // 写入归档库的字节数
+    qint64 elapsedMs = 0;
+    QStringList archiveFiles;   // 本次写入的归档库
+};
+
+// 已结束会话的分层归档：
+// - 结束超过 N 天的会话（status = 0）的消息移出 Cyan.db，按结束月份写入数据目录 archive/ 下的
+//   chat_archive_yyyy_MM.db，消息正文用 qCompress 压缩，chat_messages 和它的索引只保留近期数据；
+//   归档后请求 RetentionManager 对 Cyan.db 执行 incremental_vacuum，归还腾出的空闲页；
+// - Cyan.db 的 chat_archive_index 记录每个会话所在的归档库。会话行本身（列表、摘要）体积很小，
+//   有意保留在 chat_sessions，会话列表不必跨库查询；
+// - 读取历史记录或统计报表时按需 ATTACH 对应的归档库，用完即 DETACH。
+// 归档与读取都在调用线程的 Cyan.db 连接上执行，界面侧经 AsyncDatabaseManager 调用。
+class ChatArchiver : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ChatArchiver* instance();
+
+    // 结束多少天后归档，保存在 storage.ini 的 archive/afterDays，0 表示不自动归档
+    int archiveAfterDays() const;
+    void setArchiveAfterDays(int days);
+
+    // 启动定时归档：启动后稍等片刻执行一次，之后每天一次
+    void startSchedule();
+
+    QString archiveDirectory() const;
+
+    // 归档结束超过 olderThanDays 天的会话，单次最多 maxSessions 个
+    ArchiveRunStats archiveClosedSessions(int olderThanDays, int maxSessions = 500);
+
+    bool isArchived(int sessionId);
+    // 归档会话中 ID 小于 beforeMessageId 的最近 limit 条消息（beforeMessageId <= 0 表示从最新开始），
+    // 按 ID 正序返回；走 (session_id, id) 索引，和热表一样按页读取
+    QList<ChatMessage> loadArchivedMessages(int sessionId, int beforeMessageId, int limit);
+    // 各归档库中 since 之后有消息的会话数与非系统消息数，口径与 StorageManager::activityReport 一致
+    void countArchivedActivity(const QDateTime& since, int* sessions, int* messages);
+
+signals:
+    void archiveFinished(const ArchiveRunStats& stats);
+
+private slots:
+    void runScheduledArchive();
+
+private:
+    explicit ChatArchiver(QObject *parent = nullptr);
+
+    QSqlDatabase database();
+    QString archiveFileFor(const QDateTime& closedAt) const;
+    bool attachArchive(QSqlDatabase& db, const QString& fileName, bool create);
+    void detachArchive(QSqlDatabase& db);
+    bool upgradeArchive(QSqlDatabase& db);
+
+    static QByteArray packContent(const QString& content, bool* compressed);
+    static QString unpackContent(const QByteArray& data, bool compressed);
+
+    static ChatArchiver* m_instance;
+
+    QTimer m_scheduleTimer;
+    bool m_running;
+};
+
+Q_DECLARE_METATYPE(ArchiveRunStats)
+
+#endif // CHATARCHIVER_H
@@ -0,0 +1,288 @@
+#include "ChatChangeNotifier.h"
+#include "DatabaseManager.h"
+#include "AsyncDatabaseManager.h"
+#include <QRandomGenerator>
+#include <QPair>
+#include <QDebug>
+
+ChatChangeNotifier* ChatChangeNotifier::m_instance = nullptr;
+const QString ChatChangeNotifier::BUS_NAME = "CyanlaChatChangeBus";
+
+// 总线协议：每个门铃是一行文本
+static const QByteArray BELL = "changed\n";
+
+ChatChangeNotifier* ChatChangeNotifier::instance()
+{
+    if (!m_instance) {
+        m_instance = new ChatChangeNotifier;
+    }
+    return m_instance;
+}
+
+ChatChangeNotifier::ChatChangeNotifier(QObject *parent)
+    : QObject(parent)
+    , m_server(nullptr)
+    , m_socket(nullptr)
+    , m_probingStaleHub(false)
+    , m_fallbackTimer(new QTimer(this))
+    , m_started(false)
+    , m_checkScheduled(false)
+    , m_checkRunning(false)
+    , m_checkPending(false)
+    , m_lastSeq(-1)
+    , m_lastDataVersion(-1)
+{
+    // 兜底检测：覆盖没有接入总线的写入方（例如其他机器通过共享目录访问同一数据库）
+    m_fallbackTimer->setInterval(2000);
+    connect(m_fallbackTimer, &QTimer::timeout, this, &ChatChangeNotifier::onFallbackTimeout);
+
+    // 本进程内的写入在 DatabaseManager 发出信号后敲门铃
+    DatabaseManager* db = DatabaseManager::instance();
+    connect(db, &DatabaseManager::newMessageReceived, this, &ChatChangeNotifier::notifyLocalChange);
+    connect(db, &DatabaseManager::sessionCreated, this, &ChatChangeNotifier::notifyLocalChange);
+    connect(db, &DatabaseManager::sessionUpdated, this, &ChatChangeNotifier::notifyLocalChange);
+}
+
+void ChatChangeNotifier::start()
+{
+    if (m_started) return;
+    m_started = true;
+
+    // 从当前最新的变更序号开始，历史变更不再通知
+    AsyncDatabaseManager::instance()->post(this, []() {
+        DatabaseManager* db = DatabaseManager::instance();
+        return qMakePair(db->getLatestChangeSeq(), db->getDataVersion());
+    }, [this](const QPair<qint64, qint64>& state) {
+        m_lastSeq = state.first;
+        m_lastDataVersion = state.second;
+        m_fallbackTimer->start();
+    });
+
+    connectToBus();
+}
+
+void ChatChangeNotifier::stop()
+{
+    m_started = false;
+    m_fallbackTimer->stop();
+
+    if (m_socket) {
+        m_socket->abort();
+        m_socket->deleteLater();
+        m_socket = nullptr;
+    }
+    for (QLocalSocket* client : m_clients) {
+        client->abort();
+        client->deleteLater();
+    }
+    m_clients.clear();
+    if (m_server) {
+        m_server->close();
+        m_server->deleteLater();
+        m_server = nullptr;
+    }
+}
+
+void ChatChangeNotifier::notifyLocalChange()
+{
+    if (!m_started) return;
+    ringBell();
+    scheduleCheck();
+}
+
+// ========== 变更检测 ==========
+
+void ChatChangeNotifier::scheduleCheck()
+{
+    // 同一轮事件循环内的多次门铃合并为一次检查
+    if (m_checkScheduled) return;
+    m_checkScheduled = true;
+    QTimer::singleShot(0, this, &ChatChangeNotifier::checkForChanges);
+}
+
+void ChatChangeNotifier::onFallbackTimeout()
+{
+    if (m_checkRunning) return;
+
+    AsyncDatabaseManager::instance()->post(this, []() {
+        return DatabaseManager::instance()->getDataVersion();
+    }, [this](qint64 dataVersion) {
+        if (dataVersion != m_lastDataVersion) {
+            m_lastDataVersion = dataVersion;
+            scheduleCheck();
+        }
+    });
+}
+
+void ChatChangeNotifier::checkForChanges()
+{
+    m_checkScheduled = false;
+
+    // 尚未拿到起始序号
+    if (m_lastSeq < 0) return;
+
+    // 上一次检查还没返回，结束后再补一次
+    if (m_checkRunning) {
+        m_checkPending = true;
+        return;
+    }
+    m_checkRunning = true;
+
+    qint64 fromSeq = m_lastSeq;
+    AsyncDatabaseManager::instance()->post(this, [fromSeq]() {
+        return DatabaseManager::instance()->getChangesSince(fromSeq);
+    }, [this](const QList<ChatChange>& changes) {
+        m_checkRunning = false;
+
+        QSet<int> messageSessions;
+        QSet<int> updatedSessions;
+        for (const ChatChange& change : changes) {
+            m_lastSeq = qMax(m_lastSeq, change.seq);
+            if (change.kind == 0) {
+                messageSessions.insert(change.sessionId);
+            } else {
+                updatedSessions.insert(change.sessionId);
+            }
+        }
+
+        for (int sessionId : messageSessions) {
+            emit messagesChanged(sessionId);
+        }
+        for (int sessionId : updatedSessions) {
+            emit sessionChanged(sessionId);
+        }
+        if (!changes.isEmpty()) {
+            emit sessionListChanged();
+        }
+
+        // 一批没读完或期间又有门铃
+        if (changes.size() >= 500 || m_checkPending) {
+            m_checkPending = false;
+            scheduleCheck();
+        }
+    });
+}
+
+// ========== 本地总线 ==========
+
+void ChatChangeNotifier::connectToBus()
+{
+    if (!m_started || m_server || m_socket) return;
+
+    m_socket = new QLocalSocket(this);
+    connect(m_socket, &QLocalSocket::connected, this, &ChatChangeNotifier::onBusConnected);
+    connect(m_socket, &QLocalSocket::disconnected, this, &ChatChangeNotifier::onBusDisconnected);
+    connect(m_socket, &QLocalSocket::errorOccurred, this, &ChatChangeNotifier::onBusError);
+    connect(m_socket, &QLocalSocket::readyRead, this, &ChatChangeNotifier::onBusReadyRead);
+    m_socket->connectToServer(BUS_NAME);
+}
+
+void ChatChangeNotifier::onBusConnected()
+{
+    m_probingStaleHub = false;
+    qDebug() << "ChatChangeNotifier: 已连接到变更总线";
+}
+
+void ChatChangeNotifier::onBusDisconnected()
+{
+    if (!m_socket) return;
+
+    m_socket->deleteLater();
+    m_socket = nullptr;
+
+    // hub 实例退出：随机退避后重新连接，连不上的实例接任 hub
+    int delay = 100 + QRandomGenerator::global()->bounded(400);
+    QTimer::singleShot(delay, this, &ChatChangeNotifier::connectToBus);
+}
+
+void ChatChangeNotifier::onBusError()
+{
+    if (!m_socket || m_socket->state() == QLocalSocket::ConnectedState) return;
+
+    // 连接失败，说明当前没有 hub
+    m_socket->deleteLater();
+    m_socket = nullptr;
+    becomeHub();
+}
+
+void ChatChangeNotifier::becomeHub()
+{
+    if (!m_started || m_server) return;
+
+    QLocalServer* server = new QLocalServer(this);
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+
+    if (!server->listen(BUS_NAME)) {
+        server->deleteLater();
+
+        if (!m_probingStaleHub) {
+            // 名字被占用：可能刚有别的实例成为 hub，再尝试连接一次
+            m_probingStaleHub = true;
+            connectToBus();
+            return;
+        }
+
+        // 仍然连不上，视为上次崩溃遗留的 socket 文件
+        QLocalServer::removeServer(BUS_NAME);
+        m_probingStaleHub = false;
+        server = new QLocalServer(this);
+        server->setSocketOptions(QLocalServer::UserAccessOption);
+        if (!server->listen(BUS_NAME)) {
+            // 总线不可用时仍有 data_version 兜底
+            qWarning() << "ChatChangeNotifier: 无法创建变更总线:" << server->errorString();
+            server->deleteLater();
+            return;
+        }
+    }
+
+    m_server = server;
+    m_probingStaleHub = false;
+    connect(m_server, &QLocalServer::newConnection, this, &ChatChangeNotifier::onNewBusClient);
+    qDebug() << "ChatChangeNotifier: 本实例成为变更总线 hub";
+}
+
+void ChatChangeNotifier::onNewBusClient()
+{
+    while (m_server && m_server->hasPendingConnections()) {
+        QLocalSocket* client = m_server->nextPendingConnection();
+        m_clients.append(client);
+
+        connect(client, &QLocalSocket::readyRead, this, &ChatChangeNotifier::onBusReadyRead);
+        connect(client, &QLocalSocket::disconnected, this, [this, client]() {
+            m_clients.removeAll(client);
+            client->deleteLater();
+        });
+    }
+}
+
+void ChatChangeNotifier::onBusReadyRead()
+{
+    QLocalSocket* source = qobject_cast<QLocalSocket*>(sender());
+    if (!source) return;
+
+    bool rang = false;
+    while (source->canReadLine()) {
+        source->readLine();
+        rang = true;
+    }
+    if (!rang) return;
+
+    // hub 负责把门铃转发给其他客户端
+    if (m_server) {
+        ringBell(source);
+    }
+    scheduleCheck();
+}
+
+void ChatChangeNotifier::ringBell(QLocalSocket* except)
+{
+    if (m_server) {
+        for (QLocalSocket* client : m_clients) {
+            if (client != except) {
+                client->write(BELL);
+            }
+        }
+    } else if (m_socket && m_socket->state() == QLocalSocket::ConnectedState) {
+        m_socket->write(BELL);
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef CHATCHANGENOTIFIER_H
+#define CHATCHANGENOTIFIER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QList>
+#include <QSet>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+// 聊天变更通知：
+// - 本机所有实例通过 QLocalServer/QLocalSocket 组成一条“门铃”总线，
+//   任一实例写入消息/会话后敲门铃，其他实例立即去读取变更；
+// - 变更内容以数据库 chat_changes 表为准，只读取上次序号之后的增量；
+// - 兜底定时器只检查 PRAGMA data_version，没有变化时不读取任何表。
+class ChatChangeNotifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ChatChangeNotifier* instance();
+
+    void start();
+    void stop();
+
+    // 本实例写入后调用，通知总线上的其他实例
+    void notifyLocalChange();
+
+    bool isHub() const { return m_server != nullptr; }
+
+signals:
+    // 某个会话有新消息
+    void messagesChanged(int sessionId);
+    // 某个会话的状态/负责人发生变化（包括新建）
+    void sessionChanged(int sessionId);
+    // 会话列表需要刷新（每批变更只发一次）
+    void sessionListChanged();
+
+private slots:
+    void checkForChanges();
+    void onFallbackTimeout();
+    void onBusConnected();
+    void onBusDisconnected();
+    void onBusError();
+    void onBusReadyRead();
+    void onNewBusClient();
+
+private:
+    explicit ChatChangeNotifier(QObject *parent = nullptr);
+
+    void connectToBus();
+    void becomeHub();
+    void scheduleCheck();
+    void ringBell(QLocalSocket* except = nullptr);
+
+    static ChatChangeNotifier* m_instance;
+    static const QString BUS_NAME;
+
+    // 总线
+    QLocalServer* m_server;          // 作为 hub 时非空
+    QLocalSocket* m_socket;          // 作为客户端时非空
+    QList<QLocalSocket*> m_clients;  // hub 已连接的客户端
+    bool m_probingStaleHub;
+
+    // 变更检测
+    QTimer* m_fallbackTimer;
+    bool m_started;
+    bool m_checkScheduled;
+    bool m_checkRunning;
+    bool m_checkPending;
+    qint64 m_lastSeq;
+    qint64 m_lastDataVersion;
+};
+
+#endif // CHATCHANGENOTIFIER_H
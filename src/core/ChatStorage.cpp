@@ -1,15 +1,34 @@
 #include "ChatStorage.h"
-#include <QUuid>
+#include "SchemaMigrator.h"
+#include "StorageManager.h"
+#include "FullTextSearch.h"
+#include "RetentionManager.h"
+#include "EpochTime.h"
 #include <QFile>
 #include <QTextStream>
+#include <QElapsedTimer>
+#include <algorithm>
+#ifdef CYANLA_HAVE_ZLIB
+#include <zlib.h>
+#endif
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 #include <QStringConverter>
 #endif
 
 // 静态常量定义
-const QString ChatStorage::DATABASE_NAME = "chat_history.db";
 const QString ChatStorage::TABLE_NAME = "chat_messages";
-const int ChatStorage::DATABASE_VERSION = 1;
+const QString ChatStorage::LIVE_VIEW = "chat_messages_live";
+const int ChatStorage::DATABASE_VERSION = 5;
+
+namespace {
+// 消息 m 是否被墓碑 t 命中；max_message_id 保证墓碑之后写入的消息不受影响
+const QString TOMBSTONE_MATCH =
+    "m.id <= t.max_message_id AND ("
+    "t.kind = 0 "
+    "OR (t.kind = 1 AND ((m.sender = t.user1 AND m.receiver = t.user2) "
+    "                 OR (m.sender = t.user2 AND m.receiver = t.user1))) "
+    "OR (t.kind = 2 AND m.timestamp BETWEEN t.start_time AND t.end_time))";
+}
 
 // Message 结构体实现
 QJsonObject Message::toJson() const
@@ -34,22 +53,130 @@ Message Message::fromJson(const QJsonObject &json)
     return msg;
 }
 
+namespace {
+
+// 导出文件写入器：按块缓冲写入，可选 gzip 压缩
+class ExportWriter
+{
+public:
+    explicit ExportWriter(const QString &filePath)
+        : m_file(filePath)
+        , m_compress(false)
+    {
+    }
+
+    ~ExportWriter()
+    {
+#ifdef CYANLA_HAVE_ZLIB
+        if (m_compress) {
+            deflateEnd(&m_stream);
+        }
+#endif
+    }
+
+    bool open(bool compress)
+    {
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            return false;
+        }
+
+#ifdef CYANLA_HAVE_ZLIB
+        if (compress) {
+            m_stream = z_stream();
+            // windowBits 15 + 16：输出 gzip 格式而不是裸 zlib 流
+            if (deflateInit2(&m_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                             Z_DEFAULT_STRATEGY) != Z_OK) {
+                return false;
+            }
+            m_compress = true;
+        }
+#else
+        if (compress) {
+            return false;
+        }
+#endif
+        return true;
+    }
+
+    bool write(const QByteArray &data)
+    {
+        m_buffer.append(data);
+        if (m_buffer.size() >= BUFFER_SIZE) {
+            return flush(false);
+        }
+        return true;
+    }
+
+    bool finish()
+    {
+        bool ok = flush(true);
+        m_file.close();
+        return ok;
+    }
+
+    QString errorString() const { return m_file.errorString(); }
+
+private:
+    bool flush(bool finalChunk)
+    {
+#ifdef CYANLA_HAVE_ZLIB
+        if (m_compress) {
+            m_stream.next_in = reinterpret_cast<Bytef*>(m_buffer.data());
+            m_stream.avail_in = static_cast<uInt>(m_buffer.size());
+
+            char out[BUFFER_SIZE];
+            int result = Z_OK;
+            do {
+                m_stream.next_out = reinterpret_cast<Bytef*>(out);
+                m_stream.avail_out = sizeof(out);
+                result = deflate(&m_stream, finalChunk ? Z_FINISH : Z_NO_FLUSH);
+                if (result == Z_STREAM_ERROR) {
+                    return false;
+                }
+                qint64 produced = sizeof(out) - m_stream.avail_out;
+                if (produced > 0 && m_file.write(out, produced) != produced) {
+                    return false;
+                }
+            } while (m_stream.avail_out == 0 || (finalChunk && result != Z_STREAM_END));
+
+            m_buffer.clear();
+            return true;
+        }
+#else
+        Q_UNUSED(finalChunk);
+#endif
+        bool ok = m_file.write(m_buffer) == m_buffer.size();
+        m_buffer.clear();
+        return ok;
+    }
+
+    static const int BUFFER_SIZE = 64 * 1024;
+
+    QFile m_file;
+    QByteArray m_buffer;
+    bool m_compress;
+#ifdef CYANLA_HAVE_ZLIB
+    z_stream m_stream;
+#endif
+};
+
+} // namespace
+
 // ChatStorage 实现
 ChatStorage::ChatStorage(QObject *parent)
     : QObject(parent)
-    , m_connectionName(QString("ChatStorage_%1").arg(QUuid::createUuid().toString()))
     , m_isInitialized(false)
+    , m_fullTextIndex(false)
+    , m_statements(nullptr)
 {
     qDebug() << "ChatStorage: 初始化聊天存储模块";
 }
 
 ChatStorage::~ChatStorage()
 {
-    if (m_database.isOpen()) {
-        qDebug() << "ChatStorage: 关闭数据库连接";
-        m_database.close();
-    }
-    QSqlDatabase::removeDatabase(m_connectionName);
+    // 连接由 StorageManager 持有并与其他实例共享，这里只释放自己的语句缓存
+    delete m_statements;
+    m_statements = nullptr;
 }
 
 bool ChatStorage::initialize()
@@ -62,26 +189,18 @@ bool ChatStorage::initialize()
     QString dbPath = getDatabasePath();
     qDebug() << "ChatStorage: 数据库路径:" << dbPath;
 
-    // 确保数据库目录存在
-    QDir dbDir = QFileInfo(dbPath).absoluteDir();
-    if (!dbDir.exists()) {
-        if (!dbDir.mkpath(".")) {
-            setLastError("无法创建数据库目录: " + dbDir.absolutePath());
-            return false;
-        }
-    }
+    // 当前线程上 chat_history.db 的共享连接
+    m_database = StorageManager::instance()->connection(StorageManager::ChatHistoryStore);
 
-    // 创建数据库连接
-    m_database = QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
-    m_database.setDatabaseName(dbPath);
-
-    if (!m_database.open()) {
+    if (!m_database.isOpen()) {
         setLastError("无法打开数据库: " + m_database.lastError().text());
         return false;
     }
 
     qDebug() << "ChatStorage: 数据库连接成功";
 
+    m_statements = new SqlStatementCache(m_database);
+
     // 创建表结构
     if (!createTables()) {
         return false;
@@ -94,38 +213,93 @@ bool ChatStorage::initialize()
 
 bool ChatStorage::createTables()
 {
-    QSqlQuery query(m_database);
-
-    // 创建聊天消息表
-    QString createTableSQL = QString(
-                                 "CREATE TABLE IF NOT EXISTS %1 ("
-                                 "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                                 "sender TEXT NOT NULL, "
-                                 "receiver TEXT NOT NULL, "
-                                 "message TEXT NOT NULL, "
-                                 "timestamp DATETIME NOT NULL, "
-                                 "created_at DATETIME DEFAULT CURRENT_TIMESTAMP"
-                                 ")"
-                                 ).arg(TABLE_NAME);
-
-    if (!query.exec(createTableSQL)) {
-        setLastError("创建表失败: " + query.lastError().text());
-        return false;
-    }
-
-    // 创建索引以提高查询性能
-    QStringList indexes = {
+    SchemaMigrator migrator(m_database, "ChatStorage");
+
+    // v1: 聊天消息表及基础索引
+    migrator.addMigration(1, "聊天消息表", QStringList{
+        QString(
+            "CREATE TABLE IF NOT EXISTS %1 ("
+            "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "sender TEXT NOT NULL, "
+            "receiver TEXT NOT NULL, "
+            "message TEXT NOT NULL, "
+            "timestamp DATETIME NOT NULL, "
+            "created_at DATETIME DEFAULT CURRENT_TIMESTAMP"
+            ")"
+            ).arg(TABLE_NAME),
         QString("CREATE INDEX IF NOT EXISTS idx_sender ON %1(sender)").arg(TABLE_NAME),
         QString("CREATE INDEX IF NOT EXISTS idx_receiver ON %1(receiver)").arg(TABLE_NAME),
         QString("CREATE INDEX IF NOT EXISTS idx_timestamp ON %1(timestamp)").arg(TABLE_NAME),
         QString("CREATE INDEX IF NOT EXISTS idx_sender_receiver ON %1(sender, receiver)").arg(TABLE_NAME)
-    };
-
-    for (const QString &indexSQL : indexes) {
-        if (!query.exec(indexSQL)) {
-            qWarning() << "ChatStorage: 创建索引警告:" << query.lastError().text();
-            // 索引创建失败不影响主要功能，只记录警告
+    });
+
+    // v2: 游标分页按 (timestamp, id) 排序，用户对之间的历史需要 (sender, receiver, timestamp) 索引
+    migrator.addMigration(2, "游标分页索引", QStringList{
+        QString("CREATE INDEX IF NOT EXISTS idx_sender_receiver_time ON %1(sender, receiver, timestamp)").arg(TABLE_NAME),
+        "DROP INDEX IF EXISTS idx_sender_receiver"
+    });
+
+    // v3: 消息全文索引（trigram 分词，中文按子串匹配）；SQLite 不支持时跳过，检索退回 LIKE，
+    // 之后每次启动由 FullTextSearch::ensureIndex 检查并补建
+    migrator.addMigration(3, "消息全文索引", [](QSqlDatabase &database) {
+        if (!FullTextSearch::isTrigramAvailable(database)) {
+            qWarning() << "ChatStorage: SQLite 不支持 FTS5 trigram，消息检索将使用 LIKE";
+            return true;
         }
+        return FullTextSearch::createIndex(database, TABLE_NAME, "message", TABLE_NAME + "_fts");
+    });
+
+    // v4: 批量删除改为墓碑 + 后台分块清除，读取经过排除墓碑的视图
+    migrator.addMigration(4, "删除墓碑", QStringList{
+        "CREATE TABLE IF NOT EXISTS chat_tombstones ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "kind INTEGER NOT NULL, "
+        "user1 TEXT, "
+        "user2 TEXT, "
+        "start_time DATETIME, "
+        "end_time DATETIME, "
+        "max_message_id INTEGER NOT NULL, "
+        "created_at DATETIME DEFAULT CURRENT_TIMESTAMP"
+        ")",
+        QString("CREATE VIEW IF NOT EXISTS %1 AS "
+                "SELECT * FROM %2 m "
+                "WHERE NOT EXISTS (SELECT 1 FROM chat_tombstones t WHERE %3)")
+            .arg(LIVE_VIEW, TABLE_NAME, TOMBSTONE_MATCH)
+    });
+
+    // v5: 时间列改为纪元毫秒整数。timestamp 和墓碑的时间范围原先绑定 QDateTime（本地时间文本），
+    // created_at 是 CURRENT_TIMESTAMP（UTC 文本）
+    migrator.addMigration(5, "时间列改为纪元毫秒", [](QSqlDatabase &database) {
+        struct TimeColumn {
+            QString table;
+            QString column;
+            EpochTime::TextZone zone;
+        };
+        const QList<TimeColumn> columns = {
+            {TABLE_NAME, "timestamp", EpochTime::LocalText},
+            {TABLE_NAME, "created_at", EpochTime::UtcText},
+            {"chat_tombstones", "start_time", EpochTime::LocalText},
+            {"chat_tombstones", "end_time", EpochTime::LocalText},
+            {"chat_tombstones", "created_at", EpochTime::UtcText}
+        };
+        for (const TimeColumn &column : columns) {
+            if (EpochTime::convertTextColumn(database, column.table, column.column, column.zone) < 0) {
+                return false;
+            }
+        }
+        return true;
+    });
+
+    if (!migrator.migrate()) {
+        setLastError("数据库迁移失败: " + migrator.lastError());
+        return false;
+    }
+
+    m_fullTextIndex = FullTextSearch::ensureIndex(m_database, TABLE_NAME, "message", TABLE_NAME + "_fts");
+
+    if (migrator.currentVersion() != DATABASE_VERSION) {
+        qWarning() << QString("ChatStorage: 数据库版本 %1 与程序版本 %2 不一致")
+                          .arg(migrator.currentVersion()).arg(DATABASE_VERSION);
     }
 
     qDebug() << "ChatStorage: 表结构创建完成";
@@ -134,14 +308,7 @@ bool ChatStorage::createTables()
 
 QString ChatStorage::getDatabasePath()
 {
-    QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    if (dataPath.isEmpty()) {
-        dataPath = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
-        dataPath += "/Cyanla";
-    }
-
-    QDir().mkpath(dataPath);
-    return dataPath + "/" + DATABASE_NAME;
+    return StorageManager::instance()->databasePath(StorageManager::ChatHistoryStore);
 }
 
 bool ChatStorage::insertMessage(const QString &sender, const QString &receiver,
@@ -151,16 +318,18 @@ bool ChatStorage::insertMessage(const QString &sender, const QString &receiver,
         return false;
     }
 
-    QSqlQuery query(m_database);
-    query.prepare(QString(
-                      "INSERT INTO %1 (sender, receiver, message, timestamp) "
-                      "VALUES (?, ?, ?, ?)"
-                      ).arg(TABLE_NAME));
+    static const QString sql = QString(
+        "INSERT INTO %1 (sender, receiver, message, timestamp, created_at) "
+        "VALUES (?, ?, ?, ?, ?)"
+        ).arg(TABLE_NAME);
+
+    QSqlQuery& query = m_statements->prepared(sql);
 
     query.addBindValue(sender);
     query.addBindValue(receiver);
     query.addBindValue(message);
-    query.addBindValue(timestamp);
+    query.addBindValue(EpochTime::toMs(timestamp));
+    query.addBindValue(EpochTime::nowMs());
 
     if (!query.exec()) {
         setLastError("插入消息失败: " + query.lastError().text());
@@ -186,60 +355,130 @@ bool ChatStorage::insertMessage(const Message &msg)
     return insertMessage(msg.sender, msg.receiver, msg.message, msg.timestamp);
 }
 
+int ChatStorage::insertMessages(const QList<Message> &messages)
+{
+    if (!checkDatabaseConnection()) {
+        return -1;
+    }
+
+    if (messages.isEmpty()) {
+        return 0;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 整批一次提交，只需一次 fsync
+    if (!m_database.transaction()) {
+        setLastError("开启批量插入事务失败: " + m_database.lastError().text());
+        return -1;
+    }
+
+    static const QString sql = QString(
+        "INSERT INTO %1 (sender, receiver, message, timestamp, created_at) "
+        "VALUES (?, ?, ?, ?, ?)"
+        ).arg(TABLE_NAME);
+
+    QSqlQuery& query = m_statements->prepared(sql);
+    const qint64 createdAt = EpochTime::nowMs();
+
+    QList<Message> inserted;
+    inserted.reserve(messages.size());
+
+    for (const Message &msg : messages) {
+        query.addBindValue(msg.sender);
+        query.addBindValue(msg.receiver);
+        query.addBindValue(msg.message);
+        query.addBindValue(EpochTime::toMs(msg.timestamp));
+        query.addBindValue(createdAt);
+
+        if (!query.exec()) {
+            QString error = query.lastError().text();
+            m_database.rollback();
+            setLastError(QString("批量插入失败（第 %1 条）: %2").arg(inserted.size() + 1).arg(error));
+            return -1;
+        }
+
+        Message row = msg;
+        row.id = query.lastInsertId().toInt();
+        inserted.append(row);
+    }
+
+    if (!m_database.commit()) {
+        QString error = m_database.lastError().text();
+        m_database.rollback();
+        setLastError("提交批量插入失败: " + error);
+        return -1;
+    }
+
+    qint64 elapsedMs = timer.elapsed();
+    m_lastBulkInsertStats.rows = inserted.size();
+    m_lastBulkInsertStats.elapsedMs = elapsedMs;
+    m_lastBulkInsertStats.rowsPerSecond = inserted.size() * 1000.0 / qMax<qint64>(1, elapsedMs);
+
+    qDebug() << QString("ChatStorage: 批量插入 %1 条消息, 耗时 %2 ms, %3 行/秒")
+                    .arg(inserted.size())
+                    .arg(elapsedMs)
+                    .arg(m_lastBulkInsertStats.rowsPerSecond, 0, 'f', 0);
+
+    emit messagesInserted(inserted);
+    return inserted.size();
+}
+
 QList<Message> ChatStorage::getAllMessages()
 {
-    QString queryString = QString("SELECT id, sender, receiver, message, timestamp FROM %1 ORDER BY timestamp ASC").arg(TABLE_NAME);
+    static const QString queryString = QString("SELECT id, sender, receiver, message, timestamp FROM %1 ORDER BY timestamp ASC").arg(LIVE_VIEW);
     return executeMessageQuery(queryString);
 }
 
 QList<Message> ChatStorage::getMessagesBetweenUsers(const QString &user1, const QString &user2)
 {
-    QString queryString = QString(
+    static const QString queryString = QString(
                               "SELECT id, sender, receiver, message, timestamp FROM %1 "
                               "WHERE (sender = ? AND receiver = ?) OR (sender = ? AND receiver = ?) "
                               "ORDER BY timestamp ASC"
-                              ).arg(TABLE_NAME);
+                              ).arg(LIVE_VIEW);
 
     return executeMessageQuery(queryString, {user1, user2, user2, user1});
 }
 
 QList<Message> ChatStorage::getMessagesByTimeRange(const QDateTime &startTime, const QDateTime &endTime)
 {
-    QString queryString = QString(
+    static const QString queryString = QString(
                               "SELECT id, sender, receiver, message, timestamp FROM %1 "
                               "WHERE timestamp BETWEEN ? AND ? "
                               "ORDER BY timestamp ASC"
-                              ).arg(TABLE_NAME);
+                              ).arg(LIVE_VIEW);
 
-    return executeMessageQuery(queryString, {startTime, endTime});
+    return executeMessageQuery(queryString, {EpochTime::toMs(startTime), EpochTime::toMs(endTime)});
 }
 
 QList<Message> ChatStorage::getMessagesBySender(const QString &sender)
 {
-    QString queryString = QString(
+    static const QString queryString = QString(
                               "SELECT id, sender, receiver, message, timestamp FROM %1 "
                               "WHERE sender = ? ORDER BY timestamp ASC"
-                              ).arg(TABLE_NAME);
+                              ).arg(LIVE_VIEW);
 
     return executeMessageQuery(queryString, {sender});
 }
 
 QList<Message> ChatStorage::getMessagesByReceiver(const QString &receiver)
 {
-    QString queryString = QString(
+    static const QString queryString = QString(
                               "SELECT id, sender, receiver, message, timestamp FROM %1 "
                               "WHERE receiver = ? ORDER BY timestamp ASC"
-                              ).arg(TABLE_NAME);
+                              ).arg(LIVE_VIEW);
 
     return executeMessageQuery(queryString, {receiver});
 }
 
 QList<Message> ChatStorage::getMessagesWithPagination(int offset, int limit)
 {
-    QString queryString = QString(
+    static const QString queryString = QString(
                               "SELECT id, sender, receiver, message, timestamp FROM %1 "
                               "ORDER BY timestamp DESC LIMIT ? OFFSET ?"
-                              ).arg(TABLE_NAME);
+                              ).arg(LIVE_VIEW);
 
     return executeMessageQuery(queryString, {limit, offset});
 }
@@ -247,15 +486,210 @@ QList<Message> ChatStorage::getMessagesWithPagination(int offset, int limit)
 QList<Message> ChatStorage::getMessagesBetweenUsersWithPagination(const QString &user1, const QString &user2,
                                                                   int offset, int limit)
 {
-    QString queryString = QString(
+    static const QString queryString = QString(
                               "SELECT id, sender, receiver, message, timestamp FROM %1 "
                               "WHERE (sender = ? AND receiver = ?) OR (sender = ? AND receiver = ?) "
                               "ORDER BY timestamp DESC LIMIT ? OFFSET ?"
-                              ).arg(TABLE_NAME);
+                              ).arg(LIVE_VIEW);
 
     return executeMessageQuery(queryString, {user1, user2, user2, user1, limit, offset});
 }
 
+QList<Message> ChatStorage::getMessagesBefore(int messageId, int limit)
+{
+    // 以 (timestamp, id) 为游标取一页：timestamp <= 游标 走 idx_timestamp 范围扫描，
+    // 每页开销只和页大小有关；messageId <= 0 表示从最新消息开始。
+    // 游标行在基表中查找，页面加载后它被删除（打上墓碑）时分页仍能继续
+
+    static const QString latestQuery = QString(
+        "SELECT id, sender, receiver, message, timestamp FROM %1 "
+        "ORDER BY timestamp DESC, id DESC LIMIT ?"
+        ).arg(LIVE_VIEW);
+    static const QString beforeQuery = QString(
+        "SELECT id, sender, receiver, message, timestamp FROM %1 "
+        "WHERE timestamp <= (SELECT timestamp FROM %2 WHERE id = ?) "
+        "AND (timestamp, id) < (SELECT timestamp, id FROM %2 WHERE id = ?) "
+        "ORDER BY timestamp DESC, id DESC LIMIT ?"
+        ).arg(LIVE_VIEW, TABLE_NAME);
+
+    QList<Message> messages = messageId > 0
+        ? executeMessageQuery(beforeQuery, {messageId, messageId, limit})
+        : executeMessageQuery(latestQuery, {limit});
+
+    std::reverse(messages.begin(), messages.end());
+    return messages;
+}
+
+QList<Message> ChatStorage::getMessagesAfter(int messageId, int limit)
+{
+    static const QString firstQuery = QString(
+        "SELECT id, sender, receiver, message, timestamp FROM %1 "
+        "ORDER BY timestamp ASC, id ASC LIMIT ?"
+        ).arg(LIVE_VIEW);
+    static const QString afterQuery = QString(
+        "SELECT id, sender, receiver, message, timestamp FROM %1 "
+        "WHERE timestamp >= (SELECT timestamp FROM %2 WHERE id = ?) "
+        "AND (timestamp, id) > (SELECT timestamp, id FROM %2 WHERE id = ?) "
+        "ORDER BY timestamp ASC, id ASC LIMIT ?"
+        ).arg(LIVE_VIEW, TABLE_NAME);
+
+    return messageId > 0
+        ? executeMessageQuery(afterQuery, {messageId, messageId, limit})
+        : executeMessageQuery(firstQuery, {limit});
+}
+
+QList<Message> ChatStorage::getMessagesBetweenUsersBefore(const QString &user1, const QString &user2,
+                                                          int messageId, int limit)
+{
+    // 两个方向分别在 (sender, receiver, timestamp) 索引上取一页再合并，
+    // 避免 OR 条件退化为扫描整段历史
+    static const QString latestQuery = QString(
+        "SELECT * FROM ("
+        "  SELECT id, sender, receiver, message, timestamp FROM %1 "
+        "  WHERE sender = ? AND receiver = ? "
+        "  ORDER BY timestamp DESC, id DESC LIMIT ?) "
+        "UNION ALL "
+        "SELECT * FROM ("
+        "  SELECT id, sender, receiver, message, timestamp FROM %1 "
+        "  WHERE sender = ? AND receiver = ? "
+        "  ORDER BY timestamp DESC, id DESC LIMIT ?) "
+        "ORDER BY timestamp DESC, id DESC LIMIT ?"
+        ).arg(LIVE_VIEW);
+    static const QString beforeQuery = QString(
+        "SELECT * FROM ("
+        "  SELECT id, sender, receiver, message, timestamp FROM %1 "
+        "  WHERE sender = ? AND receiver = ? "
+        "  AND timestamp <= (SELECT timestamp FROM %2 WHERE id = ?) "
+        "  AND (timestamp, id) < (SELECT timestamp, id FROM %2 WHERE id = ?) "
+        "  ORDER BY timestamp DESC, id DESC LIMIT ?) "
+        "UNION ALL "
+        "SELECT * FROM ("
+        "  SELECT id, sender, receiver, message, timestamp FROM %1 "
+        "  WHERE sender = ? AND receiver = ? "
+        "  AND timestamp <= (SELECT timestamp FROM %2 WHERE id = ?) "
+        "  AND (timestamp, id) < (SELECT timestamp, id FROM %2 WHERE id = ?) "
+        "  ORDER BY timestamp DESC, id DESC LIMIT ?) "
+        "ORDER BY timestamp DESC, id DESC LIMIT ?"
+        ).arg(LIVE_VIEW, TABLE_NAME);
+
+    QList<Message> messages = messageId > 0
+        ? executeMessageQuery(beforeQuery, {user1, user2, messageId, messageId, limit,
+                                            user2, user1, messageId, messageId, limit, limit})
+        : executeMessageQuery(latestQuery, {user1, user2, limit, user2, user1, limit, limit});
+
+    std::reverse(messages.begin(), messages.end());
+    return messages;
+}
+
+QList<Message> ChatStorage::getMessagesBetweenUsersAfter(const QString &user1, const QString &user2,
+                                                         int messageId, int limit)
+{
+    static const QString firstQuery = QString(
+        "SELECT * FROM ("
+        "  SELECT id, sender, receiver, message, timestamp FROM %1 "
+        "  WHERE sender = ? AND receiver = ? "
+        "  ORDER BY timestamp ASC, id ASC LIMIT ?) "
+        "UNION ALL "
+        "SELECT * FROM ("
+        "  SELECT id, sender, receiver, message, timestamp FROM %1 "
+        "  WHERE sender = ? AND receiver = ? "
+        "  ORDER BY timestamp ASC, id ASC LIMIT ?) "
+        "ORDER BY timestamp ASC, id ASC LIMIT ?"
+        ).arg(LIVE_VIEW);
+    static const QString afterQuery = QString(
+        "SELECT * FROM ("
+        "  SELECT id, sender, receiver, message, timestamp FROM %1 "
+        "  WHERE sender = ? AND receiver = ? "
+        "  AND timestamp >= (SELECT timestamp FROM %2 WHERE id = ?) "
+        "  AND (timestamp, id) > (SELECT timestamp, id FROM %2 WHERE id = ?) "
+        "  ORDER BY timestamp ASC, id ASC LIMIT ?) "
+        "UNION ALL "
+        "SELECT * FROM ("
+        "  SELECT id, sender, receiver, message, timestamp FROM %1 "
+        "  WHERE sender = ? AND receiver = ? "
+        "  AND timestamp >= (SELECT timestamp FROM %2 WHERE id = ?) "
+        "  AND (timestamp, id) > (SELECT timestamp, id FROM %2 WHERE id = ?) "
+        "  ORDER BY timestamp ASC, id ASC LIMIT ?) "
+        "ORDER BY timestamp ASC, id ASC LIMIT ?"
+        ).arg(LIVE_VIEW, TABLE_NAME);
+
+    return messageId > 0
+        ? executeMessageQuery(afterQuery, {user1, user2, messageId, messageId, limit,
+                                           user2, user1, messageId, messageId, limit, limit})
+        : executeMessageQuery(firstQuery, {user1, user2, limit, user2, user1, limit, limit});
+}
+
+QList<MessageSearchResult> ChatStorage::searchMessages(const QString &text, int limit)
+{
+    QList<MessageSearchResult> results;
+
+    const QStringList terms = FullTextSearch::splitTerms(text);
+    if (terms.isEmpty() || !checkDatabaseConnection()) {
+        return results;
+    }
+
+    // 能走索引的词用 MATCH，短词在命中结果上再用 LIKE 过滤
+    const QStringList indexedTerms = m_fullTextIndex ? FullTextSearch::indexedTerms(terms) : QStringList();
+    const QStringList likeTerms = indexedTerms.isEmpty() ? terms : FullTextSearch::shortTerms(terms);
+
+    QStringList conditions;
+    for (int i = 0; i < likeTerms.size(); ++i) {
+        conditions.append("m.message LIKE ? ESCAPE '\\'");
+    }
+
+    const QString ftsTable = TABLE_NAME + "_fts";
+    QSqlQuery query(m_database);
+    if (!indexedTerms.isEmpty()) {
+        query.prepare(QString(
+                          "SELECT m.id, m.sender, m.receiver, m.message, m.timestamp, "
+                          "snippet(%2, 0, ?, ?, '…', 24), bm25(%2) AS rank "
+                          "FROM %2 JOIN %1 m ON m.id = %2.rowid "
+                          "WHERE %2 MATCH ? %3 "
+                          "ORDER BY rank LIMIT ?"
+                          ).arg(LIVE_VIEW, ftsTable,
+                               conditions.isEmpty() ? QString() : "AND " + conditions.join(" AND ")));
+        query.addBindValue(QString(FullTextSearch::HIGHLIGHT_BEGIN));
+        query.addBindValue(QString(FullTextSearch::HIGHLIGHT_END));
+        query.addBindValue(FullTextSearch::matchExpression(indexedTerms));
+    } else {
+        // 没有可用的索引词时按时间倒序扫描，命中足够条数即停止
+        query.prepare(QString(
+                          "SELECT m.id, m.sender, m.receiver, m.message, m.timestamp FROM %1 m "
+                          "WHERE %2 ORDER BY m.timestamp DESC, m.id DESC LIMIT ?"
+                          ).arg(LIVE_VIEW, conditions.join(" AND ")));
+    }
+
+    for (const QString &term : likeTerms) {
+        query.addBindValue(FullTextSearch::likePattern(term));
+    }
+    query.addBindValue(limit);
+
+    if (!query.exec()) {
+        setLastError("检索消息失败: " + query.lastError().text());
+        return results;
+    }
+
+    while (query.next()) {
+        MessageSearchResult result;
+        result.message.id = query.value(0).toInt();
+        result.message.sender = query.value(1).toString();
+        result.message.receiver = query.value(2).toString();
+        result.message.message = query.value(3).toString();
+        result.message.timestamp = EpochTime::fromColumn(query.value(4));
+        if (!indexedTerms.isEmpty()) {
+            result.snippetHtml = FullTextSearch::snippetToHtml(query.value(5).toString());
+            result.score = -query.value(6).toDouble();
+        } else {
+            result.snippetHtml = FullTextSearch::makeSnippet(result.message.message, terms);
+        }
+        results.append(result);
+    }
+
+    // 检索词可能包含访客的个人信息，日志中只记录词数
+    qDebug() << QString("ChatStorage: 检索 %1 个词返回 %2 条消息").arg(terms.size()).arg(results.size());
+    return results;
+}
+
 bool ChatStorage::deleteMessage(int messageId)
 {
     if (!checkDatabaseConnection()) {
@@ -284,66 +718,108 @@ bool ChatStorage::deleteMessage(int messageId)
 
 bool ChatStorage::deleteMessagesBetweenUsers(const QString &user1, const QString &user2)
 {
-    if (!checkDatabaseConnection()) {
+    if (!addTombstone(1, {user1, user2, QVariant(), QVariant()})) {
+        setLastError("删除用户间消息失败: " + m_lastError);
         return false;
     }
 
-    QSqlQuery query(m_database);
-    query.prepare(QString(
-                      "DELETE FROM %1 WHERE (sender = ? AND receiver = ?) OR (sender = ? AND receiver = ?)"
-                      ).arg(TABLE_NAME));
+    qDebug() << QString("ChatStorage: 已标记删除用户间消息, %1 <-> %2").arg(user1).arg(user2);
+    return true;
+}
 
-    query.addBindValue(user1);
-    query.addBindValue(user2);
-    query.addBindValue(user2);
-    query.addBindValue(user1);
+bool ChatStorage::deleteMessagesByTimeRange(const QDateTime &startTime, const QDateTime &endTime)
+{
+    if (!addTombstone(2, {QVariant(), QVariant(), EpochTime::toMs(startTime), EpochTime::toMs(endTime)})) {
+        setLastError("按时间范围删除消息失败: " + m_lastError);
+        return false;
+    }
 
-    if (!query.exec()) {
-        setLastError("删除用户间消息失败: " + query.lastError().text());
+    qDebug() << "ChatStorage: 已标记删除时间范围内的消息";
+    return true;
+}
+
+bool ChatStorage::deleteAllMessages()
+{
+    if (!addTombstone(0, {QVariant(), QVariant(), QVariant(), QVariant()})) {
+        setLastError("清空所有消息失败: " + m_lastError);
         return false;
     }
 
-    int rowsAffected = query.numRowsAffected();
-    qDebug() << QString("ChatStorage: 删除用户间消息成功, %1 <-> %2, 删除 %3 条记录")
-                    .arg(user1).arg(user2).arg(rowsAffected);
+    qDebug() << "ChatStorage: 已标记清空所有消息";
     return true;
 }
 
-bool ChatStorage::deleteMessagesByTimeRange(const QDateTime &startTime, const QDateTime &endTime)
+bool ChatStorage::addTombstone(int kind, const QVariantList &values)
 {
     if (!checkDatabaseConnection()) {
         return false;
     }
 
+    // 只写一行，不论命中多少消息都立即返回
     QSqlQuery query(m_database);
-    query.prepare(QString("DELETE FROM %1 WHERE timestamp BETWEEN ? AND ?").arg(TABLE_NAME));
-    query.addBindValue(startTime);
-    query.addBindValue(endTime);
+    query.prepare(QString(
+                      "INSERT INTO chat_tombstones (kind, user1, user2, start_time, end_time, max_message_id, created_at) "
+                      "SELECT ?, ?, ?, ?, ?, COALESCE(MAX(id), 0), ? FROM %1"
+                      ).arg(TABLE_NAME));
+    query.addBindValue(kind);
+    for (const QVariant &value : values) {
+        query.addBindValue(value);
+    }
+    query.addBindValue(EpochTime::nowMs());
 
     if (!query.exec()) {
-        setLastError("按时间范围删除消息失败: " + query.lastError().text());
+        m_lastError = query.lastError().text();
         return false;
     }
 
-    int rowsAffected = query.numRowsAffected();
-    qDebug() << QString("ChatStorage: 按时间删除消息成功, 删除 %1 条记录").arg(rowsAffected);
+    RetentionManager::instance()->requestPurge();
     return true;
 }
 
-bool ChatStorage::deleteAllMessages()
+int ChatStorage::purgeTombstones(QSqlDatabase &database, int maxRows)
 {
-    if (!checkDatabaseConnection()) {
-        return false;
+    QSqlQuery query(database);
+
+    // chat_history.db 还没有被 ChatStorage 初始化过时没有墓碑表
+    if (!query.exec("SELECT id FROM chat_tombstones ORDER BY id LIMIT 1")) {
+        return 0;
     }
+    if (!query.next()) {
+        return 0;
+    }
+    const int tombstoneId = query.value(0).toInt();
+    query.finish();
 
-    QSqlQuery query(m_database);
-    if (!query.exec(QString("DELETE FROM %1").arg(TABLE_NAME))) {
-        setLastError("清空所有消息失败: " + query.lastError().text());
-        return false;
+    // 每次只删一块，单个写事务的时长与墓碑命中多少消息无关
+    query.prepare(QString(
+                      "DELETE FROM %1 WHERE id IN ("
+                      "SELECT m.id FROM %1 m, chat_tombstones t "
+                      "WHERE t.id = ? AND %2 LIMIT ?)"
+                      ).arg(TABLE_NAME, TOMBSTONE_MATCH));
+    query.addBindValue(tombstoneId);
+    query.addBindValue(maxRows);
+    if (!query.exec()) {
+        qWarning() << "ChatStorage: 清除墓碑消息失败:" << query.lastError().text();
+        return -1;
     }
 
-    qDebug() << "ChatStorage: 清空所有消息成功";
-    return true;
+    const int purged = query.numRowsAffected();
+    if (purged < maxRows) {
+        query.prepare("DELETE FROM chat_tombstones WHERE id = ?");
+        query.addBindValue(tombstoneId);
+        query.exec();
+        qDebug() << "ChatStorage: 墓碑" << tombstoneId << "清除完毕";
+    }
+    return purged;
+}
+
+int ChatStorage::pendingTombstones(QSqlDatabase &database)
+{
+    QSqlQuery query(database);
+    if (query.exec("SELECT COUNT(*) FROM chat_tombstones") && query.next()) {
+        return query.value(0).toInt();
+    }
+    return 0;
 }
 
 int ChatStorage::getTotalMessageCount()
@@ -353,7 +829,7 @@ int ChatStorage::getTotalMessageCount()
     }
 
     QSqlQuery query(m_database);
-    if (!query.exec(QString("SELECT COUNT(*) FROM %1").arg(TABLE_NAME))) {
+    if (!query.exec(QString("SELECT COUNT(*) FROM %1").arg(LIVE_VIEW))) {
         setLastError("获取消息总数失败: " + query.lastError().text());
         return -1;
     }
@@ -373,7 +849,7 @@ int ChatStorage::getMessageCount(const QString &sender, const QString &receiver)
     QSqlQuery query(m_database);
     query.prepare(QString(
                       "SELECT COUNT(*) FROM %1 WHERE (sender = ? AND receiver = ?) OR (sender = ? AND receiver = ?)"
-                      ).arg(TABLE_NAME));
+                      ).arg(LIVE_VIEW));
 
     query.addBindValue(sender);
     query.addBindValue(receiver);
@@ -398,7 +874,7 @@ QStringList ChatStorage::getAllUsers()
     }
 
     QSqlQuery query(m_database);
-    if (!query.exec(QString("SELECT DISTINCT sender FROM %1 UNION SELECT DISTINCT receiver FROM %1").arg(TABLE_NAME))) {
+    if (!query.exec(QString("SELECT DISTINCT sender FROM %1 UNION SELECT DISTINCT receiver FROM %1").arg(LIVE_VIEW))) {
         setLastError("获取用户列表失败: " + query.lastError().text());
         return QStringList();
     }
@@ -451,6 +927,155 @@ bool ChatStorage::exportToFile(const QString &filePath, const QList<Message> &me
     return true;
 }
 
+bool ChatStorage::exportAllToFile(const QString &filePath, ExportFormat format, bool compress)
+{
+    if (!checkDatabaseConnection()) {
+        return false;
+    }
+
+    if (compress && !isCompressionSupported()) {
+        setLastError("当前版本未启用 zlib，无法导出压缩文件");
+        return false;
+    }
+
+    qint64 total = getTotalMessageCount();
+    if (total < 0) {
+        return false;
+    }
+
+    ExportWriter writer(filePath);
+    if (!writer.open(compress)) {
+        setLastError("无法打开导出文件: " + filePath);
+        return false;
+    }
+
+    // 只进游标：驱动不缓存已读过的行
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    if (!query.exec(QString("SELECT id, sender, receiver, message, timestamp FROM %1 "
+                            "ORDER BY timestamp ASC, id ASC").arg(LIVE_VIEW))) {
+        setLastError("导出查询失败: " + query.lastError().text());
+        return false;
+    }
+
+    bool ok = true;
+    if (format == ExportFormat::Json) {
+        QJsonObject header;
+        header["export_timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+        header["message_count"] = total;
+        // 复用 exportToJson 的结构，只是把 messages 数组按行写出
+        QByteArray head = QJsonDocument(header).toJson(QJsonDocument::Compact);
+        head.chop(1);
+        ok = writer.write(head + ",\"messages\":[\n");
+    }
+
+    qint64 exported = 0;
+    while (ok && query.next()) {
+        Message msg;
+        msg.id = query.value(0).toInt();
+        msg.sender = query.value(1).toString();
+        msg.receiver = query.value(2).toString();
+        msg.message = query.value(3).toString();
+        msg.timestamp = EpochTime::fromColumn(query.value(4));
+
+        QByteArray line = QJsonDocument(msg.toJson()).toJson(QJsonDocument::Compact);
+        if (format == ExportFormat::Json && exported > 0) {
+            line.prepend(",\n");
+        } else if (format == ExportFormat::NdJson) {
+            line.append('\n');
+        }
+        ok = writer.write(line);
+        ++exported;
+
+        if (exported % 1000 == 0) {
+            emit exportProgress(exported, total);
+        }
+    }
+    query.finish();
+
+    if (ok && format == ExportFormat::Json) {
+        ok = writer.write("\n]}\n");
+    }
+
+    if (!writer.finish() || !ok) {
+        setLastError("写入导出文件失败: " + writer.errorString());
+        return false;
+    }
+
+    emit exportProgress(exported, qMax(total, exported));
+    qDebug() << QString("ChatStorage: 流式导出 %1 条消息到文件: %2").arg(exported).arg(filePath);
+    return true;
+}
+
+bool ChatStorage::isCompressionSupported()
+{
+#ifdef CYANLA_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+int ChatStorage::importFromJson(const QString &json)
+{
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(json.toUtf8(), &parseError);
+    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+        setLastError("导入数据格式错误: " + parseError.errorString());
+        return -1;
+    }
+
+    QJsonArray jsonArray = doc.object()["messages"].toArray();
+
+    QList<Message> messages;
+    messages.reserve(jsonArray.size());
+    int skipped = 0;
+    for (const QJsonValue &value : jsonArray) {
+        Message msg = Message::fromJson(value.toObject());
+        if (msg.sender.isEmpty() || msg.receiver.isEmpty() || !msg.timestamp.isValid()) {
+            ++skipped;
+            continue;
+        }
+        messages.append(msg);
+    }
+
+    if (skipped > 0) {
+        qWarning() << QString("ChatStorage: 导入时跳过 %1 条无效记录").arg(skipped);
+    }
+
+    // 导入期间只在本连接上使用 bulk-import 配置，结束后检查点并恢复
+    StorageManager* storage = StorageManager::instance();
+    storage->beginBulkImport(StorageManager::ChatHistoryStore);
+    const int count = insertMessages(messages);
+    storage->endBulkImport(StorageManager::ChatHistoryStore);
+    return count;
+}
+
+int ChatStorage::importFromFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setLastError("无法打开导入文件: " + filePath);
+        return -1;
+    }
+
+    int count = importFromJson(QString::fromUtf8(file.readAll()));
+    if (count >= 0) {
+        qDebug() << QString("ChatStorage: 从文件导入 %1 条消息: %2").arg(count).arg(filePath);
+    }
+    return count;
+}
+
+BulkInsertStats ChatStorage::lastBulkInsertStats() const
+{
+    return m_lastBulkInsertStats;
+}
+
+SqlStatementCache::Stats ChatStorage::statementCacheStats() const
+{
+    return m_statements ? m_statements->stats() : SqlStatementCache::Stats();
+}
+
 bool ChatStorage::isValid() const
 {
     return m_isInitialized && m_database.isOpen();
@@ -491,8 +1116,7 @@ QList<Message> ChatStorage::executeMessageQuery(const QString &queryString, cons
         return messages;
     }
 
-    QSqlQuery query(m_database);
-    query.prepare(queryString);
+    QSqlQuery& query = m_statements->prepared(queryString);
 
     for (const QVariant &param : parameters) {
         query.addBindValue(param);
@@ -509,9 +1133,10 @@ QList<Message> ChatStorage::executeMessageQuery(const QString &queryString, cons
         msg.sender = query.value(1).toString();
         msg.receiver = query.value(2).toString();
         msg.message = query.value(3).toString();
-        msg.timestamp = query.value(4).toDateTime();
+        msg.timestamp = EpochTime::fromColumn(query.value(4));
         messages.append(msg);
     }
+    query.finish();
 
     qDebug() << QString("ChatStorage: 查询返回 %1 条消息").arg(messages.size());
     return messages;
@@ -15,6 +15,7 @@
 #include <QStandardPaths>
 #include <QDir>
 #include <QDebug>
+#include "SqlStatementCache.h"
 
 // 消息结构体
 struct Message {
@@ -36,6 +37,26 @@ struct Message {
     static Message fromJson(const QJsonObject &json);
 };
 
+// 流式导出的文件格式
+enum class ExportFormat {
+    Json,   // 与 exportToJson 相同的结构，可被 importFromJson 读取
+    NdJson  // 每行一条消息
+};
+
+// 批量写入的统计信息
+struct BulkInsertStats {
+    int rows = 0;
+    qint64 elapsedMs = 0;
+    double rowsPerSecond = 0.0;
+};
+
+// 全文检索结果
+struct MessageSearchResult {
+    Message message;
+    QString snippetHtml; // 命中附近的文字，命中词已高亮
+    double score = 0;    // 相关度（bm25 取反，越大越相关），LIKE 回退时为 0
+};
+
 class ChatStorage : public QObject
 {
     Q_OBJECT
@@ -52,6 +73,10 @@ public:
                        const QString &message, const QDateTime &timestamp = QDateTime::currentDateTime());
     bool insertMessage(const Message &msg);
 
+    // 批量插入：单个事务、复用同一条预编译语句，整批只发出一次 messagesInserted。
+    // 返回插入的条数，失败时整批回滚并返回 -1
+    int insertMessages(const QList<Message> &messages);
+
     // 查询消息记录
     QList<Message> getAllMessages();
     QList<Message> getMessagesBetweenUsers(const QString &user1, const QString &user2);
@@ -64,12 +89,32 @@ public:
     QList<Message> getMessagesBetweenUsersWithPagination(const QString &user1, const QString &user2,
                                                          int offset = 0, int limit = 50);
 
-    // 删除操作
+    // 游标分页：messageId 之前/之后的 limit 条消息，按 (timestamp, id) 正序返回，
+    // 翻页开销与历史深度无关；messageId <= 0 表示从最新/最早的消息开始
+    QList<Message> getMessagesBefore(int messageId, int limit = 50);
+    QList<Message> getMessagesAfter(int messageId, int limit = 50);
+    QList<Message> getMessagesBetweenUsersBefore(const QString &user1, const QString &user2,
+                                                 int messageId, int limit = 50);
+    QList<Message> getMessagesBetweenUsersAfter(const QString &user1, const QString &user2,
+                                                int messageId, int limit = 50);
+
+    // 全文检索：查询词以空白分隔且须全部命中，按相关度排序；
+    // 不足 3 个字符的词或 SQLite 不支持 FTS5 trigram 时退回 LIKE
+    QList<MessageSearchResult> searchMessages(const QString &text, int limit = 50);
+
+    // 删除操作：单条消息直接删除；批量删除只写入一条墓碑记录，
+    // 命中的消息立即从所有查询中消失，实际的行由 RetentionManager 在后台分块清除
     bool deleteMessage(int messageId);
     bool deleteMessagesBetweenUsers(const QString &user1, const QString &user2);
     bool deleteMessagesByTimeRange(const QDateTime &startTime, const QDateTime &endTime);
     bool deleteAllMessages();
 
+    // 清除最早一条墓碑命中的消息，最多 maxRows 行；该墓碑的消息清除完毕后移除墓碑。
+    // 在调用线程自己的 chat_history.db 连接上执行，返回清除的行数，出错返回 -1；
+    // pendingTombstones() 为 0 时全部清除完毕
+    static int purgeTombstones(QSqlDatabase &database, int maxRows);
+    static int pendingTombstones(QSqlDatabase &database);
+
     // 统计信息
     int getTotalMessageCount();
     int getMessageCount(const QString &sender, const QString &receiver);
@@ -80,12 +125,26 @@ public:
     QString exportAllToJson();
     bool exportToFile(const QString &filePath, const QList<Message> &messages);
 
+    // 流式导出全部消息：逐行读取游标并增量写入文件，内存占用与消息总数无关。
+    // compress 为 true 时写出 gzip 文件（需要编译时启用 zlib）
+    bool exportAllToFile(const QString &filePath, ExportFormat format = ExportFormat::Json,
+                         bool compress = false);
+    static bool isCompressionSupported();
+
+    // 数据导入（exportToJson 生成的格式），消息会分配新的 ID
+    int importFromJson(const QString &json);
+    int importFromFile(const QString &filePath);
+
     // 数据库状态
     bool isValid() const;
     QString getLastError() const;
+    SqlStatementCache::Stats statementCacheStats() const;
+    BulkInsertStats lastBulkInsertStats() const;
 
 signals:
     void messageInserted(const Message &message);
+    void messagesInserted(const QList<Message> &messages);
+    void exportProgress(qint64 exported, qint64 total);
     void messageDeleted(int messageId);
     void databaseError(const QString &error);
 
@@ -95,17 +154,22 @@ private:
     void setLastError(const QString &error);
     QString getDatabasePath();
 
+    // 墓碑：kind 0-全部, 1-两个用户之间, 2-时间范围
+    bool addTombstone(int kind, const QVariantList &values);
+
     // 辅助查询方法
     QList<Message> executeMessageQuery(const QString &queryString, const QVariantList &parameters = QVariantList());
 
 private:
     QSqlDatabase m_database;
-    QString m_connectionName;
     QString m_lastError;
     bool m_isInitialized;
+    bool m_fullTextIndex;
+    SqlStatementCache* m_statements;
+    BulkInsertStats m_lastBulkInsertStats;
 
-    static const QString DATABASE_NAME;
     static const QString TABLE_NAME;
+    static const QString LIVE_VIEW;   // 排除了墓碑命中消息的视图，所有读取都经过它
     static const int DATABASE_VERSION;
 };
 
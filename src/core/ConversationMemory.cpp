@@ -0,0 +1,296 @@
+#include "ConversationMemory.h"
+#include "AIApiClient.h"
+#include "StorageManager.h"
+#include "TokenEstimator.h"
+#include <QSettings>
+#include <QStringList>
+#include <QDebug>
+
+namespace {
+const int DEFAULT_HISTORY_TOKEN_BUDGET = 800;
+const int MIN_HISTORY_TOKEN_BUDGET = 200;
+// 摘要请求中每轮最多带的 token 数，长回答只取开头
+const int SUMMARY_INPUT_TURN_TOKENS = 300;
+// 正在并入摘要的轮次在历史中只保留开头
+const int EXCERPT_TOKENS = 40;
+// 本地摘要中每个问题保留的长度
+const int LOCAL_SUMMARY_QUESTION_TOKENS = 30;
+const QString VISITOR_PREFIX = "访客：";
+const QString ASSISTANT_PREFIX = "AI助手：";
+const QString SUMMARY_PREFIX = "之前对话摘要：";
+}
+
+ConversationMemory::ConversationMemory(QObject *parent)
+    : QObject(parent)
+    , m_summaryClient(new AIApiClient(this))
+{
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    m_historyTokenBudget = qMax(MIN_HISTORY_TOKEN_BUDGET,
+                                settings.value("conversation/historyTokenBudget",
+                                               DEFAULT_HISTORY_TOKEN_BUDGET).toInt());
+
+    // 摘要只在结束时使用，不需要流式返回
+    m_summaryClient->setStreamingEnabled(false);
+    connect(m_summaryClient, &AIApiClient::summaryReceived, this, &ConversationMemory::onSummaryReceived);
+    connect(m_summaryClient, &AIApiClient::apiError, this, &ConversationMemory::onSummaryFailed);
+}
+
+int ConversationMemory::historyTokenBudget() const
+{
+    return m_historyTokenBudget;
+}
+
+void ConversationMemory::setHistoryTokenBudget(int tokens)
+{
+    m_historyTokenBudget = qMax(MIN_HISTORY_TOKEN_BUDGET, tokens);
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    settings.setValue("conversation/historyTokenBudget", m_historyTokenBudget);
+
+    for (auto it = m_sessions.begin(); it != m_sessions.end(); ++it) {
+        it->dirty = true;
+    }
+}
+
+int ConversationMemory::summaryTokenLimit() const
+{
+    return m_historyTokenBudget / 4;
+}
+
+int ConversationMemory::recentTokenLimit() const
+{
+    // 其余八分之一留给正在并入摘要的轮次节选
+    return m_historyTokenBudget - summaryTokenLimit() - m_historyTokenBudget / 8;
+}
+
+void ConversationMemory::addTurn(const QString& sessionId, Speaker speaker, const QString& text)
+{
+    const QString trimmed = text.trimmed();
+    if (trimmed.isEmpty()) {
+        return;
+    }
+
+    const Turn turn = makeTurn(speaker, trimmed);
+
+    SessionMemory& memory = m_sessions[sessionId];
+    memory.recent.append(turn);
+    memory.recentTokens += turn.tokens;
+
+    // 超出近期窗口的旧轮次移出，最新一轮总是原文保留（过长时在 render 中截断）
+    while (memory.recent.size() > 1 && memory.recentTokens > recentTokenLimit()) {
+        const Turn old = memory.recent.takeFirst();
+        memory.recentTokens -= old.tokens;
+        memory.pending.append(old);
+    }
+    memory.dirty = true;
+
+    if (!memory.pending.isEmpty() && memory.summaryRequestId == 0) {
+        startSummary(sessionId);
+    }
+}
+
+void ConversationMemory::beginQuestion(const QString& sessionId, int requestId, const QString& question)
+{
+    const QString trimmed = question.trimmed();
+    if (trimmed.isEmpty()) {
+        return;
+    }
+
+    SessionMemory& memory = m_sessions[sessionId];
+    memory.openQuestions.append({requestId, makeTurn(Visitor, trimmed)});
+    memory.dirty = true;
+}
+
+void ConversationMemory::finishQuestion(const QString& sessionId, int requestId, const QString& answer)
+{
+    auto it = m_sessions.find(sessionId);
+    if (it == m_sessions.end()) {
+        return;
+    }
+
+    for (int i = 0; i < it->openQuestions.size(); ++i) {
+        if (it->openQuestions[i].first != requestId) continue;
+
+        // 去掉前缀后按普通轮次写入，紧跟着写入它自己的回答
+        const Turn question = it->openQuestions.takeAt(i).second;
+        it->dirty = true;
+        addTurn(sessionId, Visitor, question.text.mid(VISITOR_PREFIX.size()));
+        addTurn(sessionId, Assistant, answer);
+        return;
+    }
+}
+
+void ConversationMemory::dropQuestion(const QString& sessionId, int requestId)
+{
+    auto it = m_sessions.find(sessionId);
+    if (it == m_sessions.end()) {
+        return;
+    }
+
+    for (int i = 0; i < it->openQuestions.size(); ++i) {
+        if (it->openQuestions[i].first == requestId) {
+            it->openQuestions.removeAt(i);
+            it->dirty = true;
+            return;
+        }
+    }
+}
+
+ConversationMemory::Turn ConversationMemory::makeTurn(Speaker speaker, const QString& text)
+{
+    Turn turn;
+    turn.speaker = speaker;
+    turn.text = (speaker == Visitor ? VISITOR_PREFIX : ASSISTANT_PREFIX) + text;
+    turn.tokens = TokenEstimator::estimate(turn.text);
+    return turn;
+}
+
+QString ConversationMemory::context(const QString& sessionId)
+{
+    SessionMemory& memory = m_sessions[sessionId];
+    if (memory.dirty) {
+        memory.cachedContext = render(memory);
+        memory.dirty = false;
+        qDebug() << "对话记忆:" << sessionId << "历史约" << TokenEstimator::estimate(memory.cachedContext)
+                 << "/" << m_historyTokenBudget << "tokens，原文" << memory.recent.size() << "轮，待摘要"
+                 << memory.folding.size() + memory.pending.size() << "轮";
+    }
+    return memory.cachedContext;
+}
+
+int ConversationMemory::contextTokens(const QString& sessionId)
+{
+    return TokenEstimator::estimate(context(sessionId));
+}
+
+void ConversationMemory::clearSession(const QString& sessionId)
+{
+    // 进行中的摘要请求返回时找不到会话，结果直接丢弃
+    m_sessions.remove(sessionId);
+}
+
+QString ConversationMemory::render(const SessionMemory& memory) const
+{
+    // 每行额外按 1 个 token 计入换行，拼接后的估算值不会超过预算
+    int remaining = m_historyTokenBudget;
+
+    QString summaryLine;
+    if (!memory.summary.isEmpty()) {
+        summaryLine = SUMMARY_PREFIX + TokenEstimator::clip(memory.summary, summaryTokenLimit());
+        remaining -= TokenEstimator::estimate(summaryLine) + 1;
+    }
+
+    // 最近轮次（含尚未回答的提问）从新到旧放入，放不下的那一轮截断后停止
+    QList<Turn> latest = memory.recent;
+    for (const auto& open : memory.openQuestions) {
+        latest.append(open.second);
+    }
+    QStringList recentLines;
+    for (int i = latest.size() - 1; i >= 0 && remaining > 1; --i) {
+        const Turn& turn = latest[i];
+        if (turn.tokens + 1 <= remaining) {
+            recentLines.prepend(turn.text);
+            remaining -= turn.tokens + 1;
+        } else {
+            const QString clipped = TokenEstimator::clip(turn.text, remaining - 1);
+            if (!clipped.isEmpty()) {
+                recentLines.prepend(clipped);
+            }
+            remaining = 0;
+        }
+    }
+
+    // 尚未并入摘要的旧轮次只放开头，同样从新到旧
+    QList<Turn> older = memory.folding + memory.pending;
+    QStringList olderLines;
+    for (int i = older.size() - 1; i >= 0 && remaining > 1; --i) {
+        const QString excerpt = TokenEstimator::clip(older[i].text, qMin(EXCERPT_TOKENS, remaining - 1));
+        if (excerpt.isEmpty()) {
+            break;
+        }
+        olderLines.prepend(excerpt);
+        remaining -= TokenEstimator::estimate(excerpt) + 1;
+    }
+
+    QStringList lines;
+    if (!summaryLine.isEmpty()) {
+        lines.append(summaryLine);
+    }
+    lines += olderLines;
+    lines += recentLines;
+    return lines.join("\n");
+}
+
+void ConversationMemory::startSummary(const QString& sessionId)
+{
+    SessionMemory& memory = m_sessions[sessionId];
+    memory.folding += memory.pending;
+    memory.pending.clear();
+
+    QStringList lines;
+    for (const Turn& turn : memory.folding) {
+        lines.append(TokenEstimator::clip(turn.text, SUMMARY_INPUT_TURN_TOKENS));
+    }
+
+    memory.summaryRequestId = m_summaryClient->sendSummaryRequest(memory.summary, lines.join("\n"));
+    m_summaryRequests.insert(memory.summaryRequestId, sessionId);
+}
+
+void ConversationMemory::onSummaryReceived(int requestId, const QString& summary)
+{
+    const QString sessionId = m_summaryRequests.take(requestId);
+    auto it = m_sessions.find(sessionId);
+    if (sessionId.isNull() || it == m_sessions.end() || it->summaryRequestId != requestId) {
+        return;
+    }
+
+    it->summary = TokenEstimator::clip(summary.trimmed(), summaryTokenLimit());
+    it->folding.clear();
+    it->summaryRequestId = 0;
+    it->dirty = true;
+    emit summaryUpdated(sessionId, it->summary);
+
+    // 摘要生成期间又有轮次移出窗口，继续合并
+    if (!it->pending.isEmpty()) {
+        startSummary(sessionId);
+    }
+}
+
+void ConversationMemory::onSummaryFailed(int requestId, const QString& error)
+{
+    const QString sessionId = m_summaryRequests.take(requestId);
+    auto it = m_sessions.find(sessionId);
+    if (sessionId.isNull() || it == m_sessions.end() || it->summaryRequestId != requestId) {
+        return;
+    }
+
+    // 服务不可用时摘要生成期间移出的轮次也一并本地合并，等下一次移出再请求
+    qDebug() << "对话记忆: 摘要请求失败，改用本地摘要:" << error;
+    it->summary = localSummary(it->summary, it->folding + it->pending);
+    it->folding.clear();
+    it->pending.clear();
+    it->summaryRequestId = 0;
+    it->dirty = true;
+    emit summaryUpdated(sessionId, it->summary);
+}
+
+QString ConversationMemory::localSummary(const QString& previousSummary, const QList<Turn>& turns) const
+{
+    // 只保留访客问过的问题，超出上限时丢弃最早的
+    QStringList parts;
+    if (!previousSummary.isEmpty()) {
+        parts.append(previousSummary);
+    }
+    for (const Turn& turn : turns) {
+        if (turn.speaker == Visitor) {
+            parts.append("访客问过：" + TokenEstimator::clip(turn.text.mid(VISITOR_PREFIX.size()),
+                                                          LOCAL_SUMMARY_QUESTION_TOKENS));
+        }
+    }
+
+    QString summary = parts.join("；");
+    while (parts.size() > 1 && TokenEstimator::estimate(summary) > summaryTokenLimit()) {
+        parts.removeFirst();
+        summary = parts.join("；");
+    }
+    return TokenEstimator::clip(summary, summaryTokenLimit());
+}
@@ -0,0 +1,79 @@
+#ifndef CONVERSATIONMEMORY_H
+#define CONVERSATIONMEMORY_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QPair>
+
+class AIApiClient;
+
+// 智能HR对话的记忆：为每个会话维护放进提示词的对话历史，合计不超过固定的 token 预算。
+// - 最近的几轮原文保留，超出近期窗口的旧轮次移出，等待并入滚动摘要；
+// - 摘要由独立的 AIApiClient 异步生成（已有摘要 + 新移出的轮次），不阻塞当前提问；
+//   请求失败时改用本地摘要（保留访客问过的问题），保证旧内容不会丢失，也不会撑大提示词；
+// - 摘要、各轮 token 数和拼好的历史按会话缓存，每轮只追加和移动，不再从完整聊天记录重建；
+// - 同时有多个提问在进行时，问题按请求ID挂起，回答到达后问答成对写入，历史里不会出现 Q1、Q2、A1、A2。
+// 预算保存在 storage.ini 的 conversation/historyTokenBudget。只在主线程使用。
+class ConversationMemory : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Speaker { Visitor, Assistant };
+
+    explicit ConversationMemory(QObject *parent = nullptr);
+
+    int historyTokenBudget() const;
+    void setHistoryTokenBudget(int tokens);
+
+    void addTurn(const QString& sessionId, Speaker speaker, const QString& text);
+    // 已发出、尚未回答的提问：挂起期间作为最新一行出现在历史中，
+    // finishQuestion 时与回答（可为空）一起按顺序写入；dropQuestion 直接丢弃
+    void beginQuestion(const QString& sessionId, int requestId, const QString& question);
+    void finishQuestion(const QString& sessionId, int requestId, const QString& answer);
+    void dropQuestion(const QString& sessionId, int requestId);
+    // 本会话放进提示词的历史：摘要 + 正在并入摘要的轮次节选 + 最近轮次原文
+    QString context(const QString& sessionId);
+    int contextTokens(const QString& sessionId);
+    void clearSession(const QString& sessionId);
+
+signals:
+    void summaryUpdated(const QString& sessionId, const QString& summary);
+
+private:
+    struct Turn {
+        Speaker speaker;
+        QString text;       // 带“访客：”“AI助手：”前缀的一行
+        int tokens;
+    };
+
+    struct SessionMemory {
+        QString summary;
+        QList<Turn> recent;        // 原文保留的最近轮次
+        int recentTokens = 0;
+        QList<Turn> pending;       // 已移出窗口、尚未并入摘要
+        QList<Turn> folding;       // 正在生成摘要的轮次
+        QList<QPair<int, Turn>> openQuestions;  // 请求ID -> 尚未回答的提问
+        int summaryRequestId = 0;  // 0 表示没有进行中的摘要请求
+        QString cachedContext;
+        bool dirty = true;
+    };
+
+    static Turn makeTurn(Speaker speaker, const QString& text);
+    int summaryTokenLimit() const;
+    int recentTokenLimit() const;
+    void startSummary(const QString& sessionId);
+    void onSummaryReceived(int requestId, const QString& summary);
+    void onSummaryFailed(int requestId, const QString& error);
+    QString localSummary(const QString& previousSummary, const QList<Turn>& turns) const;
+    QString render(const SessionMemory& memory) const;
+
+    AIApiClient* m_summaryClient;
+    QHash<QString, SessionMemory> m_sessions;
+    QHash<int, QString> m_summaryRequests;  // 摘要请求ID -> 会话ID
+    int m_historyTokenBudget;
+};
+
+#endif // CONVERSATIONMEMORY_H
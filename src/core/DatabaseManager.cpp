@@ -1,8 +1,16 @@
 #include "DatabaseManager.h"
+#include "SchemaMigrator.h"
+#include "UserCache.h"
+#include "StorageManager.h"
+#include "FullTextSearch.h"
+#include "ChatArchiver.h"
+#include "EpochTime.h"
 #include <QStandardPaths>
 #include <QDir>
 #include <QDebug>
 #include <QSqlRecord>
+#include <QThread>
+#include <QMutexLocker>
 
 DatabaseManager* DatabaseManager::m_instance = nullptr;
 
@@ -15,24 +23,27 @@ DatabaseManager* DatabaseManager::instance(){
 }
 
 DatabaseManager::DatabaseManager(QObject *parent):
-    QObject(parent){
+    QObject(parent),
+    m_userCache(new UserCache),
+    m_fullTextIndex(false){
 
 }
 
 DatabaseManager::~DatabaseManager(){
     closeDatabase();
+    delete m_userCache;
 }
 
 bool DatabaseManager::initDatabase()
 {
     // 获取数据库路径
     QString dbPath = getDbPath();
+    m_dbPath = dbPath;
 
-    // 创建数据库连接
-    m_database = QSqlDatabase::addDatabase("QSQLITE");
-    m_database.setDatabaseName(dbPath);
+    // 主线程连接，由 StorageManager 统一创建和配置
+    m_database = StorageManager::instance()->connection(StorageManager::MainStore);
 
-    if (!m_database.open()) {
+    if (!m_database.isOpen()) {
         qDebug() << "数据库打开失败:" << m_database.lastError().text();
         return false;
     }
@@ -49,107 +60,437 @@ bool DatabaseManager::initDatabase()
 
 void DatabaseManager::closeDatabase()
 {
+    // 缓存的语句必须在连接关闭前释放
+    {
+        QMutexLocker locker(&m_connectionMutex);
+        delete m_statementCaches.take(m_database.connectionName());
+    }
+
     if (m_database.isOpen()) {
         m_database.close();
     }
 }
 
-QString DatabaseManager::getDbPath()
+QString DatabaseManager::threadConnectionName() const
 {
-    QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    QDir dir(dataPath);
-    if (!dir.exists()) {
-        dir.mkpath(dataPath);
-    }
-    return dataPath + "/Cyan.db";
+    return StorageManager::instance()->connectionName(StorageManager::MainStore);
 }
 
-bool DatabaseManager::createTables()
+QSqlDatabase DatabaseManager::connection()
 {
-    QSqlQuery query(m_database);
+    // 主线程直接使用初始化时打开的连接
+    if (QThread::currentThread() == thread()) {
+        return m_database;
+    }
 
-    // 创建用户表
-    QString createUsersTable = R"(
-        CREATE TABLE IF NOT EXISTS users (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            username VARCHAR(50) UNIQUE NOT NULL,
-            password_hash VARCHAR(64) NOT NULL,
-            email VARCHAR(100) UNIQUE,
-            phone VARCHAR(20),
-            role VARCHAR(20) NOT NULL,
-            real_name VARCHAR(50),
-            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-            last_login DATETIME,
-            status INTEGER DEFAULT 1,
-            avatar_path VARCHAR(255)
-        )
-    )";
+    // 其他线程（如数据库工作线程）各自持有独立连接，QSqlDatabase 不能跨线程共享
+    return StorageManager::instance()->connection(StorageManager::MainStore);
+}
 
-    if (!query.exec(createUsersTable)) {
-        qDebug() << "创建用户表失败:" << query.lastError().text();
-        return false;
+SqlStatementCache& DatabaseManager::statements()
+{
+    QSqlDatabase db = connection();
+    const QString name = db.connectionName();
+
+    QMutexLocker locker(&m_connectionMutex);
+    SqlStatementCache* cache = m_statementCaches.value(name);
+    if (!cache) {
+        cache = new SqlStatementCache(db);
+        m_statementCaches.insert(name, cache);
     }
+    return *cache;
+}
 
-    // 创建聊天会话表
-    QString createSessionsTable = R"(
-        CREATE TABLE IF NOT EXISTS chat_sessions (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            visitor_id INTEGER NOT NULL,
-            staff_id INTEGER DEFAULT 0,
-            visitor_name VARCHAR(50),
-            staff_name VARCHAR(50),
-            created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-            last_message_at DATETIME DEFAULT CURRENT_TIMESTAMP,
-            status INTEGER DEFAULT 2,
-            last_message TEXT,
-            FOREIGN KEY (visitor_id) REFERENCES users(id),
-            FOREIGN KEY (staff_id) REFERENCES users(id)
-        )
-    )";
-
-    if (!query.exec(createSessionsTable)) {
-        qDebug() << "创建聊天会话表失败:" << query.lastError().text();
-        return false;
+SqlStatementCache::Stats DatabaseManager::statementCacheStats()
+{
+    SqlStatementCache::Stats total;
+
+    QMutexLocker locker(&m_connectionMutex);
+    for (SqlStatementCache* cache : m_statementCaches) {
+        SqlStatementCache::Stats stats = cache->stats();
+        total.hits += stats.hits;
+        total.misses += stats.misses;
+        total.cachedStatements += stats.cachedStatements;
     }
+    return total;
+}
 
-    // 创建聊天消息表
-    QString createMessagesTable = R"(
-        CREATE TABLE IF NOT EXISTS chat_messages (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            session_id INTEGER NOT NULL,
-            sender_id INTEGER NOT NULL,
-            sender_name VARCHAR(50),
-            sender_role VARCHAR(20),
-            content TEXT NOT NULL,
-            timestamp DATETIME DEFAULT CURRENT_TIMESTAMP,
-            message_type INTEGER DEFAULT 0,
-            is_read INTEGER DEFAULT 0,
-            FOREIGN KEY (session_id) REFERENCES chat_sessions(id),
-            FOREIGN KEY (sender_id) REFERENCES users(id)
-        )
-    )";
+void DatabaseManager::releaseThreadConnection()
+{
+    if (QThread::currentThread() == thread()) {
+        return;
+    }
 
-    if (!query.exec(createMessagesTable)) {
-        qDebug() << "创建聊天消息表失败:" << query.lastError().text();
-        return false;
+    {
+        QMutexLocker locker(&m_connectionMutex);
+        delete m_statementCaches.take(threadConnectionName());
     }
 
-    // 在用户表中添加在线状态字段（如果不存在）
-    query.exec("ALTER TABLE users ADD COLUMN is_online INTEGER DEFAULT 0");
+    // 本线程上打开的所有库（不只是 Cyan.db）一起关闭
+    StorageManager::instance()->releaseThreadConnections();
+}
 
-    // 创建默认管理员账户（如果不存在）
-    if (!isUsernameExists("admin")) {
-        registerUser("admin", "admin123", "admin@Cyan.com", "", "管理员", "Ayin");
-    }
+QString DatabaseManager::getDbPath()
+{
+    return StorageManager::instance()->databasePath(StorageManager::MainStore);
+}
 
-    // 创建测试HR客服账户
-    if (!isUsernameExists("staff1")) {
-        registerUser("staff1", "123456", "staff1@Cyan.com", "", "客服小祥", "丰川祥子");
-    }
-    if (!isUsernameExists("staff2")) {
-        registerUser("staff2", "123456", "staff2@Cyan.com", "", "客服小唐", "桑丘");
+bool DatabaseManager::createTables()
+{
+    SchemaMigrator migrator(m_database, "DatabaseManager");
+
+    // v1: 基础表结构、在线状态字段和默认账户
+    migrator.addMigration(1, "基础表结构", [this](QSqlDatabase& database) {
+        QSqlQuery query(database);
+
+        // 创建用户表
+        QString createUsersTable = R"(
+            CREATE TABLE IF NOT EXISTS users (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                username VARCHAR(50) UNIQUE NOT NULL,
+                password_hash VARCHAR(64) NOT NULL,
+                email VARCHAR(100) UNIQUE,
+                phone VARCHAR(20),
+                role VARCHAR(20) NOT NULL,
+                real_name VARCHAR(50),
+                created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+                last_login DATETIME,
+                status INTEGER DEFAULT 1,
+                avatar_path VARCHAR(255)
+            )
+        )";
+
+        if (!query.exec(createUsersTable)) {
+            qDebug() << "创建用户表失败:" << query.lastError().text();
+            return false;
+        }
+
+        // 创建聊天会话表
+        QString createSessionsTable = R"(
+            CREATE TABLE IF NOT EXISTS chat_sessions (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                visitor_id INTEGER NOT NULL,
+                staff_id INTEGER DEFAULT 0,
+                visitor_name VARCHAR(50),
+                staff_name VARCHAR(50),
+                created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+                last_message_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+                status INTEGER DEFAULT 2,
+                last_message TEXT,
+                FOREIGN KEY (visitor_id) REFERENCES users(id),
+                FOREIGN KEY (staff_id) REFERENCES users(id)
+            )
+        )";
+
+        if (!query.exec(createSessionsTable)) {
+            qDebug() << "创建聊天会话表失败:" << query.lastError().text();
+            return false;
+        }
+
+        // 创建聊天消息表
+        QString createMessagesTable = R"(
+            CREATE TABLE IF NOT EXISTS chat_messages (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                session_id INTEGER NOT NULL,
+                sender_id INTEGER NOT NULL,
+                sender_name VARCHAR(50),
+                sender_role VARCHAR(20),
+                content TEXT NOT NULL,
+                timestamp DATETIME DEFAULT CURRENT_TIMESTAMP,
+                message_type INTEGER DEFAULT 0,
+                is_read INTEGER DEFAULT 0,
+                FOREIGN KEY (session_id) REFERENCES chat_sessions(id),
+                FOREIGN KEY (sender_id) REFERENCES users(id)
+            )
+        )";
+
+        if (!query.exec(createMessagesTable)) {
+            qDebug() << "创建聊天消息表失败:" << query.lastError().text();
+            return false;
+        }
+
+        // 在用户表中添加在线状态字段（旧版本数据库可能已经有了）
+        if (!SchemaMigrator::hasColumn(database, "users", "is_online")) {
+            if (!query.exec("ALTER TABLE users ADD COLUMN is_online INTEGER DEFAULT 0")) {
+                qDebug() << "添加在线状态字段失败:" << query.lastError().text();
+                return false;
+            }
+        }
+
+        // 创建默认管理员账户（如果不存在）
+        if (!isUsernameExists("admin")) {
+            registerUser("admin", "admin123", "admin@Cyan.com", "", "管理员", "Ayin");
+        }
+
+        // 创建测试HR客服账户
+        if (!isUsernameExists("staff1")) {
+            registerUser("staff1", "123456", "staff1@Cyan.com", "", "客服小祥", "丰川祥子");
+        }
+        if (!isUsernameExists("staff2")) {
+            registerUser("staff2", "123456", "staff2@Cyan.com", "", "客服小唐", "桑丘");
+        }
+
+        return true;
+    });
+
+    // v2: 变更序列表，由触发器在每次提交消息/会话变化时追加一行，
+    // ChatChangeNotifier 只读取 seq 之后的增量即可知道哪些会话发生了变化
+    // kind: 0-新消息, 1-会话状态变化
+    migrator.addMigration(2, "聊天变更序列表", QStringList{
+        R"(CREATE TABLE IF NOT EXISTS chat_changes (
+               seq INTEGER PRIMARY KEY AUTOINCREMENT,
+               session_id INTEGER NOT NULL,
+               kind INTEGER NOT NULL
+           ))",
+        R"(CREATE TRIGGER IF NOT EXISTS trg_chat_messages_changes
+           AFTER INSERT ON chat_messages
+           BEGIN
+               INSERT INTO chat_changes (session_id, kind) VALUES (NEW.session_id, 0);
+           END)",
+        R"(CREATE TRIGGER IF NOT EXISTS trg_chat_sessions_insert_changes
+           AFTER INSERT ON chat_sessions
+           BEGIN
+               INSERT INTO chat_changes (session_id, kind) VALUES (NEW.id, 1);
+           END)",
+        R"(CREATE TRIGGER IF NOT EXISTS trg_chat_sessions_update_changes
+           AFTER UPDATE OF staff_id, status ON chat_sessions
+           BEGIN
+               INSERT INTO chat_changes (session_id, kind) VALUES (NEW.id, 1);
+           END)"
+    });
+
+    // v3: 聊天查询索引
+    // - getChatMessages:      WHERE session_id ORDER BY timestamp
+    // - getUnreadMessages / markSessionAsRead: session_id + is_read + sender_id
+    // - getStaffSessions:     WHERE staff_id AND status ORDER BY last_message_at
+    // - getvisitorSessions:   WHERE visitor_id ORDER BY last_message_at
+    // - getActiveSessions:    WHERE status > 0 ORDER BY last_message_at
+    migrator.addMigration(3, "聊天消息与会话索引", QStringList{
+        "CREATE INDEX IF NOT EXISTS idx_chat_messages_session_time ON chat_messages(session_id, timestamp)",
+        "CREATE INDEX IF NOT EXISTS idx_chat_messages_session_unread ON chat_messages(session_id, is_read, sender_id)",
+        "CREATE INDEX IF NOT EXISTS idx_chat_sessions_staff ON chat_sessions(staff_id, status, last_message_at)",
+        "CREATE INDEX IF NOT EXISTS idx_chat_sessions_visitor ON chat_sessions(visitor_id, last_message_at)",
+        "CREATE INDEX IF NOT EXISTS idx_chat_sessions_status ON chat_sessions(status, last_message_at)",
+        "ANALYZE"
+    });
+
+    // v4: 已读水位表，取代逐行更新的 is_read（该列保留但不再写入）
+    // 旧数据按每个参与者第一条未读消息之前的位置回填水位
+    migrator.addMigration(4, "会话已读水位", QStringList{
+        R"(CREATE TABLE IF NOT EXISTS session_read_state (
+               session_id INTEGER NOT NULL,
+               user_id INTEGER NOT NULL,
+               last_read_message_id INTEGER NOT NULL DEFAULT 0,
+               updated_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+               PRIMARY KEY (session_id, user_id)
+           ) WITHOUT ROWID)",
+        R"(INSERT OR IGNORE INTO session_read_state (session_id, user_id, last_read_message_id)
+           SELECT s.id, s.visitor_id,
+                  COALESCE((SELECT MIN(m.id) - 1 FROM chat_messages m
+                            WHERE m.session_id = s.id AND m.sender_id != s.visitor_id AND m.is_read = 0),
+                           (SELECT MAX(m.id) FROM chat_messages m WHERE m.session_id = s.id),
+                           0)
+           FROM chat_sessions s)",
+        R"(INSERT OR IGNORE INTO session_read_state (session_id, user_id, last_read_message_id)
+           SELECT s.id, s.staff_id,
+                  COALESCE((SELECT MIN(m.id) - 1 FROM chat_messages m
+                            WHERE m.session_id = s.id AND m.sender_id != s.staff_id AND m.is_read = 0),
+                           (SELECT MAX(m.id) FROM chat_messages m WHERE m.session_id = s.id),
+                           0)
+           FROM chat_sessions s
+           WHERE s.staff_id > 0)",
+        // 未读计数: WHERE session_id = ? AND id > 水位 AND sender_id != ?，索引覆盖
+        "CREATE INDEX IF NOT EXISTS idx_chat_messages_session_id ON chat_messages(session_id, id, sender_id)",
+        "DROP INDEX IF EXISTS idx_chat_messages_session_unread"
+    });
+
+    // v5: 会话摘要由触发器随消息插入一起维护，发送消息只需一条 INSERT
+    // - chat_sessions: 最后一条消息、时间、ID 和消息总数
+    // - session_read_state: 每个参与者的未读数，读到新位置时重新计算
+    migrator.addMigration(5, "触发器维护的会话摘要", [](QSqlDatabase& database) {
+        QSqlQuery query(database);
+
+        if (!SchemaMigrator::hasColumn(database, "chat_sessions", "message_count")) {
+            if (!query.exec("ALTER TABLE chat_sessions ADD COLUMN message_count INTEGER NOT NULL DEFAULT 0")) {
+                qDebug() << "添加消息数字段失败:" << query.lastError().text();
+                return false;
+            }
+        }
+        if (!SchemaMigrator::hasColumn(database, "chat_sessions", "last_message_id")) {
+            if (!query.exec("ALTER TABLE chat_sessions ADD COLUMN last_message_id INTEGER NOT NULL DEFAULT 0")) {
+                qDebug() << "添加最后消息ID字段失败:" << query.lastError().text();
+                return false;
+            }
+        }
+        if (!SchemaMigrator::hasColumn(database, "session_read_state", "unread_count")) {
+            if (!query.exec("ALTER TABLE session_read_state ADD COLUMN unread_count INTEGER NOT NULL DEFAULT 0")) {
+                qDebug() << "添加未读数字段失败:" << query.lastError().text();
+                return false;
+            }
+        }
+
+        const QStringList statements = {
+            // 回填现有数据
+            R"(UPDATE chat_sessions SET
+                   message_count = (SELECT COUNT(*) FROM chat_messages m WHERE m.session_id = chat_sessions.id),
+                   last_message_id = COALESCE((SELECT MAX(m.id) FROM chat_messages m
+                                               WHERE m.session_id = chat_sessions.id), 0))",
+            R"(UPDATE session_read_state SET
+                   unread_count = (SELECT COUNT(*) FROM chat_messages m
+                                   WHERE m.session_id = session_read_state.session_id
+                                     AND m.id > session_read_state.last_read_message_id
+                                     AND m.sender_id != session_read_state.user_id))",
+
+            R"(CREATE TRIGGER IF NOT EXISTS trg_chat_messages_session_summary
+               AFTER INSERT ON chat_messages
+               BEGIN
+                   UPDATE chat_sessions
+                   SET last_message = NEW.content,
+                       last_message_at = NEW.timestamp,
+                       last_message_id = NEW.id,
+                       message_count = message_count + 1
+                   WHERE id = NEW.session_id;
+                   UPDATE session_read_state
+                   SET unread_count = unread_count + 1
+                   WHERE session_id = NEW.session_id AND user_id != NEW.sender_id;
+               END)",
+
+            // 参与者加入会话时建立已读状态行，之后的未读数都由上面的触发器累加
+            R"(CREATE TRIGGER IF NOT EXISTS trg_chat_sessions_visitor_read_state
+               AFTER INSERT ON chat_sessions
+               BEGIN
+                   INSERT OR IGNORE INTO session_read_state (session_id, user_id, last_read_message_id, unread_count)
+                   VALUES (NEW.id, NEW.visitor_id, 0, 0);
+               END)",
+            R"(CREATE TRIGGER IF NOT EXISTS trg_chat_sessions_staff_read_state
+               AFTER UPDATE OF staff_id ON chat_sessions
+               WHEN NEW.staff_id > 0
+               BEGIN
+                   INSERT OR IGNORE INTO session_read_state (session_id, user_id, last_read_message_id, unread_count)
+                   VALUES (NEW.id, NEW.staff_id, 0,
+                           (SELECT COUNT(*) FROM chat_messages
+                            WHERE session_id = NEW.id AND sender_id != NEW.staff_id));
+               END)"
+        };
+
+        for (const QString& sql : statements) {
+            if (!query.exec(sql)) {
+                qDebug() << "创建会话摘要触发器失败:" << query.lastError().text();
+                return false;
+            }
+        }
+
+        return true;
+    });
+
+    // v6: 发件箱重试时按客户端生成的消息 ID 去重
+    migrator.addMigration(6, "客户端消息ID", [](QSqlDatabase& database) {
+        QSqlQuery query(database);
+
+        if (!SchemaMigrator::hasColumn(database, "chat_messages", "client_msg_id")) {
+            if (!query.exec("ALTER TABLE chat_messages ADD COLUMN client_msg_id TEXT")) {
+                qDebug() << "添加客户端消息ID字段失败:" << query.lastError().text();
+                return false;
+            }
+        }
+
+        // 旧消息没有 client_msg_id，部分唯一索引只约束新消息
+        if (!query.exec("CREATE UNIQUE INDEX IF NOT EXISTS idx_chat_messages_client_msg_id "
+                        "ON chat_messages(client_msg_id) WHERE client_msg_id IS NOT NULL")) {
+            qDebug() << "创建客户端消息ID索引失败:" << query.lastError().text();
+            return false;
+        }
+        return true;
+    });
+
+    // v7: 聊天记录全文检索（trigram 分词，中文按子串匹配）；SQLite 不支持时跳过，检索退回 LIKE，
+    // 之后每次启动由 FullTextSearch::ensureIndex 检查并补建
+    migrator.addMigration(7, "聊天消息全文索引", [](QSqlDatabase& database) {
+        if (!FullTextSearch::isTrigramAvailable(database)) {
+            qWarning() << "SQLite 不支持 FTS5 trigram，聊天记录检索将使用 LIKE";
+            return true;
+        }
+        return FullTextSearch::createIndex(database, "chat_messages", "content", "chat_messages_fts");
+    });
+
+    // v8: 已归档会话的索引，记录每个会话被移到了哪个归档库（见 ChatArchiver）
+    migrator.addMigration(8, "会话归档索引", QStringList{
+        R"(CREATE TABLE IF NOT EXISTS chat_archive_index (
+               session_id INTEGER PRIMARY KEY,
+               archive_file TEXT NOT NULL,
+               message_count INTEGER NOT NULL DEFAULT 0,
+               first_message_at DATETIME,
+               last_message_at DATETIME,
+               archived_at DATETIME DEFAULT CURRENT_TIMESTAMP
+           ))",
+        "CREATE INDEX IF NOT EXISTS idx_chat_archive_index_last_message ON chat_archive_index(last_message_at)"
+    });
+
+    // v9: 时间列由 CURRENT_TIMESTAMP 文本（UTC）改为纪元毫秒整数。
+    // 列上的 DEFAULT CURRENT_TIMESTAMP 无法修改，之后所有写入都显式绑定毫秒值；
+    // 建立已读状态行的触发器重建为写入毫秒
+    migrator.addMigration(9, "时间列改为纪元毫秒", [](QSqlDatabase& database) {
+        const QList<QPair<QString, QString>> columns = {
+            {"users", "created_at"},
+            {"users", "last_login"},
+            {"chat_sessions", "created_at"},
+            {"chat_sessions", "last_message_at"},
+            {"chat_messages", "timestamp"},
+            {"session_read_state", "updated_at"},
+            {"chat_archive_index", "first_message_at"},
+            {"chat_archive_index", "last_message_at"},
+            {"chat_archive_index", "archived_at"}
+        };
+        for (const auto& column : columns) {
+            if (EpochTime::convertTextColumn(database, column.first, column.second, EpochTime::UtcText) < 0) {
+                return false;
+            }
+        }
+
+        const QStringList statements = {
+            "DROP TRIGGER IF EXISTS trg_chat_sessions_visitor_read_state",
+            "DROP TRIGGER IF EXISTS trg_chat_sessions_staff_read_state",
+            QString(R"(CREATE TRIGGER trg_chat_sessions_visitor_read_state
+                       AFTER INSERT ON chat_sessions
+                       BEGIN
+                           INSERT OR IGNORE INTO session_read_state
+                               (session_id, user_id, last_read_message_id, unread_count, updated_at)
+                           VALUES (NEW.id, NEW.visitor_id, 0, 0, %1);
+                       END)").arg(EpochTime::nowMsExpression()),
+            QString(R"(CREATE TRIGGER trg_chat_sessions_staff_read_state
+                       AFTER UPDATE OF staff_id ON chat_sessions
+                       WHEN NEW.staff_id > 0
+                       BEGIN
+                           INSERT OR IGNORE INTO session_read_state
+                               (session_id, user_id, last_read_message_id, unread_count, updated_at)
+                           VALUES (NEW.id, NEW.staff_id, 0,
+                                   (SELECT COUNT(*) FROM chat_messages
+                                    WHERE session_id = NEW.id AND sender_id != NEW.staff_id),
+                                   %1);
+                       END)").arg(EpochTime::nowMsExpression())
+        };
+
+        QSqlQuery query(database);
+        for (const QString& sql : statements) {
+            if (!query.exec(sql)) {
+                qDebug() << "重建已读状态触发器失败:" << query.lastError().text();
+                return false;
+            }
+        }
+        return true;
+    });
+
+    if (!migrator.migrate()) {
+        qDebug() << "数据库迁移失败:" << migrator.lastError();
+        return false;
     }
 
+    m_fullTextIndex = FullTextSearch::ensureIndex(m_database, "chat_messages", "content", "chat_messages_fts");
+
+    // 只保留最近的变更记录，避免表无限增长
+    QSqlQuery query(m_database);
+    query.exec("DELETE FROM chat_changes WHERE seq < (SELECT MAX(seq) FROM chat_changes) - 10000");
+
     return true;
 }
 
@@ -167,10 +508,10 @@ bool DatabaseManager::registerUser(const QString& username, const QString& passw
         return false;
     }
 
-    QSqlQuery query(m_database);
+    QSqlQuery query(connection());
     query.prepare(R"(
-        INSERT INTO users (username, password_hash, email, phone, role, real_name)
-        VALUES (?, ?, ?, ?, ?, ?)
+        INSERT INTO users (username, password_hash, email, phone, role, real_name, created_at)
+        VALUES (?, ?, ?, ?, ?, ?, ?)
     )");
 
     query.addBindValue(username);
@@ -179,6 +520,7 @@ bool DatabaseManager::registerUser(const QString& username, const QString& passw
     query.addBindValue(phone);
     query.addBindValue(role);
     query.addBindValue(realName);
+    query.addBindValue(EpochTime::nowMs());
 
     if (!query.exec()) {
         qDebug() << "用户注册失败:" << query.lastError().text();
@@ -190,7 +532,7 @@ bool DatabaseManager::registerUser(const QString& username, const QString& passw
 
 bool DatabaseManager::loginUser(const QString& username, const QString& password, UserInfo& userInfo)
 {
-    QSqlQuery query(m_database);
+    QSqlQuery query(connection());
     query.prepare(R"(
         SELECT id, username, email, phone, role, real_name, created_at, last_login, status, avatar_path, password_hash
         FROM users
@@ -219,13 +561,14 @@ bool DatabaseManager::loginUser(const QString& username, const QString& password
         userInfo.phone = query.value("phone").toString();
         userInfo.role = query.value("role").toString();
         userInfo.realName = query.value("real_name").toString();
-        userInfo.createdAt = query.value("created_at").toDateTime();
-        userInfo.lastLogin = query.value("last_login").toDateTime();
+        userInfo.createdAt = EpochTime::fromColumn(query.value("created_at"));
+        userInfo.lastLogin = EpochTime::fromColumn(query.value("last_login"));
         userInfo.status = query.value("status").toInt();
         userInfo.avatarPath = query.value("avatar_path").toString();
 
         // 更新最后登录时间
         updateLastLogin(userInfo.id);
+        m_userCache->put(userInfo);
 
         return true;
     }
@@ -235,11 +578,14 @@ bool DatabaseManager::loginUser(const QString& username, const QString& password
 
 bool DatabaseManager::updateLastLogin(int userId)
 {
-    QSqlQuery query(m_database);
-    query.prepare("UPDATE users SET last_login = CURRENT_TIMESTAMP WHERE id = ?");
+    QSqlQuery query(connection());
+    query.prepare("UPDATE users SET last_login = ? WHERE id = ?");
+    query.addBindValue(EpochTime::nowMs());
     query.addBindValue(userId);
 
-    return query.exec();
+    bool ok = query.exec();
+    m_userCache->invalidate(userId);
+    return ok;
 }
 
 // ========== 聊天会话管理 ==========
@@ -255,10 +601,10 @@ int DatabaseManager::createChatSession(int visitorId, int staffId)
         staffName = staff.realName.isEmpty() ? staff.username : staff.realName;
     }
 
-    QSqlQuery query(m_database);
+    QSqlQuery query(connection());
     query.prepare(R"(
-        INSERT INTO chat_sessions (visitor_id, staff_id, visitor_name, staff_name, status)
-        VALUES (?, ?, ?, ?, ?)
+        INSERT INTO chat_sessions (visitor_id, staff_id, visitor_name, staff_name, status, created_at, last_message_at)
+        VALUES (?, ?, ?, ?, ?, ?, ?)
     )");
 
     query.addBindValue(visitorId);
@@ -266,6 +612,9 @@ int DatabaseManager::createChatSession(int visitorId, int staffId)
     query.addBindValue(visitorName);
     query.addBindValue(staffName);
     query.addBindValue(staffId > 0 ? 1 : 2); // 1-进行中, 2-等待中
+    const qint64 now = EpochTime::nowMs();
+    query.addBindValue(now);
+    query.addBindValue(now);
 
     if (query.exec()) {
         int sessionId = query.lastInsertId().toInt();
@@ -291,15 +640,16 @@ bool DatabaseManager::updateChatSession(int sessionId, int staffId)
     UserInfo staff = getUserInfo(staffId);
     QString staffName = staff.realName.isEmpty() ? staff.username : staff.realName;
 
-    QSqlQuery query(m_database);
+    QSqlQuery query(connection());
     query.prepare(R"(
         UPDATE chat_sessions
-        SET staff_id = ?, staff_name = ?, status = 1, last_message_at = CURRENT_TIMESTAMP
+        SET staff_id = ?, staff_name = ?, status = 1, last_message_at = ?
         WHERE id = ?
     )");
 
     query.addBindValue(staffId);
     query.addBindValue(staffName);
+    query.addBindValue(EpochTime::nowMs());
     query.addBindValue(sessionId);
 
     if (query.exec()) {
@@ -318,13 +668,14 @@ bool DatabaseManager::updateChatSession(int sessionId, int staffId)
 
 bool DatabaseManager::closeChatSession(int sessionId)
 {
-    QSqlQuery query(m_database);
+    QSqlQuery query(connection());
     query.prepare(R"(
         UPDATE chat_sessions
-        SET status = 0, last_message_at = CURRENT_TIMESTAMP
+        SET status = 0, last_message_at = ?
         WHERE id = ?
     )");
 
+    query.addBindValue(EpochTime::nowMs());
     query.addBindValue(sessionId);
 
     if (query.exec()) {
@@ -341,19 +692,28 @@ bool DatabaseManager::closeChatSession(int sessionId)
     return false;
 }
 
-QList<ChatSession> DatabaseManager::getActiveSessions()
+QList<ChatSession> DatabaseManager::getActiveSessions(int viewerId)
 {
     QList<ChatSession> sessions;
 
-    QSqlQuery query(m_database);
-    query.prepare(R"(
-        SELECT id, visitor_id, staff_id, visitor_name, staff_name,
-               created_at, last_message_at, status, last_message
-        FROM chat_sessions
-        WHERE status > 0
-        ORDER BY last_message_at DESC
+    // 未读数直接读取触发器维护的计数；查看者还不是参与者（如等待接入的会话）时才现算
+    QSqlQuery& query = statements().prepared(R"(
+        SELECT s.id, s.visitor_id, s.staff_id, s.visitor_name, s.staff_name,
+               s.created_at, s.last_message_at, s.status, s.last_message, s.message_count,
+               CASE WHEN ? > 0 THEN COALESCE(r.unread_count, (
+                   SELECT COUNT(*) FROM chat_messages m
+                   WHERE m.session_id = s.id AND m.sender_id != ?
+               )) ELSE 0 END AS unread_count
+        FROM chat_sessions s
+        LEFT JOIN session_read_state r ON r.session_id = s.id AND r.user_id = ?
+        WHERE s.status > 0
+        ORDER BY s.last_message_at DESC
     )");
 
+    query.addBindValue(viewerId);
+    query.addBindValue(viewerId);
+    query.addBindValue(viewerId);
+
     if (query.exec()) {
         while (query.next()) {
             ChatSession session;
@@ -362,15 +722,19 @@ QList<ChatSession> DatabaseManager::getActiveSessions()
             session.staffId = query.value("staff_id").toInt();
             session.visitorName = query.value("visitor_name").toString();
             session.staffName = query.value("staff_name").toString();
-            session.createdAt = query.value("created_at").toDateTime();
-            session.lastMessageAt = query.value("last_message_at").toDateTime();
+            session.createdAt = EpochTime::fromColumn(query.value("created_at"));
+            session.lastMessageAt = EpochTime::fromColumn(query.value("last_message_at"));
             session.status = query.value("status").toInt();
             session.lastMessage = query.value("last_message").toString();
+            session.messageCount = query.value("message_count").toInt();
+            session.unreadCount = query.value("unread_count").toInt();
 
             sessions.append(session);
         }
     }
 
+    query.finish();
+
     return sessions;
 }
 
@@ -378,7 +742,7 @@ QList<ChatSession> DatabaseManager::getvisitorSessions(int visitorId)
 {
     QList<ChatSession> sessions;
 
-    QSqlQuery query(m_database);
+    QSqlQuery query(connection());
     query.prepare(R"(
         SELECT id, visitor_id, staff_id, visitor_name, staff_name,
                created_at, last_message_at, status, last_message
@@ -397,8 +761,8 @@ QList<ChatSession> DatabaseManager::getvisitorSessions(int visitorId)
             session.staffId = query.value("staff_id").toInt();
             session.visitorName = query.value("visitor_name").toString();
             session.staffName = query.value("staff_name").toString();
-            session.createdAt = query.value("created_at").toDateTime();
-            session.lastMessageAt = query.value("last_message_at").toDateTime();
+            session.createdAt = EpochTime::fromColumn(query.value("created_at"));
+            session.lastMessageAt = EpochTime::fromColumn(query.value("last_message_at"));
             session.status = query.value("status").toInt();
             session.lastMessage = query.value("last_message").toString();
 
@@ -413,7 +777,7 @@ QList<ChatSession> DatabaseManager::getStaffSessions(int staffId)
 {
     QList<ChatSession> sessions;
 
-    QSqlQuery query(m_database);
+    QSqlQuery query(connection());
     query.prepare(R"(
         SELECT id, visitor_id, staff_id, visitor_name, staff_name,
                created_at, last_message_at, status, last_message
@@ -432,8 +796,8 @@ QList<ChatSession> DatabaseManager::getStaffSessions(int staffId)
             session.staffId = query.value("staff_id").toInt();
             session.visitorName = query.value("visitor_name").toString();
             session.staffName = query.value("staff_name").toString();
-            session.createdAt = query.value("created_at").toDateTime();
-            session.lastMessageAt = query.value("last_message_at").toDateTime();
+            session.createdAt = EpochTime::fromColumn(query.value("created_at"));
+            session.lastMessageAt = EpochTime::fromColumn(query.value("last_message_at"));
             session.status = query.value("status").toInt();
             session.lastMessage = query.value("last_message").toString();
 
@@ -448,10 +812,9 @@ ChatSession DatabaseManager::getChatSession(int sessionId)
 {
     ChatSession session;
 
-    QSqlQuery query(m_database);
-    query.prepare(R"(
+    QSqlQuery& query = statements().prepared(R"(
         SELECT id, visitor_id, staff_id, visitor_name, staff_name,
-               created_at, last_message_at, status, last_message
+               created_at, last_message_at, status, last_message, message_count
         FROM chat_sessions
         WHERE id = ?
     )");
@@ -464,12 +827,15 @@ ChatSession DatabaseManager::getChatSession(int sessionId)
         session.staffId = query.value("staff_id").toInt();
         session.visitorName = query.value("visitor_name").toString();
         session.staffName = query.value("staff_name").toString();
-        session.createdAt = query.value("created_at").toDateTime();
-        session.lastMessageAt = query.value("last_message_at").toDateTime();
+        session.createdAt = EpochTime::fromColumn(query.value("created_at"));
+        session.lastMessageAt = EpochTime::fromColumn(query.value("last_message_at"));
         session.status = query.value("status").toInt();
         session.lastMessage = query.value("last_message").toString();
+        session.messageCount = query.value("message_count").toInt();
     }
 
+    query.finish();
+
     return session;
 }
 
@@ -486,33 +852,25 @@ int DatabaseManager::sendMessage(int sessionId, int senderId, const QString& con
         senderRole = sender.role;
     }
 
-    QSqlQuery query(m_database);
-    query.prepare(R"(
-        INSERT INTO chat_messages (session_id, sender_id, sender_name, sender_role, content, message_type)
-        VALUES (?, ?, ?, ?, ?, ?)
+    QSqlQuery& query = statements().prepared(R"(
+        INSERT INTO chat_messages (session_id, sender_id, sender_name, sender_role, content, message_type, timestamp)
+        VALUES (?, ?, ?, ?, ?, ?, ?)
     )");
 
+    const QDateTime now = QDateTime::currentDateTime();
     query.addBindValue(sessionId);
     query.addBindValue(senderId);
     query.addBindValue(senderName);
     query.addBindValue(senderRole);
     query.addBindValue(content);
     query.addBindValue(messageType);
+    query.addBindValue(EpochTime::toMs(now));
 
+    // 会话的最后消息、消息数和未读数由 trg_chat_messages_session_summary
+    // 在同一个隐式事务中更新，整条发送路径只有这一次提交
     if (query.exec()) {
         int messageId = query.lastInsertId().toInt();
 
-        // 更新会话的最后消息时间和内容
-        QSqlQuery updateQuery(m_database);
-        updateQuery.prepare(R"(
-            UPDATE chat_sessions
-            SET last_message_at = CURRENT_TIMESTAMP, last_message = ?
-            WHERE id = ?
-        )");
-        updateQuery.addBindValue(content);
-        updateQuery.addBindValue(sessionId);
-        updateQuery.exec();
-
         // 获取完整消息信息并发送信号
         ChatMessage message;
         message.id = messageId;
@@ -521,7 +879,7 @@ int DatabaseManager::sendMessage(int sessionId, int senderId, const QString& con
         message.senderName = senderName;
         message.senderRole = senderRole;
         message.content = content;
-        message.timestamp = QDateTime::currentDateTime();
+        message.timestamp = now;
         message.messageType = messageType;
         message.isRead = 0;
 
@@ -533,40 +891,316 @@ int DatabaseManager::sendMessage(int sessionId, int senderId, const QString& con
     return -1;
 }
 
+QList<int> DatabaseManager::sendMessages(const QList<OutgoingMessage>& messages, QSqlError* error)
+{
+    QList<int> messageIds;
+    if (messages.isEmpty()) {
+        return messageIds;
+    }
+
+    QSqlDatabase db = connection();
+    if (!db.transaction()) {
+        qDebug() << "批量发送消息开启事务失败:" << db.lastError().text();
+        if (error) *error = db.lastError();
+        return messageIds;
+    }
+
+    QList<ChatMessage> inserted;
+    for (const OutgoingMessage& outgoing : messages) {
+        QString senderName = "系统";
+        QString senderRole = "system";
+        if (outgoing.senderId > 0) {
+            UserInfo sender = getUserInfo(outgoing.senderId);
+            senderName = sender.realName.isEmpty() ? sender.username : sender.realName;
+            senderRole = sender.role;
+        }
+
+        // 上一次提交其实已成功（只是调用方没收到结果）时，唯一索引让重复插入变成空操作
+        QSqlQuery& insert = statements().prepared(R"(
+            INSERT OR IGNORE INTO chat_messages
+                (session_id, sender_id, sender_name, sender_role, content, message_type, client_msg_id, timestamp)
+            VALUES (?, ?, ?, ?, ?, ?, ?, ?)
+        )");
+        const QDateTime now = QDateTime::currentDateTime();
+        insert.addBindValue(outgoing.sessionId);
+        insert.addBindValue(outgoing.senderId);
+        insert.addBindValue(senderName);
+        insert.addBindValue(senderRole);
+        insert.addBindValue(outgoing.content);
+        insert.addBindValue(outgoing.messageType);
+        // 没有 clientMsgId 的消息写入 NULL，不受唯一索引约束
+        insert.addBindValue(outgoing.clientMsgId.isEmpty() ? QVariant() : QVariant(outgoing.clientMsgId));
+        insert.addBindValue(EpochTime::toMs(now));
+
+        if (!insert.exec()) {
+            qDebug() << "批量发送消息失败:" << insert.lastError().text();
+            if (error) *error = insert.lastError();
+            db.rollback();
+            return QList<int>();
+        }
+
+        if (insert.numRowsAffected() > 0) {
+            ChatMessage message;
+            message.id = insert.lastInsertId().toInt();
+            message.sessionId = outgoing.sessionId;
+            message.senderId = outgoing.senderId;
+            message.senderName = senderName;
+            message.senderRole = senderRole;
+            message.content = outgoing.content;
+            message.timestamp = now;
+            message.messageType = outgoing.messageType;
+            message.isRead = 0;
+            inserted.append(message);
+            messageIds.append(message.id);
+            continue;
+        }
+
+        QSqlQuery& existing = statements().prepared(
+            "SELECT id FROM chat_messages WHERE client_msg_id = ?");
+        existing.addBindValue(outgoing.clientMsgId);
+        int messageId = (existing.exec() && existing.next()) ? existing.value(0).toInt() : -1;
+        existing.finish();
+        messageIds.append(messageId);
+    }
+
+    if (!db.commit()) {
+        qDebug() << "批量发送消息提交失败:" << db.lastError().text();
+        if (error) *error = db.lastError();
+        db.rollback();
+        return QList<int>();
+    }
+
+    for (const ChatMessage& message : inserted) {
+        emit newMessageReceived(message);
+    }
+    return messageIds;
+}
+
+// 从查询结果的当前行读取一条消息
+static ChatMessage readChatMessage(const QSqlQuery& query)
+{
+    ChatMessage message;
+    message.id = query.value("id").toInt();
+    message.sessionId = query.value("session_id").toInt();
+    message.senderId = query.value("sender_id").toInt();
+    message.senderName = query.value("sender_name").toString();
+    message.senderRole = query.value("sender_role").toString();
+    message.content = query.value("content").toString();
+    message.timestamp = EpochTime::fromColumn(query.value("timestamp"));
+    message.messageType = query.value("message_type").toInt();
+    message.isRead = query.value("is_read").toInt();
+    return message;
+}
+
 QList<ChatMessage> DatabaseManager::getChatMessages(int sessionId, int limit)
+{
+    // 最近的 limit 条消息，按时间正序返回
+    return getChatMessagesBefore(sessionId, 0, limit);
+}
+
+QList<ChatMessage> DatabaseManager::getChatMessagesBefore(int sessionId, int beforeMessageId, int limit)
 {
     QList<ChatMessage> messages;
 
-    QSqlQuery query(m_database);
-    query.prepare(R"(
+    // 以 (timestamp, id) 为游标倒序取一页。timestamp <= 游标 作为
+    // (session_id, timestamp) 索引上的范围条件，因此每页的开销与翻到多深无关
+    static const QString latestSql = R"(
         SELECT id, session_id, sender_id, sender_name, sender_role,
                content, timestamp, message_type, is_read
         FROM chat_messages
         WHERE session_id = ?
-        ORDER BY timestamp ASC
+        ORDER BY timestamp DESC, id DESC
         LIMIT ?
-    )");
+    )";
+    static const QString beforeSql = R"(
+        SELECT id, session_id, sender_id, sender_name, sender_role,
+               content, timestamp, message_type, is_read
+        FROM chat_messages
+        WHERE session_id = ?
+          AND timestamp <= (SELECT timestamp FROM chat_messages WHERE id = ?)
+          AND (timestamp, id) < (SELECT timestamp, id FROM chat_messages WHERE id = ?)
+        ORDER BY timestamp DESC, id DESC
+        LIMIT ?
+    )";
+
+    // beforeMessageId <= 0 表示从最新消息开始
+    QSqlQuery& query = statements().prepared(beforeMessageId > 0 ? beforeSql : latestSql);
 
     query.addBindValue(sessionId);
+    if (beforeMessageId > 0) {
+        query.addBindValue(beforeMessageId);
+        query.addBindValue(beforeMessageId);
+    }
     query.addBindValue(limit);
 
     if (query.exec()) {
         while (query.next()) {
-            ChatMessage message;
-            message.id = query.value("id").toInt();
-            message.sessionId = query.value("session_id").toInt();
-            message.senderId = query.value("sender_id").toInt();
-            message.senderName = query.value("sender_name").toString();
-            message.senderRole = query.value("sender_role").toString();
-            message.content = query.value("content").toString();
-            message.timestamp = query.value("timestamp").toDateTime();
-            message.messageType = query.value("message_type").toInt();
-            message.isRead = query.value("is_read").toInt();
+            messages.prepend(readChatMessage(query));
+        }
+    }
 
+    query.finish();
+
+    // 热表不足一页时，更早的消息可能已被归档，从归档库接着往前读剩下的部分
+    if (messages.size() < limit && ChatArchiver::instance()->isArchived(sessionId)) {
+        const int archivedBefore = messages.isEmpty() ? beforeMessageId : messages.first().id;
+        messages = ChatArchiver::instance()->loadArchivedMessages(
+                       sessionId, archivedBefore, limit - messages.size()) + messages;
+    }
+
+    return messages;
+}
+
+QList<ChatMessage> DatabaseManager::getMessagesSince(int sessionId, int lastSeenMessageId, int limit)
+{
+    QList<ChatMessage> messages;
+
+    QSqlQuery& query = statements().prepared(R"(
+        SELECT id, session_id, sender_id, sender_name, sender_role,
+               content, timestamp, message_type, is_read, client_msg_id
+        FROM chat_messages
+        WHERE session_id = ? AND id > ?
+        ORDER BY id ASC
+        LIMIT ?
+    )");
+
+    query.addBindValue(sessionId);
+    query.addBindValue(lastSeenMessageId);
+    query.addBindValue(limit);
+
+    if (query.exec()) {
+        while (query.next()) {
+            ChatMessage message = readChatMessage(query);
+            message.clientMsgId = query.value("client_msg_id").toString();
             messages.append(message);
         }
+    } else {
+        qDebug() << "增量同步消息失败:" << query.lastError().text();
+    }
+
+    query.finish();
+
+    return messages;
+}
+
+QList<ChatSearchResult> DatabaseManager::searchMessages(const QString& text, int sessionId, int limit)
+{
+    QList<ChatSearchResult> results;
+
+    const QStringList terms = FullTextSearch::splitTerms(text);
+    if (terms.isEmpty()) {
+        return results;
+    }
+
+    // 能走索引的词用 MATCH，短词在命中结果上再用 LIKE 过滤
+    const QStringList indexedTerms = m_fullTextIndex ? FullTextSearch::indexedTerms(terms) : QStringList();
+    const QStringList likeTerms = indexedTerms.isEmpty() ? terms : FullTextSearch::shortTerms(terms);
+
+    QStringList conditions;
+    if (sessionId > 0) {
+        conditions.append("m.session_id = ?");
+    }
+    for (int i = 0; i < likeTerms.size(); ++i) {
+        conditions.append("m.content LIKE ? ESCAPE '\\'");
+    }
+
+    QSqlQuery query(connection());
+    if (!indexedTerms.isEmpty()) {
+        query.prepare(QString(R"(
+            SELECT m.id, m.session_id, m.sender_id, m.sender_name, m.sender_role,
+                   m.content, m.timestamp, m.message_type, m.is_read,
+                   snippet(chat_messages_fts, 0, ?, ?, '…', 24) AS snippet,
+                   bm25(chat_messages_fts) AS rank
+            FROM chat_messages_fts
+            JOIN chat_messages m ON m.id = chat_messages_fts.rowid
+            WHERE chat_messages_fts MATCH ? %1
+            ORDER BY rank
+            LIMIT ?
+        )").arg(conditions.isEmpty() ? QString() : "AND " + conditions.join(" AND ")));
+        query.addBindValue(QString(FullTextSearch::HIGHLIGHT_BEGIN));
+        query.addBindValue(QString(FullTextSearch::HIGHLIGHT_END));
+        query.addBindValue(FullTextSearch::matchExpression(indexedTerms));
+    } else {
+        // 没有可用的索引词时按时间倒序扫描，命中足够条数即停止
+        query.prepare(QString(R"(
+            SELECT m.id, m.session_id, m.sender_id, m.sender_name, m.sender_role,
+                   m.content, m.timestamp, m.message_type, m.is_read
+            FROM chat_messages m
+            WHERE %1
+            ORDER BY m.id DESC
+            LIMIT ?
+        )").arg(conditions.join(" AND ")));
+    }
+
+    if (sessionId > 0) {
+        query.addBindValue(sessionId);
+    }
+    for (const QString& term : likeTerms) {
+        query.addBindValue(FullTextSearch::likePattern(term));
+    }
+    query.addBindValue(limit);
+
+    if (!query.exec()) {
+        qDebug() << "检索聊天记录失败:" << query.lastError().text();
+        return results;
+    }
+
+    while (query.next()) {
+        ChatSearchResult result;
+        result.message = readChatMessage(query);
+        if (!indexedTerms.isEmpty()) {
+            result.snippetHtml = FullTextSearch::snippetToHtml(query.value("snippet").toString());
+            result.score = -query.value("rank").toDouble();
+        } else {
+            result.snippetHtml = FullTextSearch::makeSnippet(result.message.content, terms);
+        }
+        results.append(result);
+    }
+
+    return results;
+}
+
+QList<ChatMessage> DatabaseManager::getChatMessagesAfter(int sessionId, int afterMessageId, int limit)
+{
+    QList<ChatMessage> messages;
+
+    static const QString firstSql = R"(
+        SELECT id, session_id, sender_id, sender_name, sender_role,
+               content, timestamp, message_type, is_read
+        FROM chat_messages
+        WHERE session_id = ?
+        ORDER BY timestamp ASC, id ASC
+        LIMIT ?
+    )";
+    static const QString afterSql = R"(
+        SELECT id, session_id, sender_id, sender_name, sender_role,
+               content, timestamp, message_type, is_read
+        FROM chat_messages
+        WHERE session_id = ?
+          AND timestamp >= (SELECT timestamp FROM chat_messages WHERE id = ?)
+          AND (timestamp, id) > (SELECT timestamp, id FROM chat_messages WHERE id = ?)
+        ORDER BY timestamp ASC, id ASC
+        LIMIT ?
+    )";
+
+    // afterMessageId <= 0 表示从第一条消息开始
+    QSqlQuery& query = statements().prepared(afterMessageId > 0 ? afterSql : firstSql);
+
+    query.addBindValue(sessionId);
+    if (afterMessageId > 0) {
+        query.addBindValue(afterMessageId);
+        query.addBindValue(afterMessageId);
+    }
+    query.addBindValue(limit);
+
+    if (query.exec()) {
+        while (query.next()) {
+            messages.append(readChatMessage(query));
+        }
     }
 
+    query.finish();
+
     return messages;
 }
 
@@ -574,76 +1208,210 @@ QList<ChatMessage> DatabaseManager::getUnreadMessages(int userId)
 {
     QList<ChatMessage> messages;
 
-    QSqlQuery query(m_database);
+    QSqlQuery query(connection());
     query.prepare(R"(
         SELECT m.id, m.session_id, m.sender_id, m.sender_name, m.sender_role,
-               m.content, m.timestamp, m.message_type, m.is_read
-        FROM chat_messages m
-        JOIN chat_sessions s ON m.session_id = s.id
+               m.content, m.timestamp, m.message_type, 0 AS is_read
+        FROM chat_sessions s
+        LEFT JOIN session_read_state r ON r.session_id = s.id AND r.user_id = ?
+        JOIN chat_messages m ON m.session_id = s.id AND m.id > COALESCE(r.last_read_message_id, 0)
         WHERE (s.visitor_id = ? OR s.staff_id = ?)
         AND m.sender_id != ?
-        AND m.is_read = 0
-        ORDER BY m.timestamp ASC
+        ORDER BY m.timestamp ASC, m.id ASC
     )");
 
     query.addBindValue(userId);
     query.addBindValue(userId);
     query.addBindValue(userId);
+    query.addBindValue(userId);
 
     if (query.exec()) {
         while (query.next()) {
-            ChatMessage message;
-            message.id = query.value("id").toInt();
-            message.sessionId = query.value("session_id").toInt();
-            message.senderId = query.value("sender_id").toInt();
-            message.senderName = query.value("sender_name").toString();
-            message.senderRole = query.value("sender_role").toString();
-            message.content = query.value("content").toString();
-            message.timestamp = query.value("timestamp").toDateTime();
-            message.messageType = query.value("message_type").toInt();
-            message.isRead = query.value("is_read").toInt();
+            messages.append(readChatMessage(query));
+        }
+    }
 
-            messages.append(message);
+    return messages;
+}
+
+QList<ChatMessage> DatabaseManager::getUnreadSessionMessages(int sessionId, int userId)
+{
+    QList<ChatMessage> messages;
+
+    QSqlQuery& query = statements().prepared(R"(
+        SELECT id, session_id, sender_id, sender_name, sender_role,
+               content, timestamp, message_type, 0 AS is_read
+        FROM chat_messages
+        WHERE session_id = ?
+          AND id > COALESCE((SELECT last_read_message_id FROM session_read_state
+                             WHERE session_id = ? AND user_id = ?), 0)
+          AND sender_id != ?
+        ORDER BY id ASC
+    )");
+
+    query.addBindValue(sessionId);
+    query.addBindValue(sessionId);
+    query.addBindValue(userId);
+    query.addBindValue(userId);
+
+    if (query.exec()) {
+        while (query.next()) {
+            messages.append(readChatMessage(query));
         }
     }
 
+    query.finish();
+
     return messages;
 }
 
-bool DatabaseManager::markMessageAsRead(int messageId)
+int DatabaseManager::getUnreadCount(int sessionId, int userId)
 {
-    QSqlQuery query(m_database);
-    query.prepare("UPDATE chat_messages SET is_read = 1 WHERE id = ?");
+    QSqlQuery& query = statements().prepared(R"(
+        SELECT COALESCE(
+            (SELECT unread_count FROM session_read_state WHERE session_id = ? AND user_id = ?),
+            (SELECT COUNT(*) FROM chat_messages WHERE session_id = ? AND sender_id != ?))
+    )");
+
+    query.addBindValue(sessionId);
+    query.addBindValue(userId);
+    query.addBindValue(sessionId);
+    query.addBindValue(userId);
+
+    int count = 0;
+    if (query.exec() && query.next()) {
+        count = query.value(0).toInt();
+    }
+
+    query.finish();
+
+    return count;
+}
+
+bool DatabaseManager::markReadUpTo(int sessionId, int userId, int messageId)
+{
+    QSqlDatabase db = connection();
+    if (!db.transaction()) {
+        return false;
+    }
+
+    // 水位只前进不后退，乱序到达的旧消息不会把水位拉回去
+    QSqlQuery& query = statements().prepared(R"(
+        INSERT INTO session_read_state (session_id, user_id, last_read_message_id, updated_at)
+        VALUES (?, ?, ?, ?)
+        ON CONFLICT (session_id, user_id) DO UPDATE
+        SET last_read_message_id = MAX(last_read_message_id, excluded.last_read_message_id),
+            updated_at = excluded.updated_at
+    )");
+
+    query.addBindValue(sessionId);
+    query.addBindValue(userId);
     query.addBindValue(messageId);
+    query.addBindValue(EpochTime::nowMs());
+
+    // 未读数只需数水位之后的一小段索引
+    QSqlQuery& countQuery = statements().prepared(R"(
+        UPDATE session_read_state
+        SET unread_count = (SELECT COUNT(*) FROM chat_messages m
+                            WHERE m.session_id = session_read_state.session_id
+                              AND m.id > session_read_state.last_read_message_id
+                              AND m.sender_id != session_read_state.user_id)
+        WHERE session_id = ? AND user_id = ?
+    )");
 
-    return query.exec();
+    countQuery.addBindValue(sessionId);
+    countQuery.addBindValue(userId);
+
+    if (!query.exec() || !countQuery.exec()) {
+        db.rollback();
+        return false;
+    }
+
+    return db.commit();
 }
 
 bool DatabaseManager::markSessionAsRead(int sessionId, int userId)
 {
-    QSqlQuery query(m_database);
-    query.prepare(R"(
-        UPDATE chat_messages
-        SET is_read = 1
-        WHERE session_id = ? AND sender_id != ?
+    // 把水位移到会话的最后一条消息，不再逐行改写
+    QSqlQuery& query = statements().prepared(R"(
+        INSERT INTO session_read_state (session_id, user_id, last_read_message_id, unread_count, updated_at)
+        SELECT ?, ?, last_message_id, 0, ? FROM chat_sessions WHERE id = ?
+        ON CONFLICT (session_id, user_id) DO UPDATE
+        SET last_read_message_id = MAX(last_read_message_id, excluded.last_read_message_id),
+            unread_count = 0,
+            updated_at = excluded.updated_at
     )");
 
     query.addBindValue(sessionId);
     query.addBindValue(userId);
+    query.addBindValue(EpochTime::nowMs());
+    query.addBindValue(sessionId);
 
     return query.exec();
 }
 
+// ========== 变更通知 ==========
+
+qint64 DatabaseManager::getDataVersion()
+{
+    // data_version 只在其他连接提交后变化，不读取任何数据页，开销极低
+    QSqlQuery query(connection());
+    if (query.exec("PRAGMA data_version") && query.next()) {
+        return query.value(0).toLongLong();
+    }
+    return -1;
+}
+
+qint64 DatabaseManager::getLatestChangeSeq()
+{
+    QSqlQuery query(connection());
+    if (query.exec("SELECT COALESCE(MAX(seq), 0) FROM chat_changes") && query.next()) {
+        return query.value(0).toLongLong();
+    }
+    return 0;
+}
+
+QList<ChatChange> DatabaseManager::getChangesSince(qint64 seq, int limit)
+{
+    QList<ChatChange> changes;
+
+    QSqlQuery& query = statements().prepared(R"(
+        SELECT seq, session_id, kind
+        FROM chat_changes
+        WHERE seq > ?
+        ORDER BY seq ASC
+        LIMIT ?
+    )");
+
+    query.addBindValue(seq);
+    query.addBindValue(limit);
+
+    if (query.exec()) {
+        while (query.next()) {
+            ChatChange change;
+            change.seq = query.value(0).toLongLong();
+            change.sessionId = query.value(1).toInt();
+            change.kind = query.value(2).toInt();
+            changes.append(change);
+        }
+    }
+
+    query.finish();
+
+    return changes;
+}
+
 // ========== 在线状态管理 ==========
 
 bool DatabaseManager::updateUserOnlineStatus(int userId, bool isOnline)
 {
-    QSqlQuery query(m_database);
+    QSqlQuery query(connection());
     query.prepare("UPDATE users SET is_online = ? WHERE id = ?");
     query.addBindValue(isOnline ? 1 : 0);
     query.addBindValue(userId);
 
     if (query.exec()) {
+        m_userCache->invalidate(userId);
         emit userOnlineStatusChanged(userId, isOnline);
         return true;
     }
@@ -655,7 +1423,7 @@ QList<UserInfo> DatabaseManager::getOnlineStaff()
 {
     QList<UserInfo> staffList;
 
-    QSqlQuery query(m_database);
+    QSqlQuery query(connection());
     query.prepare(R"(
         SELECT id, username, email, phone, role, real_name,
                created_at, last_login, status, avatar_path
@@ -673,8 +1441,8 @@ QList<UserInfo> DatabaseManager::getOnlineStaff()
             user.phone = query.value("phone").toString();
             user.role = query.value("role").toString();
             user.realName = query.value("real_name").toString();
-            user.createdAt = query.value("created_at").toDateTime();
-            user.lastLogin = query.value("last_login").toDateTime();
+            user.createdAt = EpochTime::fromColumn(query.value("created_at"));
+            user.lastLogin = EpochTime::fromColumn(query.value("last_login"));
             user.status = query.value("status").toInt();
             user.avatarPath = query.value("avatar_path").toString();
 
@@ -691,7 +1459,7 @@ QList<UserInfo> DatabaseManager::getAllUsers()
 {
     QList<UserInfo> users;
 
-    QSqlQuery query(m_database);
+    QSqlQuery query(connection());
     query.prepare(R"(
         SELECT id, username, email, phone, role, real_name,
                created_at, last_login, status, avatar_path
@@ -709,8 +1477,8 @@ QList<UserInfo> DatabaseManager::getAllUsers()
             user.phone = query.value("phone").toString();
             user.role = query.value("role").toString();
             user.realName = query.value("real_name").toString();
-            user.createdAt = query.value("created_at").toDateTime();
-            user.lastLogin = query.value("last_login").toDateTime();
+            user.createdAt = EpochTime::fromColumn(query.value("created_at"));
+            user.lastLogin = EpochTime::fromColumn(query.value("last_login"));
             user.status = query.value("status").toInt();
             user.avatarPath = query.value("avatar_path").toString();
 
@@ -725,7 +1493,7 @@ QList<UserInfo> DatabaseManager::getUsersByRole(const QString& role)
 {
     QList<UserInfo> users;
 
-    QSqlQuery query(m_database);
+    QSqlQuery query(connection());
     query.prepare(R"(
         SELECT id, username, email, phone, role, real_name,
                created_at, last_login, status, avatar_path
@@ -745,8 +1513,8 @@ QList<UserInfo> DatabaseManager::getUsersByRole(const QString& role)
             user.phone = query.value("phone").toString();
             user.role = query.value("role").toString();
             user.realName = query.value("real_name").toString();
-            user.createdAt = query.value("created_at").toDateTime();
-            user.lastLogin = query.value("last_login").toDateTime();
+            user.createdAt = EpochTime::fromColumn(query.value("created_at"));
+            user.lastLogin = EpochTime::fromColumn(query.value("last_login"));
             user.status = query.value("status").toInt();
             user.avatarPath = query.value("avatar_path").toString();
 
@@ -759,7 +1527,7 @@ QList<UserInfo> DatabaseManager::getUsersByRole(const QString& role)
 
 bool DatabaseManager::isUsernameExists(const QString& username)
 {
-    QSqlQuery query(m_database);
+    QSqlQuery query(connection());
     query.prepare("SELECT COUNT(*) FROM users WHERE username = ?");
     query.addBindValue(username);
 
@@ -774,7 +1542,7 @@ bool DatabaseManager::isEmailExists(const QString& email)
 {
     if (email.isEmpty()) return false;
 
-    QSqlQuery query(m_database);
+    QSqlQuery query(connection());
     query.prepare("SELECT COUNT(*) FROM users WHERE email = ?");
     query.addBindValue(email);
 
@@ -799,8 +1567,12 @@ UserInfo DatabaseManager::getUserInfo(int userId)
 {
     UserInfo userInfo;
 
-    QSqlQuery query(m_database);
-    query.prepare(R"(
+    // 发消息、建会话时都要解析用户名，绝大多数情况下直接命中缓存
+    if (m_userCache->get(userId, userInfo)) {
+        return userInfo;
+    }
+
+    QSqlQuery& query = statements().prepared(R"(
         SELECT id, username, email, phone, role, real_name, created_at, last_login, status, avatar_path
         FROM users
         WHERE id = ?
@@ -815,18 +1587,61 @@ UserInfo DatabaseManager::getUserInfo(int userId)
         userInfo.phone = query.value("phone").toString();
         userInfo.role = query.value("role").toString();
         userInfo.realName = query.value("real_name").toString();
-        userInfo.createdAt = query.value("created_at").toDateTime();
-        userInfo.lastLogin = query.value("last_login").toDateTime();
+        userInfo.createdAt = EpochTime::fromColumn(query.value("created_at"));
+        userInfo.lastLogin = EpochTime::fromColumn(query.value("last_login"));
         userInfo.status = query.value("status").toInt();
         userInfo.avatarPath = query.value("avatar_path").toString();
+        m_userCache->put(userInfo);
     }
 
+    query.finish();
+
     return userInfo;
 }
 
+UserInfo DatabaseManager::getUserInfoByUsername(const QString& username)
+{
+    UserInfo userInfo;
+
+    if (m_userCache->getByUsername(username, userInfo)) {
+        return userInfo;
+    }
+
+    QSqlQuery& query = statements().prepared(R"(
+        SELECT id, username, email, phone, role, real_name, created_at, last_login, status, avatar_path
+        FROM users
+        WHERE username = ?
+    )");
+
+    query.addBindValue(username);
+
+    if (query.exec() && query.next()) {
+        userInfo.id = query.value("id").toInt();
+        userInfo.username = query.value("username").toString();
+        userInfo.email = query.value("email").toString();
+        userInfo.phone = query.value("phone").toString();
+        userInfo.role = query.value("role").toString();
+        userInfo.realName = query.value("real_name").toString();
+        userInfo.createdAt = EpochTime::fromColumn(query.value("created_at"));
+        userInfo.lastLogin = EpochTime::fromColumn(query.value("last_login"));
+        userInfo.status = query.value("status").toInt();
+        userInfo.avatarPath = query.value("avatar_path").toString();
+        m_userCache->put(userInfo);
+    }
+
+    query.finish();
+
+    return userInfo;
+}
+
+UserCache& DatabaseManager::userCache()
+{
+    return *m_userCache;
+}
+
 bool DatabaseManager::updateUserInfo(const UserInfo& userInfo)
 {
-    QSqlQuery query(m_database);
+    QSqlQuery query(connection());
     query.prepare(R"(
         UPDATE users
         SET email = ?, phone = ?, real_name = ?, avatar_path = ?
@@ -839,13 +1654,15 @@ bool DatabaseManager::updateUserInfo(const UserInfo& userInfo)
     query.addBindValue(userInfo.avatarPath);
     query.addBindValue(userInfo.id);
 
-    return query.exec();
+    bool ok = query.exec();
+    m_userCache->invalidate(userInfo.id);
+    return ok;
 }
 
 bool DatabaseManager::changePassword(int userId, const QString& oldPassword, const QString& newPassword)
 {
     // 先验证旧密码
-    QSqlQuery query(m_database);
+    QSqlQuery query(connection());
     query.prepare("SELECT password_hash FROM users WHERE id = ?");
     query.addBindValue(userId);
 
@@ -863,5 +1680,7 @@ bool DatabaseManager::changePassword(int userId, const QString& oldPassword, con
     query.addBindValue(hashPassword(newPassword));
     query.addBindValue(userId);
 
-    return query.exec();
+    bool ok = query.exec();
+    m_userCache->invalidate(userId);
+    return ok;
 }
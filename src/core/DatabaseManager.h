@@ -7,6 +7,9 @@
 #include <QString>
 #include <QDateTime>
 #include <QCryptographicHash>
+#include <QMutex>
+#include <QHash>
+#include "SqlStatementCache.h"
 
 struct UserInfo {
     int id;
@@ -32,6 +35,8 @@ struct ChatSession {
     QDateTime lastMessageAt;
     int status; // 0-已结束, 1-进行中, 2-等待中
     QString lastMessage;
+    int messageCount = 0; // 由触发器维护
+    int unreadCount = 0; // 查看者的未读消息数，仅在指定查看者的查询中填充
 };
 
 // 聊天消息信息
@@ -45,6 +50,32 @@ struct ChatMessage {
     QDateTime timestamp;
     int messageType; // 0-普通消息, 1-系统消息, 2-图片, 3-文件
     int isRead; // 0-未读, 1-已读
+    QString clientMsgId; // 经发件箱发送的消息才有，仅 getMessagesSince 填充
+};
+
+// 待写入的消息，clientMsgId 由发件箱生成，重试时用于去重（为空表示不去重）
+struct OutgoingMessage {
+    QString clientMsgId;
+    int sessionId;
+    int senderId;
+    QString content;
+    int messageType;
+};
+
+// 聊天记录检索结果
+struct ChatSearchResult {
+    ChatMessage message;
+    QString snippetHtml; // 命中附近的文字，命中词已高亮
+    double score = 0;    // 相关度（bm25 取反，越大越相关），LIKE 回退时为 0
+};
+
+class UserCache;
+
+// 聊天变更记录（chat_changes 表）
+struct ChatChange {
+    qint64 seq;
+    int sessionId;
+    int kind; // 0-新消息, 1-会话状态变化
 };
 
 class DatabaseManager : public QObject
@@ -58,6 +89,14 @@ public:
     bool initDatabase();
     void closeDatabase();
 
+    // 当前线程使用的数据库连接（非主线程按需创建独立连接）
+    QSqlDatabase connection();
+    void releaseThreadConnection();
+
+    // 当前线程连接上的预编译语句缓存，以及所有连接的命中统计
+    SqlStatementCache& statements();
+    SqlStatementCache::Stats statementCacheStats();
+
     // 用户管理
     bool registerUser(const QString& username, const QString& password,
                       const QString& email, const QString& phone,
@@ -71,8 +110,10 @@ public:
     QString hashPassword(const QString& password);
     bool verifyPassword(const QString& password, const QString& hash);
 
-    // 用户信息
+    // 用户信息（优先读取缓存，修改用户的方法会使缓存失效）
     UserInfo getUserInfo(int userId);
+    UserInfo getUserInfoByUsername(const QString& username);
+    UserCache& userCache();
     bool updateUserInfo(const UserInfo& userInfo);
     bool changePassword(int userId, const QString& oldPassword, const QString& newPassword);
 
@@ -80,18 +121,40 @@ public:
     int createChatSession(int visitorId, int staffId = 0);
     bool updateChatSession(int sessionId, int staffId);
     bool closeChatSession(int sessionId);
-    QList<ChatSession> getActiveSessions();
+    QList<ChatSession> getActiveSessions(int viewerId = 0);
     QList<ChatSession> getvisitorSessions(int visitorId);
     QList<ChatSession> getStaffSessions(int staffId);
     ChatSession getChatSession(int sessionId);
 
     // 聊天消息管理
     int sendMessage(int sessionId, int senderId, const QString& content, int messageType = 0);
+    // 在一个事务中写入多条消息，返回与输入顺序一致的消息 ID；失败时整批回滚并返回空列表，
+    // error 非空时写入失败原因。已写入过的 clientMsgId 不会重复插入，直接返回原消息 ID
+    QList<int> sendMessages(const QList<OutgoingMessage>& messages, QSqlError* error = nullptr);
     QList<ChatMessage> getChatMessages(int sessionId, int limit = 50);
+    // 游标分页：messageId 之前/之后的 limit 条消息，均按时间正序返回
+    QList<ChatMessage> getChatMessagesBefore(int sessionId, int beforeMessageId, int limit = 50);
+    QList<ChatMessage> getChatMessagesAfter(int sessionId, int afterMessageId, int limit = 50);
+    // 增量同步：会话中 ID 大于 lastSeenMessageId 的消息（含自己从其他实例发送的），按 ID 正序返回。
+    // 消息 ID 单调递增，调用方把已读到的最大 ID 作为游标即可，走 (session_id, id) 索引的范围读
+    QList<ChatMessage> getMessagesSince(int sessionId, int lastSeenMessageId, int limit = 200);
+    // 全文检索聊天记录（sessionId 为 0 时检索所有会话），按相关度排序；
+    // 查询词以空白分隔且须全部命中，不足 3 个字符的词或不支持 FTS5 时退回 LIKE
+    QList<ChatSearchResult> searchMessages(const QString& text, int sessionId = 0, int limit = 50);
+
+    // 已读水位：每个参与者在每个会话中只记录读到的最后一条消息 ID，
+    // 其他人发送的、ID 大于水位的消息即为未读
     QList<ChatMessage> getUnreadMessages(int userId);
-    bool markMessageAsRead(int messageId);
+    QList<ChatMessage> getUnreadSessionMessages(int sessionId, int userId);
+    int getUnreadCount(int sessionId, int userId);
+    bool markReadUpTo(int sessionId, int userId, int messageId);
     bool markSessionAsRead(int sessionId, int userId);
 
+    // 变更通知
+    qint64 getDataVersion();
+    qint64 getLatestChangeSeq();
+    QList<ChatChange> getChangesSince(qint64 seq, int limit = 500);
+
     // 在线状态管理
     bool updateUserOnlineStatus(int userId, bool isOnline);
     QList<UserInfo> getOnlineStaff();
@@ -113,9 +176,19 @@ private:
 
     bool createTables();
     QString getDbPath();
+    QString threadConnectionName() const;
 
     static DatabaseManager* m_instance;
     QSqlDatabase m_database;
+    QString m_dbPath;
+    QMutex m_connectionMutex;
+    QHash<QString, SqlStatementCache*> m_statementCaches;
+    UserCache* m_userCache;
+    bool m_fullTextIndex; // chat_messages_fts 是否可用
 };
 
+Q_DECLARE_METATYPE(UserInfo)
+Q_DECLARE_METATYPE(ChatSession)
+Q_DECLARE_METATYPE(ChatMessage)
+
 #endif // DATABASEMANAGER_H
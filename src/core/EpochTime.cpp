@@ -0,0 +1,56 @@
+#include "EpochTime.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+
+qint64 EpochTime::nowMs()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+qint64 EpochTime::toMs(const QDateTime& dateTime)
+{
+    return dateTime.isValid() ? dateTime.toMSecsSinceEpoch() : 0;
+}
+
+QDateTime EpochTime::fromMs(qint64 ms)
+{
+    return QDateTime::fromMSecsSinceEpoch(ms);
+}
+
+QDateTime EpochTime::fromColumn(const QVariant& value)
+{
+    if (value.isNull()) {
+        return QDateTime();
+    }
+    return fromMs(value.toLongLong());
+}
+
+QString EpochTime::nowMsExpression()
+{
+    return "CAST(ROUND((julianday('now') - 2440587.5) * 86400000.0) AS INTEGER)";
+}
+
+QString EpochTime::textToMsExpression(const QString& column, TextZone zone)
+{
+    // julianday 的纪元偏移为 2440587.5 天；'utc' 修饰符把不带时区的本地时间换算为 UTC，
+    // 带 Z / ±HH:MM 后缀的文本不受影响。无法解析的文本保持原值
+    const QString julian = zone == UtcText
+        ? QString("julianday(%1)").arg(column)
+        : QString("julianday(%1, 'utc')").arg(column);
+    return QString("CASE WHEN typeof(%1) = 'text' AND %2 IS NOT NULL "
+                   "THEN CAST(ROUND((%2 - 2440587.5) * 86400000.0) AS INTEGER) "
+                   "ELSE %1 END").arg(column, julian);
+}
+
+int EpochTime::convertTextColumn(QSqlDatabase& database, const QString& table,
+                                 const QString& column, TextZone zone)
+{
+    QSqlQuery query(database);
+    if (!query.exec(QString("UPDATE %1 SET %2 = %3 WHERE typeof(%2) = 'text'")
+                        .arg(table, column, textToMsExpression(column, zone)))) {
+        qWarning() << "EpochTime: 转换时间列失败:" << table << column << query.lastError().text();
+        return -1;
+    }
+    return query.numRowsAffected();
+}
@@ -0,0 +1,36 @@
+#ifndef EPOCHTIME_H
+#define EPOCHTIME_H
+
+#include <QSqlDatabase>
+#include <QDateTime>
+#include <QVariant>
+#include <QString>
+
+// 时间列统一保存为 Unix 纪元毫秒（INTEGER）：
+// - 写入时绑定 toMs()，读取时 fromColumn() 直接构造 QDateTime，不再逐行解析文本；
+// - 范围查询和排序都是整数比较，与时区、文本格式无关；
+// - 旧库中的文本时间由迁移用 textToMsExpression() 就地转换。
+class EpochTime
+{
+public:
+    // 旧文本时间的写入方式：Cyan.db 用 SQLite 的 CURRENT_TIMESTAMP（UTC），
+    // 其余库绑定 QDateTime 或 ISO 字符串（本地时间，不带时区）
+    enum TextZone { UtcText, LocalText };
+
+    static qint64 nowMs();
+    // 无效时间返回 0
+    static qint64 toMs(const QDateTime& dateTime);
+    static QDateTime fromMs(qint64 ms);
+    // 读取时间列：NULL 返回无效 QDateTime
+    static QDateTime fromColumn(const QVariant& value);
+
+    // 当前时间的毫秒 SQL 表达式，用于触发器等无法绑定参数的地方
+    static QString nowMsExpression();
+    // 把文本时间 column 转换为毫秒的 SQL 表达式，非文本值原样返回
+    static QString textToMsExpression(const QString& column, TextZone zone);
+    // 就地转换 table.column 中的文本时间（table 可带库名前缀），返回转换的行数，-1 表示出错
+    static int convertTextColumn(QSqlDatabase& database, const QString& table,
+                                 const QString& column, TextZone zone);
+};
+
+#endif // EPOCHTIME_H
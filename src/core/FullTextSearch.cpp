@@ -0,0 +1,188 @@
+#include "FullTextSearch.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QRegularExpression>
+#include <QDebug>
+
+const QChar FullTextSearch::HIGHLIGHT_BEGIN = QChar(0x02);
+const QChar FullTextSearch::HIGHLIGHT_END = QChar(0x03);
+
+bool FullTextSearch::isTrigramAvailable(QSqlDatabase& database)
+{
+    // 直接在 temp 库中试建一张 trigram 表，比解析编译选项和版本号更可靠
+    QSqlQuery query(database);
+    if (!query.exec("CREATE VIRTUAL TABLE IF NOT EXISTS temp.fts_trigram_probe USING fts5(x, tokenize='trigram')")) {
+        qDebug() << "FullTextSearch: FTS5 trigram 不可用:" << query.lastError().text();
+        return false;
+    }
+    query.exec("DROP TABLE IF EXISTS temp.fts_trigram_probe");
+    return true;
+}
+
+bool FullTextSearch::createIndex(QSqlDatabase& database, const QString& table,
+                                 const QString& column, const QString& ftsTable)
+{
+    const QStringList statements = {
+        // 外部内容表只存索引，正文仍从原表读取
+        QString("CREATE VIRTUAL TABLE IF NOT EXISTS %3 USING fts5("
+                "%2, content='%1', content_rowid='id', tokenize='trigram')"),
+        QString("CREATE TRIGGER IF NOT EXISTS %3_ai AFTER INSERT ON %1 BEGIN "
+                "INSERT INTO %3(rowid, %2) VALUES (new.id, new.%2); "
+                "END"),
+        QString("CREATE TRIGGER IF NOT EXISTS %3_ad AFTER DELETE ON %1 BEGIN "
+                "INSERT INTO %3(%3, rowid, %2) VALUES ('delete', old.id, old.%2); "
+                "END"),
+        QString("CREATE TRIGGER IF NOT EXISTS %3_au AFTER UPDATE OF %2 ON %1 BEGIN "
+                "INSERT INTO %3(%3, rowid, %2) VALUES ('delete', old.id, old.%2); "
+                "INSERT INTO %3(rowid, %2) VALUES (new.id, new.%2); "
+                "END"),
+        // 用已有消息回填索引
+        QString("INSERT INTO %3(%3) VALUES ('rebuild')")
+    };
+
+    QSqlQuery query(database);
+    for (const QString& statement : statements) {
+        if (!query.exec(statement.arg(table, column, ftsTable))) {
+            qWarning() << "FullTextSearch: 创建全文索引" << ftsTable << "失败:" << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FullTextSearch::hasIndex(QSqlDatabase& database, const QString& ftsTable)
+{
+    QSqlQuery query(database);
+    query.prepare("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?");
+    query.addBindValue(ftsTable);
+    return query.exec() && query.next();
+}
+
+bool FullTextSearch::ensureIndex(QSqlDatabase& database, const QString& table,
+                                 const QString& column, const QString& ftsTable)
+{
+    if (hasIndex(database, ftsTable)) {
+        return true;
+    }
+    if (!isTrigramAvailable(database)) {
+        return false;
+    }
+
+    if (!database.transaction()) {
+        qWarning() << "FullTextSearch: 补建全文索引" << ftsTable << "时开启事务失败:" << database.lastError().text();
+        return false;
+    }
+    if (!createIndex(database, table, column, ftsTable)) {
+        database.rollback();
+        return false;
+    }
+    if (!database.commit()) {
+        qWarning() << "FullTextSearch: 补建全文索引" << ftsTable << "提交失败:" << database.lastError().text();
+        database.rollback();
+        return false;
+    }
+    qDebug() << "FullTextSearch: 已补建全文索引" << ftsTable;
+    return true;
+}
+
+QStringList FullTextSearch::splitTerms(const QString& text)
+{
+    static const QRegularExpression whitespace("\\s+");
+
+    QStringList terms;
+    for (const QString& term : text.split(whitespace, Qt::SkipEmptyParts)) {
+        if (!terms.contains(term, Qt::CaseInsensitive)) {
+            terms.append(term);
+        }
+    }
+    return terms;
+}
+
+QStringList FullTextSearch::indexedTerms(const QStringList& terms)
+{
+    QStringList result;
+    for (const QString& term : terms) {
+        if (term.size() >= MIN_INDEXED_TERM_LENGTH) {
+            result.append(term);
+        }
+    }
+    return result;
+}
+
+QStringList FullTextSearch::shortTerms(const QStringList& terms)
+{
+    QStringList result;
+    for (const QString& term : terms) {
+        if (term.size() < MIN_INDEXED_TERM_LENGTH) {
+            result.append(term);
+        }
+    }
+    return result;
+}
+
+QString FullTextSearch::matchExpression(const QStringList& terms)
+{
+    // 加引号后用户输入中的 AND/OR/NEAR、* 等不会被当作 FTS5 语法
+    QStringList phrases;
+    for (QString term : terms) {
+        term.replace('"', "\"\"");
+        phrases.append('"' + term + '"');
+    }
+    return phrases.join(' ');
+}
+
+QString FullTextSearch::likePattern(const QString& term)
+{
+    QString escaped = term;
+    escaped.replace('\\', "\\\\");
+    escaped.replace('%', "\\%");
+    escaped.replace('_', "\\_");
+    return '%' + escaped + '%';
+}
+
+QString FullTextSearch::snippetToHtml(const QString& snippet)
+{
+    QString html = snippet.toHtmlEscaped();
+    html.replace(HIGHLIGHT_BEGIN, "<span style=\"background-color:#fff3b0;font-weight:bold;\">");
+    html.replace(HIGHLIGHT_END, "</span>");
+    html.replace('\n', ' ');
+    return html;
+}
+
+QString FullTextSearch::makeSnippet(const QString& content, const QStringList& terms, int contextChars)
+{
+    int firstHit = -1;
+    for (const QString& term : terms) {
+        int pos = content.indexOf(term, 0, Qt::CaseInsensitive);
+        if (pos >= 0 && (firstHit < 0 || pos < firstHit)) {
+            firstHit = pos;
+        }
+    }
+
+    const int start = qMax(0, firstHit - contextChars);
+    const int end = qMin(content.size(), qMax(firstHit, 0) + contextChars * 2);
+    const QString window = content.mid(start, end - start);
+
+    // 逐字扫描，在每个位置取最长的命中词加标记
+    QString marked;
+    int i = 0;
+    while (i < window.size()) {
+        int matched = 0;
+        for (const QString& term : terms) {
+            if (term.size() > matched
+                && QStringView(window).mid(i, term.size()).compare(term, Qt::CaseInsensitive) == 0) {
+                matched = term.size();
+            }
+        }
+        if (matched > 0) {
+            marked += HIGHLIGHT_BEGIN + window.mid(i, matched) + HIGHLIGHT_END;
+            i += matched;
+        } else {
+            marked += window[i++];
+        }
+    }
+
+    if (start > 0) marked.prepend(QChar(0x2026));
+    if (end < content.size()) marked.append(QChar(0x2026));
+    return snippetToHtml(marked);
+}
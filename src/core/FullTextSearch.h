@@ -0,0 +1,51 @@
+#ifndef FULLTEXTSEARCH_H
+#define FULLTEXTSEARCH_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+
+// 聊天记录全文检索的公共部分（Cyan.db 与 chat_history.db 共用）：
+// - 用 FTS5 trigram 分词器建立外部内容索引，按字符三元组切分，中文无需分词即可子串匹配；
+// - 插入、删除、修改由触发器增量维护索引；
+// - 查询词不足 3 个字符（trigram 无法索引）或 SQLite 不支持 FTS5/trigram 时退回 LIKE 扫描。
+class FullTextSearch
+{
+public:
+    // snippet() 中包围命中文字的标记，转换为 HTML 前不会出现在正文中
+    static const QChar HIGHLIGHT_BEGIN;
+    static const QChar HIGHLIGHT_END;
+    // trigram 索引能匹配的最短查询词
+    static const int MIN_INDEXED_TERM_LENGTH = 3;
+
+    // 当前 SQLite 是否启用了 FTS5 且支持 trigram 分词器（SQLite 3.34+）
+    static bool isTrigramAvailable(QSqlDatabase& database);
+
+    // 为 table.column 建立外部内容 FTS5 索引 ftsTable 及维护触发器，并用已有数据回填。
+    // 调用前应先确认 isTrigramAvailable()；table 的主键须为 id（rowid 别名）
+    static bool createIndex(QSqlDatabase& database, const QString& table,
+                            const QString& column, const QString& ftsTable);
+    static bool hasIndex(QSqlDatabase& database, const QString& ftsTable);
+    // 启动时调用：索引已存在直接返回 true；迁移时 SQLite 不支持 trigram 而跳过、
+    // 之后升级了 SQLite 的库在这里补建索引（单个事务，失败回滚）。返回索引是否可用
+    static bool ensureIndex(QSqlDatabase& database, const QString& table,
+                            const QString& column, const QString& ftsTable);
+
+    // 按空白拆分查询词，去掉重复项
+    static QStringList splitTerms(const QString& text);
+    // 能走索引的查询词（长度不少于 3）与只能 LIKE 过滤的短词
+    static QStringList indexedTerms(const QStringList& terms);
+    static QStringList shortTerms(const QStringList& terms);
+
+    // FTS5 MATCH 表达式：每个词作为短语加引号，词之间为 AND
+    static QString matchExpression(const QStringList& terms);
+    // 子串匹配的 LIKE 模式，需配合 ESCAPE '\'
+    static QString likePattern(const QString& term);
+
+    // snippet() 输出（带高亮标记）转换为可直接显示的 HTML
+    static QString snippetToHtml(const QString& snippet);
+    // LIKE 回退时截取首个命中附近的文字并高亮，返回 HTML
+    static QString makeSnippet(const QString& content, const QStringList& terms, int contextChars = 20);
+};
+
+#endif // FULLTEXTSEARCH_H
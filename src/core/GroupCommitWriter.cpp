@@ -0,0 +1,251 @@
+#include "GroupCommitWriter.h"
+#include "StorageManager.h"
+#include <QTimer>
+#include <QSettings>
+#include <QThread>
+#include <QMutexLocker>
+#include <QDebug>
+
+namespace {
+const int DEFAULT_WINDOW_MS = 3;
+const int DEFAULT_MAX_BATCH_SIZE = 64;
+const QVector<qint64> BATCH_SIZE_BOUNDS = {1, 2, 4, 8, 16, 32, 64, 128, 256};
+const QVector<qint64> LATENCY_US_BOUNDS = {250, 500, 1000, 2000, 5000, 10000, 25000, 50000, 100000, 250000};
+
+// SQLITE_BUSY = 5, SQLITE_LOCKED = 6（扩展错误码的低 8 位）
+bool isLockError(const QSqlError& error)
+{
+    const int code = error.nativeErrorCode().toInt() & 0xff;
+    return code == 5 || code == 6;
+}
+}
+
+// ========== Histogram ==========
+
+Histogram::Histogram(const QVector<qint64>& bounds)
+    : m_bounds(bounds)
+    , m_counts(bounds.size() + 1, 0)
+    , m_count(0)
+    , m_sum(0)
+    , m_max(0)
+{
+}
+
+void Histogram::record(qint64 value)
+{
+    int bucket = 0;
+    while (bucket < m_bounds.size() && value > m_bounds[bucket]) {
+        ++bucket;
+    }
+    ++m_counts[bucket];
+    ++m_count;
+    m_sum += value;
+    m_max = qMax(m_max, value);
+}
+
+qint64 Histogram::percentile(double p) const
+{
+    if (m_count == 0) {
+        return 0;
+    }
+
+    const quint64 target = qMax<quint64>(1, quint64(p * m_count + 0.5));
+    quint64 seen = 0;
+    for (int i = 0; i < m_counts.size(); ++i) {
+        seen += m_counts[i];
+        if (seen >= target) {
+            return i < m_bounds.size() ? m_bounds[i] : m_max;
+        }
+    }
+    return m_max;
+}
+
+QString Histogram::toString(const QString& unit) const
+{
+    return QString("n=%1 平均=%2%6 p50≤%3%6 p99≤%4%6 最大=%5%6")
+        .arg(m_count)
+        .arg(mean(), 0, 'f', 1)
+        .arg(percentile(0.5))
+        .arg(percentile(0.99))
+        .arg(m_max)
+        .arg(unit);
+}
+
+// ========== GroupCommitWriter ==========
+
+GroupCommitWriter::GroupCommitWriter(QObject *parent)
+    : QObject(parent)
+    , m_windowTimer(new QTimer(this))
+{
+    resetStats();
+
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    m_windowMs = qMax(0, settings.value("groupCommit/windowMs", DEFAULT_WINDOW_MS).toInt());
+    m_maxBatchSize = qMax(1, settings.value("groupCommit/maxBatchSize", DEFAULT_MAX_BATCH_SIZE).toInt());
+
+    m_windowTimer->setSingleShot(true);
+    m_windowTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_windowTimer, &QTimer::timeout, this, &GroupCommitWriter::flush);
+}
+
+void GroupCommitWriter::setWindowMs(int windowMs)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_windowMs = qMax(0, windowMs);
+    }
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    settings.setValue("groupCommit/windowMs", qMax(0, windowMs));
+}
+
+int GroupCommitWriter::windowMs() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_windowMs;
+}
+
+void GroupCommitWriter::setMaxBatchSize(int maxBatchSize)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_maxBatchSize = qMax(1, maxBatchSize);
+    }
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    settings.setValue("groupCommit/maxBatchSize", qMax(1, maxBatchSize));
+}
+
+int GroupCommitWriter::maxBatchSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxBatchSize;
+}
+
+QFuture<int> GroupCommitWriter::submit(const OutgoingMessage& message)
+{
+    PendingWrite write;
+    write.message = message;
+    write.promise = std::make_shared<QPromise<int>>();
+    write.promise->start();
+    write.queued.start();
+    QFuture<int> future = write.promise->future();
+
+    int pendingCount = 0;
+    int maxBatch = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_pending.append(write);
+        pendingCount = m_pending.size();
+        maxBatch = m_maxBatchSize;
+    }
+
+    // 工作线程未运行（启动前或退出后）时直接在调用线程提交
+    if (!thread()->isRunning()) {
+        flush();
+        return future;
+    }
+
+    if (pendingCount >= maxBatch) {
+        QMetaObject::invokeMethod(this, &GroupCommitWriter::flush, Qt::QueuedConnection);
+    } else if (pendingCount == 1) {
+        // 本批的第一条消息开启收集窗口
+        QMetaObject::invokeMethod(this, [this]() { startWindow(); }, Qt::QueuedConnection);
+    }
+    return future;
+}
+
+void GroupCommitWriter::startWindow()
+{
+    if (!m_windowTimer->isActive()) {
+        m_windowTimer->start(windowMs());
+    }
+}
+
+void GroupCommitWriter::flush()
+{
+    if (m_windowTimer->thread() == QThread::currentThread()) {
+        m_windowTimer->stop();
+    }
+
+    QList<PendingWrite> pending;
+    int maxBatch = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        pending.swap(m_pending);
+        maxBatch = m_maxBatchSize;
+    }
+
+    for (int offset = 0; offset < pending.size(); offset += maxBatch) {
+        const QList<PendingWrite> batch = pending.mid(offset, maxBatch);
+
+        QList<OutgoingMessage> messages;
+        for (const PendingWrite& write : batch) {
+            messages.append(write.message);
+        }
+
+        QElapsedTimer commitTimer;
+        commitTimer.start();
+        QSqlError error;
+        QList<int> messageIds = DatabaseManager::instance()->sendMessages(messages, &error);
+        const qint64 commitUs = commitTimer.nsecsElapsed() / 1000;
+        const bool ok = messageIds.size() == batch.size();
+
+        // 数据或约束错误时逐条各自提交，一条坏消息不连累同一窗口里其他会话的消息；
+        // 锁冲突时逐条重试只会让每条都再等一次 busy_timeout，整批失败交给发件箱退避
+        int failedMessages = 0;
+        if (!ok) {
+            bool retrySingly = batch.size() > 1 && !isLockError(error);
+            qWarning() << "GroupCommitWriter:" << batch.size() << "条消息的批量提交失败:" << error.text()
+                       << (retrySingly ? "，逐条重试" : "");
+            messageIds.clear();
+            for (const OutgoingMessage& message : messages) {
+                QList<int> single;
+                if (retrySingly) {
+                    single = DatabaseManager::instance()->sendMessages({message}, &error);
+                }
+                messageIds.append(single.isEmpty() ? -1 : single.first());
+                if (messageIds.last() < 0) {
+                    ++failedMessages;
+                }
+                // 重试途中遇到锁冲突，剩下的消息不再逐条等待
+                if (retrySingly && single.isEmpty() && isLockError(error)) {
+                    retrySingly = false;
+                }
+            }
+        }
+
+        {
+            QMutexLocker locker(&m_mutex);
+            m_stats.batchSize.record(batch.size());
+            m_stats.commitLatencyUs.record(commitUs);
+            if (ok) {
+                ++m_stats.commits;
+            } else {
+                ++m_stats.failedCommits;
+                m_stats.failedMessages += failedMessages;
+            }
+            for (const PendingWrite& write : batch) {
+                m_stats.queueWaitUs.record(write.queued.nsecsElapsed() / 1000);
+            }
+        }
+
+        for (int i = 0; i < batch.size(); ++i) {
+            batch[i].promise->addResult(messageIds[i]);
+            batch[i].promise->finish();
+        }
+    }
+}
+
+GroupCommitWriter::Stats GroupCommitWriter::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+void GroupCommitWriter::resetStats()
+{
+    QMutexLocker locker(&m_mutex);
+    m_stats = Stats();
+    m_stats.batchSize = Histogram(BATCH_SIZE_BOUNDS);
+    m_stats.commitLatencyUs = Histogram(LATENCY_US_BOUNDS);
+    m_stats.queueWaitUs = Histogram(LATENCY_US_BOUNDS);
+}
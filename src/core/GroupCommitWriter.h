@@ -0,0 +1,99 @@
+#ifndef GROUPCOMMITWRITER_H
+#define GROUPCOMMITWRITER_H
+
+#include <QObject>
+#include <QFuture>
+#include <QPromise>
+#include <QList>
+#include <QVector>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <memory>
+#include "DatabaseManager.h"
+
+class QTimer;
+
+// 固定桶的直方图，bounds 为各桶的上界（含），超出最后一个上界的计入溢出桶
+class Histogram
+{
+public:
+    explicit Histogram(const QVector<qint64>& bounds = {});
+
+    void record(qint64 value);
+
+    QVector<qint64> bounds() const { return m_bounds; }
+    // 长度为 bounds().size() + 1，最后一项为溢出桶
+    QVector<quint64> counts() const { return m_counts; }
+    quint64 count() const { return m_count; }
+    qint64 max() const { return m_max; }
+    double mean() const { return m_count > 0 ? double(m_sum) / m_count : 0.0; }
+    // 所在桶的上界作为近似值，p 取 0~1
+    qint64 percentile(double p) const;
+
+    QString toString(const QString& unit) const;
+
+private:
+    QVector<qint64> m_bounds;
+    QVector<quint64> m_counts;
+    quint64 m_count;
+    qint64 m_sum;
+    qint64 m_max;
+};
+
+// 组提交写入器：把短时间窗口内（或攒满单批上限）各处发来的消息
+// 合并到一个事务中写入 Cyan.db，一次提交只有一次 fsync，然后分别完成每个调用方的 QFuture。
+// 整批因数据或约束错误失败时逐条各自重试，只有真正写不进去的消息结果为 -1；
+// 因锁冲突（SQLITE_BUSY/LOCKED）失败时整批返回 -1，由 MessageOutbox 退避后重试，不占住工作线程。
+// 窗口和单批上限保存在 storage.ini 的 groupCommit/windowMs、groupCommit/maxBatchSize。
+// 运行在 AsyncDatabaseManager 的数据库工作线程上，submit() 可在任意线程调用。
+class GroupCommitWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stats {
+        Histogram batchSize;       // 每次提交的消息条数
+        Histogram commitLatencyUs; // 每次提交（整个事务）的耗时，微秒
+        Histogram queueWaitUs;     // 消息从提交到写入完成的等待时间，微秒
+        quint64 commits = 0;
+        quint64 failedCommits = 0;
+        quint64 failedMessages = 0; // 提交失败后最终未写入的消息（含锁冲突时整批返回的）
+    };
+
+    explicit GroupCommitWriter(QObject *parent = nullptr);
+
+    // 收集窗口（毫秒）和单批上限，修改后写入 storage.ini
+    void setWindowMs(int windowMs);
+    int windowMs() const;
+    void setMaxBatchSize(int maxBatchSize);
+    int maxBatchSize() const;
+
+    // 结果为消息 ID，写入失败时为 -1
+    QFuture<int> submit(const OutgoingMessage& message);
+
+    Stats stats() const;
+    void resetStats();
+
+public slots:
+    // 立即提交已收集的消息（工作线程退出前调用）
+    void flush();
+
+private:
+    struct PendingWrite {
+        OutgoingMessage message;
+        std::shared_ptr<QPromise<int>> promise;
+        QElapsedTimer queued;
+    };
+
+    void startWindow();
+
+    mutable QMutex m_mutex;
+    QList<PendingWrite> m_pending;
+    int m_windowMs;
+    int m_maxBatchSize;
+    Stats m_stats;
+
+    QTimer* m_windowTimer;
+};
+
+#endif // GROUPCOMMITWRITER_H
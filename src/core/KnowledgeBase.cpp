@@ -0,0 +1,293 @@
+#include "KnowledgeBase.h"
+#include "StorageManager.h"
+#include "TokenEstimator.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QRegularExpression>
+#include <QtMath>
+#include <algorithm>
+#include <QDebug>
+
+namespace {
+const QString RESOURCE_DIRECTORY = ":/knowledge";
+// 合并后每段的最大字符数：部门介绍、单条制度基本能完整放进一段
+const int MAX_SECTION_CHARS = 600;
+const int DEFAULT_TOP_K = 4;
+const int DEFAULT_TOKEN_BUDGET = 1600;
+// 来源名（如“请假流程”“控制部”）中的词按多次出现计，问到某个文档主题时优先命中它
+const int SOURCE_TERM_WEIGHT = 3;
+// 虚词、代词不参与切词，否则“的部”“是谁”这类跨词的两字组合会因为少见而得到很高的权重
+const QString STOP_CHARACTERS = "的了吗呢吧啊呀么是谁什怎哪我你您他她它们这那和与及或也都就很";
+// BM25 参数
+const double BM25_K1 = 1.2;
+const double BM25_B = 0.75;
+}
+
+KnowledgeBase* KnowledgeBase::m_instance = nullptr;
+
+KnowledgeBase* KnowledgeBase::instance()
+{
+    if (!m_instance) {
+        m_instance = new KnowledgeBase;
+    }
+    return m_instance;
+}
+
+KnowledgeBase::KnowledgeBase()
+    : m_loaded(false)
+    , m_averageLength(0.0)
+    , m_totalTokens(0)
+{
+}
+
+int KnowledgeBase::topK() const
+{
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    return qMax(1, settings.value("knowledgeBase/topK", DEFAULT_TOP_K).toInt());
+}
+
+void KnowledgeBase::setTopK(int count)
+{
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    settings.setValue("knowledgeBase/topK", qMax(1, count));
+}
+
+int KnowledgeBase::tokenBudget() const
+{
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    return qMax(0, settings.value("knowledgeBase/tokenBudget", DEFAULT_TOKEN_BUDGET).toInt());
+}
+
+void KnowledgeBase::setTokenBudget(int tokens)
+{
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    settings.setValue("knowledgeBase/tokenBudget", qMax(0, tokens));
+}
+
+QStringList KnowledgeBase::tokenize(const QString& text)
+{
+    // 中文没有空格分词：连续的汉字切成相邻两字（单独一个字时保留单字），
+    // 字母数字按整词小写；标点、空白和虚词作为分隔
+    QStringList tokens;
+    const QString folded = text.normalized(QString::NormalizationForm_KC).toCaseFolded();
+
+    QString han;
+    QString word;
+    auto flushHan = [&]() {
+        if (han.size() == 1) {
+            tokens.append(han);
+        }
+        for (int i = 0; i + 1 < han.size(); ++i) {
+            tokens.append(han.mid(i, 2));
+        }
+        han.clear();
+    };
+    auto flushWord = [&]() {
+        if (!word.isEmpty()) {
+            tokens.append(word);
+            word.clear();
+        }
+    };
+
+    for (const QChar ch : folded) {
+        if (STOP_CHARACTERS.contains(ch)) {
+            flushHan();
+            flushWord();
+        } else if (ch.script() == QChar::Script_Han) {
+            flushWord();
+            han += ch;
+        } else if (ch.isLetterOrNumber()) {
+            flushHan();
+            word += ch;
+        } else {
+            flushHan();
+            flushWord();
+        }
+    }
+    flushHan();
+    flushWord();
+    return tokens;
+}
+
+void KnowledgeBase::addDocument(const QString& source, const QString& content)
+{
+    // 按空行分段，相邻短段合并
+    const QStringList paragraphs = content.split(QRegularExpression("\\n\\s*\\n"), Qt::SkipEmptyParts);
+    QStringList sectionTexts;
+    QString current;
+    for (const QString& paragraph : paragraphs) {
+        const QString trimmed = paragraph.trimmed();
+        if (trimmed.isEmpty()) {
+            continue;
+        }
+        if (!current.isEmpty() && current.size() + trimmed.size() > MAX_SECTION_CHARS) {
+            sectionTexts.append(current);
+            current.clear();
+        }
+        current += (current.isEmpty() ? "" : "\n") + trimmed;
+    }
+    if (!current.isEmpty()) {
+        sectionTexts.append(current);
+    }
+
+    for (const QString& text : sectionTexts) {
+        KnowledgeSection section;
+        section.source = source;
+        section.text = text;
+        section.tokens = TokenEstimator::estimate(text);
+
+        QHash<QString, int> frequencies;
+        const QStringList sourceTerms = tokenize(source);
+        const QStringList terms = tokenize(text);
+        for (const QString& term : sourceTerms) {
+            frequencies[term] += SOURCE_TERM_WEIGHT;
+        }
+        for (const QString& term : terms) {
+            frequencies[term]++;
+        }
+        for (auto it = frequencies.constBegin(); it != frequencies.constEnd(); ++it) {
+            m_documentFrequency[it.key()]++;
+        }
+
+        m_sections.append(section);
+        m_termFrequencies.append(frequencies);
+        m_sectionLengths.append(terms.size() + sourceTerms.size() * SOURCE_TERM_WEIGHT);
+        m_totalTokens += section.tokens;
+    }
+}
+
+bool KnowledgeBase::ensureLoaded()
+{
+    if (m_loaded) {
+        return !m_sections.isEmpty();
+    }
+    m_loaded = true;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    QString directory = settings.value("knowledgeBase/directory").toString();
+    if (directory.isEmpty() || !QDir(directory).exists()) {
+        directory = RESOURCE_DIRECTORY;
+    }
+
+    QStringList files;
+    QDirIterator it(directory, {"*.txt"}, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        files.append(it.next());
+    }
+    // 按路径排序，段的顺序与得分并列时的取舍保持稳定
+    files.sort();
+
+    const QDir root(directory);
+    for (const QString& path : files) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "KnowledgeBase: 无法读取" << path;
+            continue;
+        }
+        const QString relative = root.relativeFilePath(path);
+        const QString source = relative.left(relative.size() - QFileInfo(relative).suffix().size() - 1);
+        addDocument(source, QString::fromUtf8(file.readAll()));
+    }
+
+    qint64 totalLength = 0;
+    for (int length : m_sectionLengths) {
+        totalLength += length;
+    }
+    m_averageLength = m_sections.isEmpty() ? 0.0 : double(totalLength) / m_sections.size();
+
+    qDebug() << "KnowledgeBase: 载入" << files.size() << "个文档、" << m_sections.size()
+             << "段，约" << m_totalTokens << "tokens，耗时" << timer.elapsed() << "ms，来源" << directory;
+    return !m_sections.isEmpty();
+}
+
+void KnowledgeBase::reload()
+{
+    m_loaded = false;
+    m_sections.clear();
+    m_termFrequencies.clear();
+    m_sectionLengths.clear();
+    m_documentFrequency.clear();
+    m_averageLength = 0.0;
+    m_totalTokens = 0;
+    ensureLoaded();
+}
+
+QList<KnowledgeSection> KnowledgeBase::retrieve(const QString& query, int topK, int tokenBudget,
+                                                KnowledgeRetrievalStats* stats)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QList<KnowledgeSection> selected;
+    KnowledgeRetrievalStats localStats;
+    if (!ensureLoaded() || topK <= 0 || tokenBudget <= 0) {
+        if (stats) *stats = localStats;
+        return selected;
+    }
+
+    // 查询词去重：重复的字不应放大同一个词的权重
+    const QStringList queryTerms = tokenize(query);
+    const QSet<QString> uniqueTerms(queryTerms.cbegin(), queryTerms.cend());
+    const int sectionCount = m_sections.size();
+
+    QList<QPair<double, int>> ranked;
+    for (int i = 0; i < sectionCount; ++i) {
+        const QHash<QString, int>& frequencies = m_termFrequencies[i];
+        const double lengthNorm = 1.0 - BM25_B + BM25_B * m_sectionLengths[i] / qMax(1.0, m_averageLength);
+        double score = 0.0;
+        for (const QString& term : uniqueTerms) {
+            const int tf = frequencies.value(term);
+            if (tf == 0) {
+                continue;
+            }
+            const int df = m_documentFrequency.value(term);
+            const double idf = qLn(1.0 + (sectionCount - df + 0.5) / (df + 0.5));
+            score += idf * tf * (BM25_K1 + 1.0) / (tf + BM25_K1 * lengthNorm);
+        }
+        if (score > 0.0) {
+            ranked.append({score, i});
+        }
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const QPair<double, int>& a, const QPair<double, int>& b) {
+        return a.first > b.first;
+    });
+    localStats.matched = ranked.size();
+
+    // 按得分依次放入，放不下的段跳过，继续尝试后面较短的段
+    for (const QPair<double, int>& entry : ranked) {
+        if (selected.size() >= topK) {
+            break;
+        }
+        const KnowledgeSection& section = m_sections[entry.second];
+        if (localStats.tokens + section.tokens > tokenBudget) {
+            continue;
+        }
+        KnowledgeSection hit = section;
+        hit.score = entry.first;
+        selected.append(hit);
+        localStats.tokens += section.tokens;
+    }
+    localStats.selected = selected.size();
+    localStats.elapsedUs = timer.nsecsElapsed() / 1000;
+
+    if (stats) *stats = localStats;
+    return selected;
+}
+
+int KnowledgeBase::sectionCount() const
+{
+    return m_sections.size();
+}
+
+int KnowledgeBase::totalTokens() const
+{
+    return m_totalTokens;
+}
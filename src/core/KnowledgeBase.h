@@ -0,0 +1,69 @@
+#ifndef KNOWLEDGEBASE_H
+#define KNOWLEDGEBASE_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+
+// 知识库中的一段
+struct KnowledgeSection {
+    QString source;     // 分类/文档名，如 "HR政策与制度/假期制度"
+    QString text;
+    int tokens = 0;     // TokenEstimator 估算的 token 数
+    double score = 0.0; // 检索得分
+};
+
+// 一次检索的统计
+struct KnowledgeRetrievalStats {
+    int matched = 0;         // 得分大于 0 的段数
+    int selected = 0;        // 放入预算的段数
+    int tokens = 0;          // 放入的段合计 token 数
+    qint64 elapsedUs = 0;
+};
+
+// 本地知识库检索：hr-rag-server/青蓝公司知识库 的文档随程序打包在 :/knowledge 资源中
+// （storage.ini 的 knowledgeBase/directory 可指向外部目录以便不重新编译就更新内容）。
+// - 文档按空行分段，相邻短段合并到 MAX_SECTION_CHARS 以内，每段带上来源；
+// - 中文按相邻两字切词（虚词作分隔）、英文数字按单词切词，用 BM25 打分，不依赖分词库；
+// - retrieve() 按得分取前 topK 段，并保证合计 token 数不超过预算。
+// 首次检索时载入，只在主线程使用。
+class KnowledgeBase
+{
+public:
+    static KnowledgeBase* instance();
+
+    // storage.ini 的 knowledgeBase/topK、knowledgeBase/tokenBudget
+    int topK() const;
+    void setTopK(int count);
+    int tokenBudget() const;
+    void setTokenBudget(int tokens);
+
+    bool ensureLoaded();
+    void reload();
+
+    QList<KnowledgeSection> retrieve(const QString& query, int topK, int tokenBudget,
+                                     KnowledgeRetrievalStats* stats = nullptr);
+
+    int sectionCount() const;
+    // 全部段的 token 数之和，即把整个知识库放进提示词时的大小
+    int totalTokens() const;
+
+private:
+    KnowledgeBase();
+
+    static QStringList tokenize(const QString& text);
+    void addDocument(const QString& source, const QString& content);
+
+    static KnowledgeBase* m_instance;
+
+    bool m_loaded;
+    QList<KnowledgeSection> m_sections;
+    QList<QHash<QString, int>> m_termFrequencies; // 与 m_sections 一一对应
+    QList<int> m_sectionLengths;                  // 每段的词数
+    QHash<QString, int> m_documentFrequency;      // 词 -> 包含它的段数
+    double m_averageLength;
+    int m_totalTokens;
+};
+
+#endif // KNOWLEDGEBASE_H
@@ -0,0 +1,348 @@
+#include "MessageOutbox.h"
+#include "AsyncDatabaseManager.h"
+#include "GroupCommitWriter.h"
+#include "StorageManager.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QUuid>
+#include <QRandomGenerator>
+#include <QDebug>
+#include <memory>
+
+namespace {
+// 同一窗口内入队的消息合并为一个事务
+const int COALESCE_WINDOW_MS = 30;
+const int MAX_BATCH_SIZE = 100;
+const qint64 INITIAL_RETRY_MS = 500;
+const qint64 MAX_RETRY_MS = 30000;
+// 连续失败这么多次后不再自动重试（约 3 分钟），标记为失败等待手动重发
+const int MAX_ATTEMPTS = 10;
+}
+
+MessageOutbox* MessageOutbox::m_instance = nullptr;
+
+MessageOutbox* MessageOutbox::instance()
+{
+    if (!m_instance) {
+        m_instance = new MessageOutbox;
+    }
+    return m_instance;
+}
+
+MessageOutbox::MessageOutbox(QObject *parent)
+    : QObject(parent)
+    , m_inFlight(false)
+{
+    qRegisterMetaType<OutboxMessage>("OutboxMessage");
+
+    m_flushTimer.setSingleShot(true);
+    connect(&m_flushTimer, &QTimer::timeout, this, &MessageOutbox::flush);
+}
+
+QSqlDatabase MessageOutbox::database()
+{
+    return StorageManager::instance()->connection(StorageManager::OutboxStore);
+}
+
+OutboxMessage MessageOutbox::enqueue(int sessionId, int senderId, const QString& content, int messageType)
+{
+    OutboxMessage message;
+    message.clientMsgId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    message.sessionId = sessionId;
+    message.senderId = senderId;
+    message.content = content;
+    message.messageType = messageType;
+    message.createdAt = QDateTime::currentDateTime();
+
+    QSqlQuery query(database());
+    query.prepare(R"(
+        INSERT INTO outbox_messages (client_msg_id, session_id, sender_id, content, message_type, created_at)
+        VALUES (?, ?, ?, ?, ?, ?)
+    )");
+    query.addBindValue(message.clientMsgId);
+    query.addBindValue(sessionId);
+    query.addBindValue(senderId);
+    query.addBindValue(content);
+    query.addBindValue(messageType);
+    query.addBindValue(message.createdAt.toMSecsSinceEpoch());
+    bool queued = query.exec();
+
+    m_senders.insert(senderId);
+    emit messageQueued(message);
+
+    if (queued) {
+        scheduleFlush(COALESCE_WINDOW_MS);
+        return message;
+    }
+
+    // 发件箱本身不可写（如磁盘已满）时直接写入 Cyan.db，只尝试一次
+    qWarning() << "MessageOutbox: 写入发件箱失败:" << query.lastError().text();
+    const QString clientMsgId = message.clientMsgId;
+    GroupCommitWriter* writer = AsyncDatabaseManager::instance()->groupCommitWriter();
+    writer->submit({clientMsgId, sessionId, senderId, content, messageType})
+        .then(this, [this, clientMsgId](int messageId) {
+            if (messageId > 0) {
+                emit messageSent(clientMsgId, messageId);
+            } else {
+                emit messageFailed(clientMsgId);
+            }
+        });
+    return message;
+}
+
+void MessageOutbox::resume(int senderId)
+{
+    if (senderId <= 0) return;
+
+    m_senders.insert(senderId);
+    scheduleFlush(0);
+}
+
+bool MessageOutbox::resend(const QString& clientMsgId)
+{
+    QSqlQuery query(database());
+    query.prepare(R"(
+        UPDATE outbox_messages
+        SET failed = 0, attempts = 0, next_attempt_at = 0, last_error = NULL
+        WHERE client_msg_id = ? AND failed = 1
+    )");
+    query.addBindValue(clientMsgId);
+    if (!query.exec()) {
+        qWarning() << "MessageOutbox: 重发消息失败:" << query.lastError().text();
+        return false;
+    }
+    if (query.numRowsAffected() == 0) {
+        return false;
+    }
+
+    scheduleFlush(0);
+    return true;
+}
+
+QList<OutboxMessage> MessageOutbox::pendingMessages(int sessionId)
+{
+    QList<OutboxMessage> messages;
+
+    QSqlQuery query(database());
+    query.prepare(R"(
+        SELECT client_msg_id, session_id, sender_id, content, message_type, created_at, attempts, failed, last_error
+        FROM outbox_messages
+        WHERE session_id = ?
+        ORDER BY created_at, rowid
+    )");
+    query.addBindValue(sessionId);
+    if (!query.exec()) {
+        qWarning() << "MessageOutbox: 读取发件箱失败:" << query.lastError().text();
+        return messages;
+    }
+
+    while (query.next()) {
+        OutboxMessage message;
+        message.clientMsgId = query.value("client_msg_id").toString();
+        message.sessionId = query.value("session_id").toInt();
+        message.senderId = query.value("sender_id").toInt();
+        message.content = query.value("content").toString();
+        message.messageType = query.value("message_type").toInt();
+        message.createdAt = QDateTime::fromMSecsSinceEpoch(query.value("created_at").toLongLong());
+        message.attempts = query.value("attempts").toInt();
+        message.failed = query.value("failed").toInt() != 0;
+        message.lastError = query.value("last_error").toString();
+        messages.append(message);
+    }
+    return messages;
+}
+
+int MessageOutbox::pendingCount()
+{
+    QSqlQuery query(database());
+    if (query.exec("SELECT COUNT(*) FROM outbox_messages") && query.next()) {
+        return query.value(0).toInt();
+    }
+    return 0;
+}
+
+QList<OutboxMessage> MessageOutbox::takeDueBatch(qint64* nextAttemptAt)
+{
+    QList<OutboxMessage> batch;
+    if (m_senders.isEmpty()) {
+        return batch;
+    }
+
+    QStringList senderIds;
+    for (int senderId : m_senders) {
+        senderIds.append(QString::number(senderId));
+    }
+
+    QSqlQuery query(database());
+    query.prepare(QString(R"(
+        SELECT client_msg_id, session_id, sender_id, content, message_type, created_at, attempts, next_attempt_at
+        FROM outbox_messages
+        WHERE sender_id IN (%1) AND failed = 0
+        ORDER BY created_at, rowid
+        LIMIT ?
+    )").arg(senderIds.join(',')));
+    query.addBindValue(MAX_BATCH_SIZE);
+    if (!query.exec()) {
+        qWarning() << "MessageOutbox: 读取发件箱失败:" << query.lastError().text();
+        return batch;
+    }
+
+    // 同一会话内保持发送顺序：某条消息还在退避中时，它之后的消息也先不投递
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QSet<int> blockedSessions;
+    while (query.next()) {
+        const int sessionId = query.value("session_id").toInt();
+        if (blockedSessions.contains(sessionId)) continue;
+        const qint64 attemptAt = query.value("next_attempt_at").toLongLong();
+        if (attemptAt > now) {
+            blockedSessions.insert(sessionId);
+            if (*nextAttemptAt == 0 || attemptAt < *nextAttemptAt) {
+                *nextAttemptAt = attemptAt;
+            }
+            continue;
+        }
+
+        OutboxMessage message;
+        message.clientMsgId = query.value("client_msg_id").toString();
+        message.sessionId = sessionId;
+        message.senderId = query.value("sender_id").toInt();
+        message.content = query.value("content").toString();
+        message.messageType = query.value("message_type").toInt();
+        message.createdAt = QDateTime::fromMSecsSinceEpoch(query.value("created_at").toLongLong());
+        message.attempts = query.value("attempts").toInt();
+        batch.append(message);
+    }
+    return batch;
+}
+
+void MessageOutbox::flush()
+{
+    // 正在写入的这一批完成后会再次调度
+    if (m_inFlight) return;
+
+    qint64 nextAttemptAt = 0;
+    QList<OutboxMessage> batch = takeDueBatch(&nextAttemptAt);
+    if (batch.isEmpty()) {
+        // 只剩退避中的消息时，在最早的重试时间再来
+        if (nextAttemptAt > 0) {
+            scheduleFlush(qMax<qint64>(0, nextAttemptAt - QDateTime::currentMSecsSinceEpoch()));
+        }
+        return;
+    }
+
+    // 逐条交给组提交写入器，和其他发送方同一窗口内的消息一起提交
+    struct BatchState {
+        QList<int> messageIds;
+        int remaining;
+    };
+    auto state = std::make_shared<BatchState>();
+    state->messageIds = QList<int>(batch.size(), -1);
+    state->remaining = batch.size();
+
+    m_inFlight = true;
+    GroupCommitWriter* writer = AsyncDatabaseManager::instance()->groupCommitWriter();
+    for (int i = 0; i < batch.size(); ++i) {
+        const OutboxMessage& message = batch[i];
+        writer->submit({message.clientMsgId, message.sessionId, message.senderId,
+                        message.content, message.messageType})
+            .then(this, [this, state, batch, i](int messageId) {
+                state->messageIds[i] = messageId;
+                if (--state->remaining == 0) {
+                    onBatchWritten(batch, state->messageIds);
+                }
+            });
+    }
+}
+
+void MessageOutbox::onBatchWritten(const QList<OutboxMessage>& batch, const QList<int>& messageIds)
+{
+    m_inFlight = false;
+
+    QSqlDatabase db = database();
+    QSqlQuery query(db);
+    db.transaction();
+
+    // 写入器按窗口分批提交，一次投递的消息可能部分成功
+    QList<int> sentIndexes;
+    QList<int> failedIndexes;
+    for (int i = 0; i < batch.size(); ++i) {
+        (messageIds.value(i, -1) > 0 ? sentIndexes : failedIndexes).append(i);
+    }
+
+    query.prepare("DELETE FROM outbox_messages WHERE client_msg_id = ?");
+    for (int i : sentIndexes) {
+        query.addBindValue(batch[i].clientMsgId);
+        query.exec();
+    }
+
+    // 重试次数用尽的消息标记为失败，不再参与自动投递
+    QList<int> retryIndexes;
+    QList<int> deadIndexes;
+    for (int i : failedIndexes) {
+        (batch[i].attempts + 1 >= MAX_ATTEMPTS ? deadIndexes : retryIndexes).append(i);
+    }
+
+    QList<qint64> delays;
+    query.prepare(R"(
+        UPDATE outbox_messages
+        SET attempts = attempts + 1, next_attempt_at = ?, last_error = ?
+        WHERE client_msg_id = ?
+    )");
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (int i : retryIndexes) {
+        qint64 delay = retryDelay(batch[i].attempts + 1);
+        delays.append(delay);
+        query.addBindValue(now + delay);
+        query.addBindValue(QString("写入聊天数据库失败"));
+        query.addBindValue(batch[i].clientMsgId);
+        query.exec();
+    }
+
+    query.prepare(R"(
+        UPDATE outbox_messages
+        SET attempts = attempts + 1, failed = 1, last_error = ?
+        WHERE client_msg_id = ?
+    )");
+    for (int i : deadIndexes) {
+        query.addBindValue(QString("多次写入聊天数据库失败，已停止重试"));
+        query.addBindValue(batch[i].clientMsgId);
+        query.exec();
+    }
+    db.commit();
+
+    for (int i : sentIndexes) {
+        emit messageSent(batch[i].clientMsgId, messageIds[i]);
+    }
+    if (!retryIndexes.isEmpty()) {
+        qWarning() << "MessageOutbox:" << retryIndexes.size() << "条消息写入失败，稍后重试";
+    }
+    for (int k = 0; k < retryIndexes.size(); ++k) {
+        const OutboxMessage& message = batch[retryIndexes[k]];
+        emit messageRetrying(message.clientMsgId, message.attempts + 1, delays[k]);
+    }
+    if (!deadIndexes.isEmpty()) {
+        qWarning() << "MessageOutbox:" << deadIndexes.size() << "条消息重试" << MAX_ATTEMPTS << "次仍失败，等待手动重发";
+    }
+    for (int i : deadIndexes) {
+        emit messageFailed(batch[i].clientMsgId);
+    }
+
+    // 继续投递写入期间入队的消息，或安排下一次重试
+    scheduleFlush(0);
+}
+
+void MessageOutbox::scheduleFlush(qint64 delayMs)
+{
+    if (m_flushTimer.isActive() && m_flushTimer.remainingTime() <= delayMs) {
+        return;
+    }
+    m_flushTimer.start(int(delayMs));
+}
+
+qint64 MessageOutbox::retryDelay(int attempts)
+{
+    qint64 delay = INITIAL_RETRY_MS << qMin(attempts - 1, 10);
+    delay = qMin(delay, MAX_RETRY_MS);
+    // 加一点随机抖动，避免多个实例同时重试再次撞上锁
+    return delay + QRandomGenerator::global()->bounded(delay / 5 + 1);
+}
@@ -0,0 +1,83 @@
+#ifndef MESSAGEOUTBOX_H
+#define MESSAGEOUTBOX_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QDateTime>
+#include <QString>
+#include <QList>
+#include <QSet>
+#include <QTimer>
+
+// 发件箱中的一条消息
+struct OutboxMessage {
+    QString clientMsgId;
+    int sessionId = 0;
+    int senderId = 0;
+    QString content;
+    int messageType = 0;
+    QDateTime createdAt;
+    int attempts = 0;     // 已失败的写入次数
+    bool failed = false;  // 重试次数用尽，等待手动重发
+    QString lastError;
+};
+
+// 持久化发件箱：发送消息先写入本地 outbox.db，再由发件箱投递到 Cyan.db。
+// - 同一时间窗口内的多条消息合并为一个事务写入；
+// - Cyan.db 被其他实例锁住或写入失败时按指数退避重试，消息不会丢失；
+// - 连续失败 MAX_ATTEMPTS 次的消息标记为失败并停止自动投递，由用户手动重发（resend）；
+// - 每条消息带客户端生成的 clientMsgId，重试时不会重复插入；
+// - 程序重启后，用户再次登录（resume）时继续投递上次未完成的消息。
+// 只在主线程使用，实际写入 Cyan.db 由 AsyncDatabaseManager 的组提交写入器完成。
+class MessageOutbox : public QObject
+{
+    Q_OBJECT
+
+public:
+    static MessageOutbox* instance();
+
+    // 写入发件箱并安排投递，返回的消息可立即以"发送中"状态显示
+    OutboxMessage enqueue(int sessionId, int senderId, const QString& content, int messageType = 0);
+
+    // 开始投递该用户遗留在发件箱中的消息
+    void resume(int senderId);
+
+    // 把已标记为失败的消息重新放回投递队列，返回是否找到该消息
+    bool resend(const QString& clientMsgId);
+
+    // 指定会话中尚未写入 Cyan.db 的消息（按入队顺序，包括已标记为失败的）
+    QList<OutboxMessage> pendingMessages(int sessionId);
+    int pendingCount();
+
+signals:
+    void messageQueued(const OutboxMessage& message);
+    void messageSent(const QString& clientMsgId, int messageId);
+    // 写入失败，retryInMs 毫秒后重试
+    void messageRetrying(const QString& clientMsgId, int attempts, qint64 retryInMs);
+    // 最终失败：重试次数用尽（消息保留在发件箱，可 resend），
+    // 或发件箱不可写且直接写入也失败（消息未能保存）
+    void messageFailed(const QString& clientMsgId);
+
+private slots:
+    void flush();
+
+private:
+    explicit MessageOutbox(QObject *parent = nullptr);
+
+    QSqlDatabase database();
+    // 可以投递的消息；nextAttemptAt 返回仍在退避中的消息最早的重试时间（毫秒时间戳，没有则为 0）
+    QList<OutboxMessage> takeDueBatch(qint64* nextAttemptAt);
+    void onBatchWritten(const QList<OutboxMessage>& batch, const QList<int>& messageIds);
+    void scheduleFlush(qint64 delayMs);
+    static qint64 retryDelay(int attempts);
+
+    static MessageOutbox* m_instance;
+
+    QSet<int> m_senders;     // 本进程负责投递的发送者
+    QTimer m_flushTimer;
+    bool m_inFlight;         // 有一批正在写入 Cyan.db
+};
+
+Q_DECLARE_METATYPE(OutboxMessage)
+
+#endif // MESSAGEOUTBOX_H
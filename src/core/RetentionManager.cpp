@@ -0,0 +1,266 @@
+#include "RetentionManager.h"
+#include "AsyncDatabaseManager.h"
+#include "ChatStorage.h"
+#include "EpochTime.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QSettings>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QDebug>
+
+namespace {
+// 每块删除的行数和每次归还的页数：单个写事务控制在几毫秒内
+const int CHUNK_ROWS = 500;
+const int VACUUM_PAGES = 256;
+// 块与块之间让出工作线程，聊天消息的写入可以插进来
+const int CHUNK_PAUSE_MS = 20;
+const int FIRST_RUN_DELAY_MS = 2 * 60 * 1000;
+const int RUN_INTERVAL_MS = 60 * 60 * 1000;
+const int REQUEST_DELAY_MS = 200;
+// 未开启 auto_vacuum 的旧库需要一次完整 VACUUM 才能切换，只对小库自动执行
+const qint64 MAX_AUTO_CONVERT_BYTES = 32 * 1024 * 1024;
+}
+
+RetentionManager* RetentionManager::m_instance = nullptr;
+
+RetentionManager* RetentionManager::instance()
+{
+    if (!m_instance) {
+        m_instance = new RetentionManager;
+    }
+    return m_instance;
+}
+
+RetentionManager::RetentionManager(QObject *parent)
+    : QObject(parent)
+    , m_runStartedAt(0)
+    , m_running(false)
+    , m_rerunRequested(false)
+{
+    m_scheduleTimer.setSingleShot(true);
+    connect(&m_scheduleTimer, &QTimer::timeout, this, &RetentionManager::runPurge);
+}
+
+QList<RetentionPolicy> RetentionManager::policies()
+{
+    return {
+        {"ai_chat", "AI 问答记录", StorageManager::AIChatStore, "ai_chat_messages", "timestamp", 180},
+        {"chat_history", "聊天存档", StorageManager::ChatHistoryStore, "chat_messages", "timestamp", 0},
+        {"question_stats", "问题统计", StorageManager::StatsStore, "question_records", "timestamp", 0}
+    };
+}
+
+int RetentionManager::policyDays(const QString& name) const
+{
+    for (const RetentionPolicy& policy : policies()) {
+        if (policy.name == name) {
+            QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+            return settings.value("retention/" + name, policy.defaultDays).toInt();
+        }
+    }
+    return 0;
+}
+
+void RetentionManager::setPolicyDays(const QString& name, int days)
+{
+    QSettings settings(StorageManager::instance()->settingsPath(), QSettings::IniFormat);
+    settings.setValue("retention/" + name, qMax(0, days));
+}
+
+void RetentionManager::start()
+{
+    m_scheduleTimer.start(FIRST_RUN_DELAY_MS);
+}
+
+void RetentionManager::requestPurge()
+{
+    if (m_running) {
+        m_rerunRequested = true;
+        return;
+    }
+    if (!m_scheduleTimer.isActive() || m_scheduleTimer.remainingTime() > REQUEST_DELAY_MS) {
+        m_scheduleTimer.start(REQUEST_DELAY_MS);
+    }
+}
+
+void RetentionManager::requestVacuum(StorageManager::Store store)
+{
+    if (!m_vacuumRequests.contains(store)) {
+        m_vacuumRequests.append(store);
+    }
+    requestPurge();
+}
+
+bool RetentionManager::isRunning() const
+{
+    return m_running;
+}
+
+QList<RetentionManager::Step> RetentionManager::buildSteps() const
+{
+    QList<Step> steps;
+    QList<StorageManager::Store> stores{StorageManager::ChatHistoryStore};
+    for (StorageManager::Store store : m_vacuumRequests) {
+        if (!stores.contains(store)) {
+            stores.append(store);
+        }
+    }
+
+    steps.append({Step::Tombstones, &RetentionManager::purgeTombstoneChunk});
+
+    for (const RetentionPolicy& policy : policies()) {
+        const int days = policyDays(policy.name);
+        if (days <= 0) continue;
+        steps.append({Step::Expire, [policy, days]() { return expireChunk(policy, days); }});
+        if (!stores.contains(policy.store)) {
+            stores.append(policy.store);
+        }
+    }
+
+    for (StorageManager::Store store : stores) {
+        steps.append({Step::Vacuum, [store]() { return vacuumChunk(store); }});
+    }
+    return steps;
+}
+
+void RetentionManager::runPurge()
+{
+    if (m_running) {
+        m_rerunRequested = true;
+        return;
+    }
+
+    m_running = true;
+    m_rerunRequested = false;
+    m_stats = PurgeRunStats();
+    m_runStartedAt = QDateTime::currentMSecsSinceEpoch();
+    m_steps = buildSteps();
+    m_vacuumRequests.clear();
+    runNextChunk();
+}
+
+void RetentionManager::runNextChunk()
+{
+    if (m_steps.isEmpty()) {
+        finishRun();
+        return;
+    }
+
+    // 每块作为一个独立任务排进数据库工作线程的队列
+    const Step step = m_steps.first();
+    AsyncDatabaseManager::instance()->post(this, step.run, [this, step](const StepResult& result) {
+        ++m_stats.chunks;
+        if (result.rows > 0) {
+            switch (step.kind) {
+            case Step::Tombstones: m_stats.tombstoneRows += result.rows; break;
+            case Step::Expire:     m_stats.expiredRows += result.rows; break;
+            case Step::Vacuum:     m_stats.reclaimedPages += result.rows; break;
+            }
+        }
+
+        if (result.done || result.rows < 0) {
+            m_steps.removeFirst();
+        }
+        QTimer::singleShot(CHUNK_PAUSE_MS, this, &RetentionManager::runNextChunk);
+    });
+}
+
+void RetentionManager::finishRun()
+{
+    m_running = false;
+    m_stats.elapsedMs = QDateTime::currentMSecsSinceEpoch() - m_runStartedAt;
+
+    if (m_stats.tombstoneRows > 0 || m_stats.expiredRows > 0 || m_stats.reclaimedPages > 0) {
+        qDebug() << QString("RetentionManager: 清除墓碑消息 %1 条、过期记录 %2 条，归还 %3 页，共 %4 块，耗时 %5 ms")
+                        .arg(m_stats.tombstoneRows).arg(m_stats.expiredRows)
+                        .arg(m_stats.reclaimedPages).arg(m_stats.chunks).arg(m_stats.elapsedMs);
+    }
+    emit purgeFinished(m_stats);
+
+    m_scheduleTimer.start(m_rerunRequested ? REQUEST_DELAY_MS : RUN_INTERVAL_MS);
+}
+
+RetentionManager::StepResult RetentionManager::purgeTombstoneChunk()
+{
+    QSqlDatabase db = StorageManager::instance()->connection(StorageManager::ChatHistoryStore);
+
+    StepResult result;
+    result.rows = ChatStorage::purgeTombstones(db, CHUNK_ROWS);
+    result.done = result.rows < 0 || ChatStorage::pendingTombstones(db) == 0;
+    return result;
+}
+
+RetentionManager::StepResult RetentionManager::expireChunk(const RetentionPolicy& policy, int days)
+{
+    QSqlDatabase db = StorageManager::instance()->connection(policy.store);
+    QSqlQuery query(db);
+
+    // 旧数据集中在 rowid 前部，子查询很快凑满一块
+    const qint64 cutoff = EpochTime::nowMs() - qint64(days) * 24 * 60 * 60 * 1000;
+    query.prepare(QString("DELETE FROM %1 WHERE rowid IN ("
+                          "SELECT rowid FROM %1 WHERE %2 < ? LIMIT ?)")
+                      .arg(policy.table, policy.timestampColumn));
+    query.addBindValue(cutoff);
+    query.addBindValue(CHUNK_ROWS);
+
+    StepResult result;
+    if (!query.exec()) {
+        qWarning() << "RetentionManager: 清除过期记录失败:" << policy.name << query.lastError().text();
+        result.rows = -1;
+        return result;
+    }
+    result.rows = query.numRowsAffected();
+    result.done = result.rows < CHUNK_ROWS;
+    return result;
+}
+
+RetentionManager::StepResult RetentionManager::vacuumChunk(StorageManager::Store store)
+{
+    QSqlDatabase db = StorageManager::instance()->connection(store);
+    QSqlQuery query(db);
+    StepResult result;
+
+    int freePages = 0;
+    if (query.exec("PRAGMA freelist_count") && query.next()) {
+        freePages = query.value(0).toInt();
+    }
+    query.finish();
+    if (freePages == 0) {
+        return result;
+    }
+
+    int autoVacuum = 0;
+    if (query.exec("PRAGMA auto_vacuum") && query.next()) {
+        autoVacuum = query.value(0).toInt();
+    }
+    query.finish();
+
+    // 0-NONE：切换到 INCREMENTAL 需要重建整个库，只对小库自动进行
+    if (autoVacuum == 0) {
+        const qint64 size = QFileInfo(StorageManager::instance()->databasePath(store)).size();
+        if (size > MAX_AUTO_CONVERT_BYTES) {
+            return result;
+        }
+        if (!query.exec("PRAGMA auto_vacuum = INCREMENTAL") || !query.exec("VACUUM")) {
+            qWarning() << "RetentionManager: 开启 incremental auto_vacuum 失败:"
+                       << StorageManager::schemaName(store) << query.lastError().text();
+            return result;
+        }
+        qDebug() << "RetentionManager:" << StorageManager::schemaName(store) << "已切换为 incremental auto_vacuum";
+        result.rows = freePages;
+        return result;
+    }
+
+    if (!query.exec(QString("PRAGMA incremental_vacuum(%1)").arg(VACUUM_PAGES))) {
+        qWarning() << "RetentionManager: incremental_vacuum 失败:"
+                   << StorageManager::schemaName(store) << query.lastError().text();
+        result.rows = -1;
+        return result;
+    }
+    query.finish();
+
+    result.rows = qMin(freePages, VACUUM_PAGES);
+    result.done = freePages <= VACUUM_PAGES;
+    return result;
+}
@@ -0,0 +1,92 @@
+#ifndef RETENTIONMANAGER_H
+#define RETENTIONMANAGER_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QTimer>
+#include <functional>
+#include "StorageManager.h"
+
+// 保留策略：store 中 table 的行在 timestampColumn 早于 N 天前时被清除，
+// 天数保存在 storage.ini 的 retention/<name>，0 表示不清除
+struct RetentionPolicy {
+    QString name;
+    QString displayName;
+    StorageManager::Store store;
+    QString table;
+    QString timestampColumn; // 纪元毫秒
+    int defaultDays;
+};
+
+// 一次清理的统计
+struct PurgeRunStats {
+    int tombstoneRows = 0;   // 墓碑命中、已物理删除的消息
+    int expiredRows = 0;     // 超出保留期被删除的行
+    qint64 reclaimedPages = 0;
+    int chunks = 0;
+    qint64 elapsedMs = 0;
+};
+
+// 后台清理：处理 ChatStorage 的删除墓碑和各库的保留策略，
+// 每块最多删除 CHUNK_ROWS 行、在数据库工作线程上以独立的短事务执行，块与块之间让出工作线程，
+// 大批量删除不会卡住界面，也不会长时间占用写锁。删除完成后用 incremental_vacuum 分批归还空闲页。
+// 只在主线程使用。
+class RetentionManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    static RetentionManager* instance();
+
+    static QList<RetentionPolicy> policies();
+    int policyDays(const QString& name) const;
+    void setPolicyDays(const QString& name, int days);
+
+    // 启动定时清理：启动后稍等片刻执行一次，之后每小时一次
+    void start();
+    // 有新的墓碑或策略变化，尽快执行一次
+    void requestPurge();
+    // 其他模块大批量搬走数据后（如 ChatArchiver 归档），在下一次清理中一并归还该库的空闲页
+    void requestVacuum(StorageManager::Store store);
+    bool isRunning() const;
+
+signals:
+    void purgeFinished(const PurgeRunStats& stats);
+
+private slots:
+    void runPurge();
+
+private:
+    // 执行一块：返回处理的行数（-1 表示出错），done 为 true 时该步骤完成
+    struct StepResult {
+        int rows = 0;
+        bool done = true;
+    };
+    struct Step {
+        enum Kind { Tombstones, Expire, Vacuum } kind;
+        std::function<StepResult()> run;
+    };
+
+    explicit RetentionManager(QObject *parent = nullptr);
+
+    QList<Step> buildSteps() const;
+    void runNextChunk();
+    void finishRun();
+
+    static StepResult purgeTombstoneChunk();
+    static StepResult expireChunk(const RetentionPolicy& policy, int days);
+    static StepResult vacuumChunk(StorageManager::Store store);
+
+    static RetentionManager* m_instance;
+
+    QTimer m_scheduleTimer;
+    QList<Step> m_steps;
+    QList<StorageManager::Store> m_vacuumRequests;
+    PurgeRunStats m_stats;
+    qint64 m_runStartedAt;
+    bool m_running;
+    bool m_rerunRequested;
+};
+
+#endif // RETENTIONMANAGER_H
@@ -0,0 +1,125 @@
+#include "SchemaMigrator.h"
+#include <QSqlRecord>
+#include <QDebug>
+#include <algorithm>
+
+SchemaMigrator::SchemaMigrator(const QSqlDatabase& database, const QString& name)
+    : m_database(database)
+    , m_name(name)
+{
+}
+
+void SchemaMigrator::addMigration(int version, const QString& description, const QStringList& statements)
+{
+    addMigration(version, description, [statements](QSqlDatabase& database) {
+        QSqlQuery query(database);
+        for (const QString& sql : statements) {
+            if (!query.exec(sql)) {
+                qWarning() << "迁移语句执行失败:" << query.lastError().text() << sql;
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+void SchemaMigrator::addMigration(int version, const QString& description, MigrationStep step)
+{
+    Migration migration;
+    migration.version = version;
+    migration.description = description;
+    migration.step = step;
+    m_migrations.append(migration);
+}
+
+int SchemaMigrator::currentVersion()
+{
+    QSqlQuery query(m_database);
+    if (query.exec("PRAGMA user_version") && query.next()) {
+        return query.value(0).toInt();
+    }
+    return 0;
+}
+
+int SchemaMigrator::latestVersion() const
+{
+    int latest = 0;
+    for (const Migration& migration : m_migrations) {
+        latest = qMax(latest, migration.version);
+    }
+    return latest;
+}
+
+QString SchemaMigrator::lastError() const
+{
+    return m_lastError;
+}
+
+bool SchemaMigrator::migrate()
+{
+    std::sort(m_migrations.begin(), m_migrations.end(), [](const Migration& a, const Migration& b) {
+        return a.version < b.version;
+    });
+
+    int version = currentVersion();
+    if (version > latestVersion()) {
+        qWarning() << QString("%1: 数据库版本 %2 高于程序支持的版本 %3")
+                          .arg(m_name).arg(version).arg(latestVersion());
+        return true;
+    }
+
+    for (const Migration& migration : m_migrations) {
+        if (migration.version <= version) {
+            continue;
+        }
+
+        qDebug() << QString("%1: 执行迁移 v%2 - %3").arg(m_name).arg(migration.version).arg(migration.description);
+        if (!applyMigration(migration)) {
+            return false;
+        }
+        version = migration.version;
+    }
+
+    return true;
+}
+
+bool SchemaMigrator::applyMigration(const Migration& migration)
+{
+    if (!m_database.transaction()) {
+        setLastError("无法开启迁移事务: " + m_database.lastError().text());
+        return false;
+    }
+
+    if (!migration.step(m_database)) {
+        m_database.rollback();
+        setLastError(QString("迁移 v%1 (%2) 失败").arg(migration.version).arg(migration.description));
+        return false;
+    }
+
+    // user_version 写在数据库头中，随事务一起提交
+    QSqlQuery query(m_database);
+    if (!query.exec(QString("PRAGMA user_version = %1").arg(migration.version))) {
+        m_database.rollback();
+        setLastError("更新数据库版本失败: " + query.lastError().text());
+        return false;
+    }
+
+    if (!m_database.commit()) {
+        m_database.rollback();
+        setLastError("提交迁移失败: " + m_database.lastError().text());
+        return false;
+    }
+
+    return true;
+}
+
+bool SchemaMigrator::hasColumn(QSqlDatabase& database, const QString& table, const QString& column)
+{
+    return database.record(table).indexOf(column) >= 0;
+}
+
+void SchemaMigrator::setLastError(const QString& error)
+{
+    m_lastError = error;
+    qWarning() << m_name << "迁移错误:" << error;
+}
@@ -0,0 +1,53 @@
+#ifndef SCHEMAMIGRATOR_H
+#define SCHEMAMIGRATOR_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <functional>
+
+// 基于 PRAGMA user_version 的数据库结构迁移：
+// 迁移按版本号升序执行，每个迁移在独立事务中完成并同时写入新的 user_version，
+// 已执行过的迁移在后续启动时直接跳过。
+class SchemaMigrator
+{
+public:
+    using MigrationStep = std::function<bool(QSqlDatabase& database)>;
+
+    SchemaMigrator(const QSqlDatabase& database, const QString& name);
+
+    // 由若干 SQL 语句组成的迁移
+    void addMigration(int version, const QString& description, const QStringList& statements);
+    // 需要自定义逻辑的迁移（如按条件补列、写入默认数据）
+    void addMigration(int version, const QString& description, MigrationStep step);
+
+    // 执行所有未执行的迁移
+    bool migrate();
+
+    int currentVersion();
+    int latestVersion() const;
+    QString lastError() const;
+
+    // 迁移中常用的辅助方法
+    static bool hasColumn(QSqlDatabase& database, const QString& table, const QString& column);
+
+private:
+    struct Migration {
+        int version;
+        QString description;
+        MigrationStep step;
+    };
+
+    bool applyMigration(const Migration& migration);
+    void setLastError(const QString& error);
+
+    QSqlDatabase m_database;
+    QString m_name;
+    QList<Migration> m_migrations;
+    QString m_lastError;
+};
+
+#endif // SCHEMAMIGRATOR_H
@@ -0,0 +1,76 @@
+#include "SqlStatementCache.h"
+#include <QSqlError>
+#include <QDebug>
+
+SqlStatementCache::SqlStatementCache(const QSqlDatabase& database, int capacity)
+    : m_database(database)
+    , m_capacity(qMax(1, capacity))
+    , m_hits(0)
+    , m_misses(0)
+    , m_size(0)
+{
+}
+
+SqlStatementCache::~SqlStatementCache()
+{
+    clear();
+}
+
+QSqlQuery& SqlStatementCache::prepared(const QString& sql)
+{
+    auto it = m_statements.find(sql);
+    if (it != m_statements.end()) {
+        ++m_hits;
+        touch(sql);
+        QSqlQuery* query = it.value();
+        // 上一次使用者忘记 finish() 时也不要持有旧的结果集
+        if (query->isActive()) {
+            query->finish();
+        }
+        return *query;
+    }
+
+    ++m_misses;
+
+    // 超出容量时淘汰最久未使用的语句
+    while (m_statements.size() >= m_capacity && !m_lru.isEmpty()) {
+        QString oldest = m_lru.takeFirst();
+        delete m_statements.take(oldest);
+    }
+
+    QSqlQuery* query = new QSqlQuery(m_database);
+    if (!query->prepare(sql)) {
+        qWarning() << "SqlStatementCache: 预编译失败:" << query->lastError().text();
+    }
+
+    m_statements.insert(sql, query);
+    m_lru.append(sql);
+    m_size = m_statements.size();
+    return *query;
+}
+
+void SqlStatementCache::touch(const QString& sql)
+{
+    // 命中的语句移到末尾；缓存很小，线性查找即可
+    int index = m_lru.lastIndexOf(sql);
+    if (index >= 0 && index != m_lru.size() - 1) {
+        m_lru.move(index, m_lru.size() - 1);
+    }
+}
+
+void SqlStatementCache::clear()
+{
+    qDeleteAll(m_statements);
+    m_statements.clear();
+    m_lru.clear();
+    m_size = 0;
+}
+
+SqlStatementCache::Stats SqlStatementCache::stats() const
+{
+    Stats stats;
+    stats.hits = m_hits.load();
+    stats.misses = m_misses.load();
+    stats.cachedStatements = m_size.load();
+    return stats;
+}
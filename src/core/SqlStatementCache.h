@@ -0,0 +1,48 @@
+#ifndef SQLSTATEMENTCACHE_H
+#define SQLSTATEMENTCACHE_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <atomic>
+
+// 单个数据库连接上的预编译语句缓存：
+// 相同 SQL 文本只 prepare 一次，之后重新绑定参数复用同一个语句。
+// 缓存与连接一一对应，只能在持有该连接的线程中使用；计数器可跨线程读取。
+class SqlStatementCache
+{
+public:
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        int cachedStatements = 0;
+    };
+
+    explicit SqlStatementCache(const QSqlDatabase& database, int capacity = 64);
+    ~SqlStatementCache();
+
+    // 返回已 prepare 的语句；prepare 失败时返回的语句 isValid() 为 false，exec() 会报错。
+    // SELECT 读取完结果后应调用 finish() 释放读锁。
+    QSqlQuery& prepared(const QString& sql);
+
+    void clear();
+    Stats stats() const;
+
+private:
+    SqlStatementCache(const SqlStatementCache&) = delete;
+    SqlStatementCache& operator=(const SqlStatementCache&) = delete;
+
+    void touch(const QString& sql);
+
+    QSqlDatabase m_database;
+    int m_capacity;
+    QHash<QString, QSqlQuery*> m_statements;
+    QList<QString> m_lru; // 最近使用的在末尾
+    std::atomic<quint64> m_hits;
+    std::atomic<quint64> m_misses;
+    std::atomic<int> m_size;
+};
+
+#endif // SQLSTATEMENTCACHE_H
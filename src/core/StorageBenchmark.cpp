@@ -0,0 +1,253 @@
+#include "StorageBenchmark.h"
+#include "EpochTime.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QDeadlineTimer>
+#include <QRandomGenerator>
+#include <QAtomicInteger>
+#include <QDateTime>
+#include <QDebug>
+
+namespace {
+
+const int SESSION_COUNT = 50;
+const int PAGE_SIZE = 50;
+
+struct Counters {
+    QAtomicInteger<qint64> writes;
+    QAtomicInteger<qint64> reads;
+    QAtomicInteger<qint64> busyErrors;
+};
+
+// 每个线程独立的连接，离开作用域时关闭并移除
+class BenchmarkConnection
+{
+public:
+    BenchmarkConnection(const QString& name, const QString& path, const StorageProfile& profile)
+        : m_name(name)
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", m_name);
+        db.setDatabaseName(path);
+        if (db.open()) {
+            profile.apply(db);
+        } else {
+            qWarning() << "StorageBenchmark: 打开数据库失败:" << db.lastError().text();
+        }
+    }
+
+    ~BenchmarkConnection()
+    {
+        {
+            QSqlDatabase db = QSqlDatabase::database(m_name, false);
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(m_name);
+    }
+
+    QSqlDatabase database() const { return QSqlDatabase::database(m_name, false); }
+
+private:
+    QString m_name;
+};
+
+bool isBusy(const QSqlError& error)
+{
+    // SQLITE_BUSY = 5, SQLITE_LOCKED = 6
+    const QString code = error.nativeErrorCode();
+    return code == "5" || code == "6";
+}
+
+bool prepareDatabase(const QString& path, const StorageProfile& profile, int seedRows)
+{
+    BenchmarkConnection connection(QString("Cyan_bench_setup_%1").arg(profile.name), path, profile);
+    QSqlDatabase db = connection.database();
+    if (!db.isOpen()) {
+        return false;
+    }
+
+    // 与 Cyan.db 的 chat_messages 结构和游标索引一致
+    QSqlQuery query(db);
+    if (!query.exec(R"(
+        CREATE TABLE IF NOT EXISTS chat_messages (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            session_id INTEGER NOT NULL,
+            sender_id INTEGER NOT NULL,
+            content TEXT NOT NULL,
+            message_type INTEGER DEFAULT 0,
+            timestamp INTEGER NOT NULL
+        )
+    )") || !query.exec("CREATE INDEX IF NOT EXISTS idx_chat_messages_session_id "
+                       "ON chat_messages(session_id, id, sender_id)")) {
+        qWarning() << "StorageBenchmark: 创建表失败:" << query.lastError().text();
+        return false;
+    }
+
+    db.transaction();
+    query.prepare("INSERT INTO chat_messages (session_id, sender_id, content, timestamp) VALUES (?, ?, ?, ?)");
+    for (int i = 0; i < seedRows; ++i) {
+        query.addBindValue(i % SESSION_COUNT + 1);
+        query.addBindValue(i % 7 + 1);
+        query.addBindValue(QString("预置消息 %1").arg(i));
+        query.addBindValue(EpochTime::nowMs());
+        query.exec();
+    }
+    return db.commit();
+}
+
+void writerLoop(const QString& name, const QString& path, const StorageProfile& profile,
+                const StorageBenchmark::Options& options, const QDeadlineTimer& deadline, Counters& counters)
+{
+    BenchmarkConnection connection(name, path, profile);
+    QSqlDatabase db = connection.database();
+    if (!db.isOpen()) {
+        return;
+    }
+
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO chat_messages (session_id, sender_id, content, timestamp) VALUES (?, ?, ?, ?)");
+    QRandomGenerator* random = QRandomGenerator::global();
+
+    while (!deadline.hasExpired()) {
+        // BEGIN IMMEDIATE 直接申请写锁，忙等待由 busy_timeout 处理，避免读锁升级时的死锁
+        QSqlQuery begin(db);
+        if (!begin.exec("BEGIN IMMEDIATE")) {
+            if (isBusy(begin.lastError())) {
+                counters.busyErrors.fetchAndAddRelaxed(1);
+            }
+            continue;
+        }
+
+        bool ok = true;
+        for (int i = 0; i < options.rowsPerTransaction && ok; ++i) {
+            query.addBindValue(random->bounded(SESSION_COUNT) + 1);
+            query.addBindValue(random->bounded(1, 8));
+            const qint64 now = EpochTime::nowMs();
+            query.addBindValue(QString("基准测试消息 %1").arg(now));
+            query.addBindValue(now);
+            ok = query.exec();
+        }
+
+        QSqlQuery end(db);
+        if (ok && end.exec("COMMIT")) {
+            counters.writes.fetchAndAddRelaxed(options.rowsPerTransaction);
+        } else {
+            if (isBusy(ok ? end.lastError() : query.lastError())) {
+                counters.busyErrors.fetchAndAddRelaxed(1);
+            }
+            end.exec("ROLLBACK");
+        }
+    }
+}
+
+void readerLoop(const QString& name, const QString& path, const StorageProfile& profile,
+                const QDeadlineTimer& deadline, Counters& counters)
+{
+    BenchmarkConnection connection(name, path, profile);
+    QSqlDatabase db = connection.database();
+    if (!db.isOpen()) {
+        return;
+    }
+
+    // 与 getChatMessages 相同：按游标索引读取会话最新一页
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, sender_id, content, timestamp FROM chat_messages "
+                  "WHERE session_id = ? ORDER BY id DESC LIMIT ?");
+    QRandomGenerator* random = QRandomGenerator::global();
+
+    while (!deadline.hasExpired()) {
+        query.addBindValue(random->bounded(SESSION_COUNT) + 1);
+        query.addBindValue(PAGE_SIZE);
+        if (query.exec()) {
+            while (query.next()) {
+            }
+            counters.reads.fetchAndAddRelaxed(1);
+        } else if (isBusy(query.lastError())) {
+            counters.busyErrors.fetchAndAddRelaxed(1);
+        }
+        query.finish();
+    }
+}
+
+} // namespace
+
+StorageBenchmarkResult StorageBenchmark::run(const StorageProfile& profile, const Options& options)
+{
+    StorageBenchmarkResult result;
+    result.profileName = profile.name;
+    result.writerThreads = options.writerThreads;
+    result.readerThreads = options.readerThreads;
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        qWarning() << "StorageBenchmark: 无法创建临时目录";
+        return result;
+    }
+    const QString path = dir.filePath("benchmark.db");
+
+    if (!prepareDatabase(path, profile, options.seedRows)) {
+        return result;
+    }
+
+    Counters counters;
+    QList<QThread*> threads;
+    QElapsedTimer timer;
+    timer.start();
+    const QDeadlineTimer deadline(options.durationMs);
+
+    for (int i = 0; i < options.writerThreads; ++i) {
+        const QString name = QString("Cyan_bench_%1_writer_%2").arg(profile.name).arg(i);
+        threads.append(QThread::create([name, path, profile, options, deadline, &counters]() {
+            writerLoop(name, path, profile, options, deadline, counters);
+        }));
+    }
+    for (int i = 0; i < options.readerThreads; ++i) {
+        const QString name = QString("Cyan_bench_%1_reader_%2").arg(profile.name).arg(i);
+        threads.append(QThread::create([name, path, profile, deadline, &counters]() {
+            readerLoop(name, path, profile, deadline, counters);
+        }));
+    }
+
+    for (QThread* thread : threads) {
+        thread->start();
+    }
+    for (QThread* thread : threads) {
+        thread->wait();
+        delete thread;
+    }
+
+    result.elapsedMs = timer.elapsed();
+    result.writes = counters.writes.loadRelaxed();
+    result.reads = counters.reads.loadRelaxed();
+    result.busyErrors = counters.busyErrors.loadRelaxed();
+
+    qDebug() << QString("StorageBenchmark: %1 写 %2 条/秒, 读 %3 次/秒, 锁冲突 %4 次")
+                    .arg(profile.name)
+                    .arg(result.writesPerSecond(), 0, 'f', 0)
+                    .arg(result.readsPerSecond(), 0, 'f', 0)
+                    .arg(result.busyErrors);
+    return result;
+}
+
+StorageBenchmarkResult StorageBenchmark::run(const StorageProfile& profile)
+{
+    return run(profile, Options());
+}
+
+QList<StorageBenchmarkResult> StorageBenchmark::runAll(const Options& options)
+{
+    QList<StorageBenchmarkResult> results;
+    for (const StorageProfile& profile : StorageProfile::all()) {
+        results.append(run(profile, options));
+    }
+    return results;
+}
+
+QList<StorageBenchmarkResult> StorageBenchmark::runAll()
+{
+    return runAll(Options());
+}
@@ -0,0 +1,42 @@
+#ifndef STORAGEBENCHMARK_H
+#define STORAGEBENCHMARK_H
+
+#include <QString>
+#include <QList>
+#include "StorageProfile.h"
+
+// 单个存储配置的并发读写结果
+struct StorageBenchmarkResult {
+    QString profileName;
+    int writerThreads = 0;
+    int readerThreads = 0;
+    qint64 elapsedMs = 0;
+    qint64 writes = 0;     // 成功写入的消息条数
+    qint64 reads = 0;      // 成功执行的分页查询次数
+    qint64 busyErrors = 0; // 超过 busy_timeout 仍拿不到锁的次数
+
+    double writesPerSecond() const { return writes * 1000.0 / qMax<qint64>(1, elapsedMs); }
+    double readsPerSecond() const { return reads * 1000.0 / qMax<qint64>(1, elapsedMs); }
+};
+
+// 存储配置基准测试：在临时目录的独立数据库上，用多个线程各自的连接
+// 模拟多实例共享 Cyan.db 的场景（写线程发送消息，读线程按游标翻页），
+// 不会触碰应用的真实数据。run() 会阻塞调用线程 durationMs 毫秒。
+class StorageBenchmark
+{
+public:
+    struct Options {
+        int writerThreads = 2;
+        int readerThreads = 4;
+        int durationMs = 2000;
+        int rowsPerTransaction = 10;
+        int seedRows = 5000;
+    };
+
+    static StorageBenchmarkResult run(const StorageProfile& profile, const Options& options);
+    static StorageBenchmarkResult run(const StorageProfile& profile);
+    static QList<StorageBenchmarkResult> runAll(const Options& options);
+    static QList<StorageBenchmarkResult> runAll();
+};
+
+#endif // STORAGEBENCHMARK_H
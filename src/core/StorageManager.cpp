@@ -0,0 +1,484 @@
+#include "StorageManager.h"
+#include "ChatArchiver.h"
+#include "SchemaMigrator.h"
+#include "EpochTime.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QStandardPaths>
+#include <QDir>
+#include <QThread>
+#include <QMutexLocker>
+#include <QSettings>
+#include <QDebug>
+
+namespace {
+// AI 问答库和问题统计库的表结构，%1 为表名（重建时先建临时表）
+const QString AI_CHAT_TABLE_SQL =
+    "CREATE TABLE IF NOT EXISTS %1 ("
+    "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+    "session_id TEXT,"
+    "content TEXT,"
+    "message_type INTEGER,"
+    "timestamp INTEGER)";
+const QString QUESTION_RECORDS_TABLE_SQL =
+    "CREATE TABLE IF NOT EXISTS %1 ("
+    "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+    "user_id TEXT,"
+    "question TEXT,"
+    "keywords TEXT,"
+    "category TEXT,"
+    "timestamp INTEGER)";
+
+// 早期版本把时间以本地时间 ISO 字符串写在 TEXT 列中，TEXT 亲和性会把绑定的整数再转成文本，
+// 只能重建表：timestamp 改为 INTEGER，已有数据换算为纪元毫秒
+bool rebuildWithEpochTimestamp(QSqlDatabase& db, const QString& table,
+                               const QString& createSql, const QString& columns)
+{
+    QSqlQuery query(db);
+    QString declaredType;
+    if (query.exec(QString("SELECT type FROM pragma_table_info('%1') WHERE name = 'timestamp'").arg(table))
+        && query.next()) {
+        declaredType = query.value(0).toString();
+    }
+    query.finish();
+
+    // 新库直接按 INTEGER 建表；另一个连接可能已经完成了重建
+    if (declaredType.compare("TEXT", Qt::CaseInsensitive) != 0) {
+        return true;
+    }
+
+    const QStringList statements = {
+        createSql.arg(table + "_new"),
+        QString("INSERT INTO %1_new (%2, timestamp) SELECT %2, %3 FROM %1")
+            .arg(table, columns, EpochTime::textToMsExpression("timestamp", EpochTime::LocalText)),
+        QString("DROP TABLE %1").arg(table),
+        QString("ALTER TABLE %1_new RENAME TO %1").arg(table)
+    };
+    for (const QString& sql : statements) {
+        if (!query.exec(sql)) {
+            qWarning() << "StorageManager: 重建" << table << "失败:" << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+StorageManager* StorageManager::m_instance = nullptr;
+
+StorageManager* StorageManager::instance()
+{
+    if (!m_instance) {
+        m_instance = new StorageManager;
+    }
+    return m_instance;
+}
+
+StorageManager::StorageManager(QObject *parent)
+    : QObject(parent)
+    , m_profileGeneration(0)
+{
+    QSettings settings(settingsPath(), QSettings::IniFormat);
+    m_profile = StorageProfile::byName(
+        settings.value("storage/profile", StorageProfile::defaultName()).toString());
+    // 早期版本允许把 bulk-import 保存为全局配置，它会让所有库的 WAL 无限增长
+    if (m_profile.importOnly) {
+        m_profile = StorageProfile::desktop();
+    }
+    qDebug() << "StorageManager: 存储配置" << m_profile.name;
+}
+
+StorageManager::~StorageManager()
+{
+    closeAll();
+}
+
+QString StorageManager::dataDirectory() const
+{
+    QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (dataPath.isEmpty()) {
+        dataPath = QStandardPaths::writableLocation(QStandardPaths::HomeLocation) + "/Cyanla";
+    }
+
+    QDir().mkpath(dataPath);
+    return dataPath;
+}
+
+QString StorageManager::databasePath(Store store) const
+{
+    switch (store) {
+    case MainStore:        return dataDirectory() + "/Cyan.db";
+    case ChatHistoryStore: return dataDirectory() + "/chat_history.db";
+    case AIChatStore:      return dataDirectory() + "/ai_chat_history.db";
+    case StatsStore:       return dataDirectory() + "/question_stats.db";
+    case OutboxStore:      return dataDirectory() + "/outbox.db";
+    }
+    return QString();
+}
+
+QString StorageManager::settingsPath() const
+{
+    return dataDirectory() + "/storage.ini";
+}
+
+QString StorageManager::schemaName(Store store)
+{
+    switch (store) {
+    case MainStore:        return "main";
+    case ChatHistoryStore: return "chat_history";
+    case AIChatStore:      return "ai_chat";
+    case StatsStore:       return "stats";
+    case OutboxStore:      return "outbox";
+    }
+    return QString();
+}
+
+QString StorageManager::connectionName(Store store) const
+{
+    return threadConnectionName(schemaName(store));
+}
+
+QString StorageManager::threadConnectionName(const QString& purpose) const
+{
+    return QString("Cyan_%1_%2")
+        .arg(purpose)
+        .arg(reinterpret_cast<quintptr>(QThread::currentThread()), 0, 16);
+}
+
+QSqlDatabase StorageManager::connection(Store store)
+{
+    const QString name = connectionName(store);
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (QSqlDatabase::contains(name)) {
+            QSqlDatabase db = QSqlDatabase::database(name);
+            // 其他线程切换过配置，在这个连接所属的线程上补上
+            if (m_appliedGeneration.value(name) != m_profileGeneration) {
+                configureConnection(db);
+            }
+            return db;
+        }
+    }
+
+    QSqlDatabase db = openConnection(name, databasePath(store));
+    if (db.isOpen()) {
+        ensureSchema(store, db);
+    }
+    return db;
+}
+
+QSqlDatabase StorageManager::reportingConnection()
+{
+    const QString name = threadConnectionName("report");
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (QSqlDatabase::contains(name)) {
+            return QSqlDatabase::database(name);
+        }
+    }
+
+    // 先确保各库的表已存在，报表查询不必逐个判断
+    for (Store store : {ChatHistoryStore, AIChatStore, StatsStore}) {
+        connection(store);
+    }
+
+    QSqlDatabase db = openConnection(name, databasePath(MainStore));
+    if (!db.isOpen()) {
+        return db;
+    }
+
+    QSqlQuery query(db);
+    for (Store store : {ChatHistoryStore, AIChatStore, StatsStore}) {
+        query.prepare(QString("ATTACH DATABASE ? AS %1").arg(schemaName(store)));
+        query.addBindValue(databasePath(store));
+        if (!query.exec()) {
+            qWarning() << "StorageManager: ATTACH 失败:" << schemaName(store) << query.lastError().text();
+        }
+    }
+    return db;
+}
+
+QSqlDatabase StorageManager::openConnection(const QString& name, const QString& path)
+{
+    QMutexLocker locker(&m_mutex);
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+    db.setDatabaseName(path);
+    if (!db.open()) {
+        qWarning() << "StorageManager: 打开数据库失败:" << path << db.lastError().text();
+        return db;
+    }
+
+    // 只对尚未建表的新库生效；旧库由 RetentionManager 在清理后按需切换
+    QSqlQuery query(db);
+    query.exec("PRAGMA auto_vacuum = INCREMENTAL");
+
+    configureConnection(db);
+    m_threadConnections[QThread::currentThread()].append(name);
+    return db;
+}
+
+void StorageManager::configureConnection(QSqlDatabase& db)
+{
+    // 调用方持有 m_mutex
+    m_profile.apply(db);
+    m_appliedGeneration.insert(db.connectionName(), m_profileGeneration);
+}
+
+StorageProfile StorageManager::currentProfile() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_profile;
+}
+
+bool StorageManager::setProfile(const QString& name)
+{
+    if (!StorageProfile::names().contains(name)) {
+        qWarning() << "StorageManager: 未知的存储配置:" << name;
+        return false;
+    }
+    if (StorageProfile::byName(name).importOnly) {
+        qWarning() << "StorageManager: 存储配置" << name << "只能在导入期间使用";
+        return false;
+    }
+
+    bool ok = true;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_profile.name == name) {
+            return true;
+        }
+
+        m_profile = StorageProfile::byName(name);
+        ++m_profileGeneration;
+
+        QSettings settings(settingsPath(), QSettings::IniFormat);
+        settings.setValue("storage/profile", name);
+
+        // 当前线程的连接立即生效
+        const QStringList names = m_threadConnections.value(QThread::currentThread());
+        for (const QString& connectionName : names) {
+            QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+            if (db.isOpen()) {
+                ok = m_profile.apply(db) && ok;
+                m_appliedGeneration.insert(connectionName, m_profileGeneration);
+            }
+        }
+    }
+
+    qDebug() << "StorageManager: 存储配置切换为" << name;
+    emit profileChanged(name);
+    return ok;
+}
+
+bool StorageManager::checkpoint(Store store, bool truncate)
+{
+    QSqlDatabase db = connection(store);
+    if (!db.isOpen()) {
+        return false;
+    }
+
+    // 返回 (busy, WAL 页数, 已写回页数)，busy 非 0 表示有读者阻止了完整检查点
+    QSqlQuery query(db);
+    if (!query.exec(QString("PRAGMA wal_checkpoint(%1)").arg(truncate ? "TRUNCATE" : "PASSIVE"))
+        || !query.next()) {
+        qWarning() << "StorageManager: 检查点失败:" << schemaName(store) << query.lastError().text();
+        return false;
+    }
+
+    bool ok = query.value(0).toInt() == 0;
+    query.finish();
+    return ok;
+}
+
+bool StorageManager::beginBulkImport(Store store)
+{
+    QSqlDatabase db = connection(store);
+    if (!db.isOpen()) {
+        return false;
+    }
+    return StorageProfile::bulkImport().apply(db);
+}
+
+void StorageManager::endBulkImport(Store store)
+{
+    QSqlDatabase db = connection(store);
+    if (!db.isOpen()) {
+        return;
+    }
+
+    // 导入期间没有自动检查点，先把 WAL 合并回主库并截断，再恢复同步和自动检查点
+    checkpoint(store, true);
+
+    QMutexLocker locker(&m_mutex);
+    configureConnection(db);
+}
+
+bool StorageManager::ensureSchema(Store store, QSqlDatabase& db)
+{
+    // Cyan.db 和 chat_history.db 的表结构由 DatabaseManager / ChatStorage 的迁移负责
+    QSqlQuery query(db);
+    switch (store) {
+    case AIChatStore: {
+        SchemaMigrator migrator(db, schemaName(store));
+        migrator.addMigration(1, "AI 问答记录表", QStringList{AI_CHAT_TABLE_SQL.arg("ai_chat_messages")});
+        // v2: 时间列改为纪元毫秒，保留期清理和活动统计按时间范围扫描
+        migrator.addMigration(2, "时间列改为纪元毫秒", [](QSqlDatabase& database) {
+            QSqlQuery index(database);
+            return rebuildWithEpochTimestamp(database, "ai_chat_messages", AI_CHAT_TABLE_SQL,
+                                             "id, session_id, content, message_type")
+                && index.exec("CREATE INDEX IF NOT EXISTS idx_ai_chat_messages_timestamp "
+                              "ON ai_chat_messages(timestamp)");
+        });
+        // v3: AI 回答缓存（AnswerCache），按最近使用时间淘汰
+        migrator.addMigration(3, "AI 回答缓存表", QStringList{
+            "CREATE TABLE IF NOT EXISTS ai_answer_cache ("
+            "model TEXT NOT NULL,"
+            "prompt_version INTEGER NOT NULL,"
+            "question_key TEXT NOT NULL,"
+            "question TEXT NOT NULL,"
+            "answer TEXT NOT NULL,"
+            "created_at INTEGER NOT NULL,"
+            "last_hit_at INTEGER NOT NULL,"
+            "hit_count INTEGER NOT NULL DEFAULT 0,"
+            "PRIMARY KEY (model, prompt_version, question_key)) WITHOUT ROWID",
+            "CREATE INDEX IF NOT EXISTS idx_ai_answer_cache_last_hit ON ai_answer_cache(last_hit_at)"
+        });
+        return migrator.migrate();
+    }
+    case StatsStore: {
+        SchemaMigrator migrator(db, schemaName(store));
+        migrator.addMigration(1, "问题记录表", QStringList{QUESTION_RECORDS_TABLE_SQL.arg("question_records")});
+        // v2: 时间列改为纪元毫秒，问题统计按时间范围汇总
+        migrator.addMigration(2, "时间列改为纪元毫秒", [](QSqlDatabase& database) {
+            QSqlQuery index(database);
+            return rebuildWithEpochTimestamp(database, "question_records", QUESTION_RECORDS_TABLE_SQL,
+                                             "id, user_id, question, keywords, category")
+                && index.exec("CREATE INDEX IF NOT EXISTS idx_question_records_timestamp "
+                              "ON question_records(timestamp)");
+        });
+        return migrator.migrate();
+    }
+    case OutboxStore: {
+        SchemaMigrator migrator(db, schemaName(store));
+        migrator.addMigration(1, "发件箱表", QStringList{
+            R"(CREATE TABLE IF NOT EXISTS outbox_messages (
+                client_msg_id TEXT PRIMARY KEY,
+                session_id INTEGER NOT NULL,
+                sender_id INTEGER NOT NULL,
+                content TEXT NOT NULL,
+                message_type INTEGER NOT NULL DEFAULT 0,
+                created_at INTEGER NOT NULL,
+                attempts INTEGER NOT NULL DEFAULT 0,
+                next_attempt_at INTEGER NOT NULL DEFAULT 0,
+                last_error TEXT
+            ))",
+            "CREATE INDEX IF NOT EXISTS idx_outbox_messages_sender ON outbox_messages(sender_id, next_attempt_at)"
+        });
+        // v2: 重试次数用尽的消息标记为失败，不再自动投递，等待用户手动重发
+        migrator.addMigration(2, "发件箱失败标记", [](QSqlDatabase& database) {
+            QSqlQuery alter(database);
+            return SchemaMigrator::hasColumn(database, "outbox_messages", "failed")
+                || alter.exec("ALTER TABLE outbox_messages ADD COLUMN failed INTEGER NOT NULL DEFAULT 0");
+        });
+        return migrator.migrate();
+    }
+    case MainStore:
+    case ChatHistoryStore:
+        break;
+    }
+    return true;
+}
+
+void StorageManager::releaseThreadConnections()
+{
+    QMutexLocker locker(&m_mutex);
+
+    const QStringList names = m_threadConnections.take(QThread::currentThread());
+    for (const QString& name : names) {
+        {
+            QSqlDatabase db = QSqlDatabase::database(name, false);
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(name);
+        m_appliedGeneration.remove(name);
+    }
+}
+
+void StorageManager::closeAll()
+{
+    QMutexLocker locker(&m_mutex);
+
+    for (auto it = m_threadConnections.begin(); it != m_threadConnections.end(); ++it) {
+        for (const QString& name : it.value()) {
+            {
+                QSqlDatabase db = QSqlDatabase::database(name, false);
+                db.close();
+            }
+            QSqlDatabase::removeDatabase(name);
+        }
+    }
+    m_threadConnections.clear();
+    m_appliedGeneration.clear();
+}
+
+StorageActivityReport StorageManager::activityReport(const QDateTime& since)
+{
+    StorageActivityReport report;
+
+    QSqlDatabase db = reportingConnection();
+    if (!db.isOpen()) {
+        return report;
+    }
+
+    // 各库的时间列都是纪元毫秒
+    const qint64 sinceMs = EpochTime::toMs(since);
+
+    // chat_history.db 的表和视图由 ChatStorage 首次初始化时创建，可能还不存在；
+    // 通过 chat_messages_live 统计，已打上删除墓碑、等待清理的消息不计入
+    QSqlQuery query(db);
+    bool hasChatHistory = query.exec("SELECT 1 FROM chat_history.sqlite_master "
+                                     "WHERE type = 'view' AND name = 'chat_messages_live'")
+                          && query.next();
+    const QString archivedSql = hasChatHistory
+        ? "(SELECT COUNT(*) FROM chat_history.chat_messages_live WHERE timestamp >= ?)"
+        : "0";
+
+    query.prepare(QString(R"(
+        SELECT
+            (SELECT COUNT(DISTINCT session_id) FROM main.chat_messages WHERE timestamp >= ?) AS human_sessions,
+            (SELECT COUNT(*) FROM main.chat_messages WHERE sender_id > 0 AND timestamp >= ?) AS human_messages,
+            (SELECT COUNT(DISTINCT session_id) FROM ai_chat.ai_chat_messages WHERE timestamp >= ?) AS ai_sessions,
+            (SELECT COUNT(*) FROM ai_chat.ai_chat_messages WHERE timestamp >= ?) AS ai_messages,
+            (SELECT COUNT(*) FROM stats.question_records WHERE timestamp IS NULL OR timestamp >= ?) AS questions,
+            %1 AS archived
+    )").arg(archivedSql));
+    for (int i = 0; i < 5; ++i) {
+        query.addBindValue(sinceMs);
+    }
+    if (hasChatHistory) {
+        query.addBindValue(sinceMs);
+    }
+
+    if (query.exec() && query.next()) {
+        report.humanSessions = query.value("human_sessions").toInt();
+        report.humanMessages = query.value("human_messages").toInt();
+        report.aiSessions = query.value("ai_sessions").toInt();
+        report.aiMessages = query.value("ai_messages").toInt();
+        report.questionRecords = query.value("questions").toInt();
+        report.archivedMessages = query.value("archived").toInt();
+    } else {
+        qWarning() << "StorageManager: 跨库统计失败:" << query.lastError().text();
+    }
+
+    // 已归档的会话不在 main.chat_messages 中，按需 ATTACH 归档库补上
+    int archivedSessions = 0;
+    int archivedHumanMessages = 0;
+    ChatArchiver::instance()->countArchivedActivity(since, &archivedSessions, &archivedHumanMessages);
+    report.humanSessions += archivedSessions;
+    report.humanMessages += archivedHumanMessages;
+
+    return report;
+}
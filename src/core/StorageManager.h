@@ -0,0 +1,105 @@
+#ifndef STORAGEMANAGER_H
+#define STORAGEMANAGER_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMutex>
+#include <QDateTime>
+#include "StorageProfile.h"
+
+class QThread;
+
+// 跨库活动统计（人工客服 / AI 问答 / 问题统计）
+struct StorageActivityReport {
+    int humanSessions = 0;
+    int humanMessages = 0;
+    int aiSessions = 0;
+    int aiMessages = 0;
+    int questionRecords = 0;
+    int archivedMessages = 0; // chat_history.db 中的消息
+};
+
+// 统一管理应用的所有 SQLite 数据库文件：
+// - 每个库在每个线程上只有一个连接，连接名由管理器生成，多个窗口实例不会再冲突；
+// - 所有连接打开时应用当前存储配置（StorageProfile）的 PRAGMA；
+// - 报表连接以 Cyan.db 为主库并 ATTACH 其余三个库，跨库统计只需一条查询。
+//   合并连接只用于报表：业务读写仍各用本库的连接，检查点、bulk-import 配置和
+//   ChatArchiver 临时 ATTACH 的归档库都只影响单个库，语句也不必加库名前缀。
+// 备份（BackupManager）和基准测试（StorageBenchmark）操作的是副本或临时文件，自行打开连接。
+// QSqlDatabase 不能跨线程使用，connection() 总是返回调用线程自己的连接。
+class StorageManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Store {
+        MainStore,        // Cyan.db：用户、会话、客服消息
+        ChatHistoryStore, // chat_history.db：ChatStorage 消息记录
+        AIChatStore,      // ai_chat_history.db：AI 问答记录
+        StatsStore,       // question_stats.db：问题统计
+        OutboxStore       // outbox.db：尚未写入 Cyan.db 的待发送消息
+    };
+
+    static StorageManager* instance();
+
+    QString dataDirectory() const;
+    QString databasePath(Store store) const;
+    // ATTACH 时使用的库名
+    static QString schemaName(Store store);
+
+    // 当前线程上指定库的连接，首次调用时打开
+    QSqlDatabase connection(Store store);
+    QString connectionName(Store store) const;
+    // 当前线程上的报表连接：主库为 Cyan.db，其余库按 schemaName() ATTACH
+    QSqlDatabase reportingConnection();
+
+    // 关闭当前线程上由本管理器打开的所有连接（线程退出前调用）
+    void releaseThreadConnections();
+    // 关闭所有线程的连接（程序退出时在主线程调用）
+    void closeAll();
+
+    // 存储配置：保存在数据目录的 storage.ini 中，共享同一数据目录的实例使用同一配置。
+    // 切换后立即应用到调用线程的连接，其他线程的连接在下次 connection() 时应用
+    StorageProfile currentProfile() const;
+    bool setProfile(const QString& name);
+
+    // 手动检查点
+    bool checkpoint(Store store, bool truncate = false);
+
+    // 批量导入期间把调用线程上该库的连接临时切换为 bulk-import 配置；
+    // endBulkImport 做一次检查点并恢复当前配置，其他库和其他线程的连接不受影响
+    bool beginBulkImport(Store store);
+    void endBulkImport(Store store);
+
+    // 跨库统计，since 之后的数据（包括已归档会话的消息）
+    StorageActivityReport activityReport(const QDateTime& since);
+
+    // storage.ini：存储配置与归档等存储相关设置
+    QString settingsPath() const;
+
+signals:
+    void profileChanged(const QString& name);
+
+private:
+    explicit StorageManager(QObject *parent = nullptr);
+    ~StorageManager();
+
+    QString threadConnectionName(const QString& purpose) const;
+    QSqlDatabase openConnection(const QString& name, const QString& path);
+    void configureConnection(QSqlDatabase& db);
+    bool ensureSchema(Store store, QSqlDatabase& db);
+
+    static StorageManager* m_instance;
+
+    mutable QMutex m_mutex;
+    QHash<QThread*, QStringList> m_threadConnections;
+
+    StorageProfile m_profile;
+    int m_profileGeneration;
+    QHash<QString, int> m_appliedGeneration; // 连接名 -> 已应用的配置版本
+};
+
+#endif // STORAGEMANAGER_H
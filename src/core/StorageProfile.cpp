@@ -0,0 +1,126 @@
+#include "StorageProfile.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+
+StorageProfile StorageProfile::desktop()
+{
+    StorageProfile profile;
+    profile.name = "desktop";
+    profile.displayName = "桌面（单实例）";
+    profile.description = "WAL 日志，NORMAL 同步，16 MB 页缓存，64 MB 内存映射";
+    profile.journalMode = "WAL";
+    profile.synchronous = "NORMAL";
+    profile.busyTimeoutMs = 5000;
+    profile.cacheSizeKb = 16 * 1024;
+    profile.mmapSize = 64LL * 1024 * 1024;
+    profile.walAutoCheckpoint = 1000;
+    return profile;
+}
+
+StorageProfile StorageProfile::sharedServer()
+{
+    StorageProfile profile;
+    profile.name = "shared-server";
+    profile.displayName = "共享服务器（多实例）";
+    profile.description = "WAL 日志，FULL 同步，忙等待 15 秒，32 MB 页缓存，256 MB 内存映射";
+    profile.journalMode = "WAL";
+    profile.synchronous = "FULL";
+    profile.busyTimeoutMs = 15000;
+    profile.cacheSizeKb = 32 * 1024;
+    profile.mmapSize = 256LL * 1024 * 1024;
+    profile.walAutoCheckpoint = 2000;
+    return profile;
+}
+
+StorageProfile StorageProfile::bulkImport()
+{
+    StorageProfile profile;
+    profile.name = "bulk-import";
+    profile.displayName = "批量导入";
+    profile.description = "WAL 日志，关闭同步和自动检查点，128 MB 页缓存；仅在导入数据时使用";
+    profile.journalMode = "WAL";
+    profile.synchronous = "OFF";
+    profile.busyTimeoutMs = 30000;
+    profile.cacheSizeKb = 128 * 1024;
+    profile.mmapSize = 256LL * 1024 * 1024;
+    profile.walAutoCheckpoint = 0;
+    profile.importOnly = true;
+    return profile;
+}
+
+QList<StorageProfile> StorageProfile::all()
+{
+    return { desktop(), sharedServer(), bulkImport() };
+}
+
+QList<StorageProfile> StorageProfile::selectable()
+{
+    QList<StorageProfile> result;
+    for (const StorageProfile& profile : all()) {
+        if (!profile.importOnly) {
+            result.append(profile);
+        }
+    }
+    return result;
+}
+
+QStringList StorageProfile::names()
+{
+    QStringList result;
+    for (const StorageProfile& profile : all()) {
+        result.append(profile.name);
+    }
+    return result;
+}
+
+StorageProfile StorageProfile::byName(const QString& name)
+{
+    for (const StorageProfile& profile : all()) {
+        if (profile.name == name) {
+            return profile;
+        }
+    }
+    return desktop();
+}
+
+QString StorageProfile::defaultName()
+{
+    return desktop().name;
+}
+
+bool StorageProfile::apply(QSqlDatabase& db) const
+{
+    // busy_timeout 必须最先设置：切换 journal_mode 本身也可能遇到锁
+    const QStringList pragmas = {
+        QString("PRAGMA busy_timeout = %1").arg(busyTimeoutMs),
+        QString("PRAGMA journal_mode = %1").arg(journalMode),
+        QString("PRAGMA synchronous = %1").arg(synchronous),
+        // 负数表示以 KiB 为单位
+        QString("PRAGMA cache_size = -%1").arg(cacheSizeKb),
+        QString("PRAGMA mmap_size = %1").arg(mmapSize),
+        QString("PRAGMA wal_autocheckpoint = %1").arg(walAutoCheckpoint),
+        "PRAGMA temp_store = MEMORY"
+    };
+
+    bool ok = true;
+    QSqlQuery query(db);
+    for (const QString& pragma : pragmas) {
+        if (!query.exec(pragma)) {
+            qWarning() << "StorageProfile:" << pragma << "失败:" << query.lastError().text();
+            ok = false;
+        }
+    }
+    query.finish();
+
+    // 其他连接仍持有数据库时，WAL 无法切回 DELETE，SQLite 会返回实际模式而不报错
+    if (query.exec("PRAGMA journal_mode") && query.next()
+        && query.value(0).toString().compare(journalMode, Qt::CaseInsensitive) != 0) {
+        qWarning() << "StorageProfile:" << name << "期望日志模式" << journalMode
+                   << "实际为" << query.value(0).toString();
+        ok = false;
+    }
+    query.finish();
+    return ok;
+}
@@ -0,0 +1,46 @@
+#ifndef STORAGEPROFILE_H
+#define STORAGEPROFILE_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+
+class QSqlDatabase;
+
+// SQLite 连接参数组合，StorageManager 在打开连接时应用：
+// - desktop：单机单实例，WAL + NORMAL 同步，适中的缓存；
+// - shared-server：多个实例共享同一个数据库文件，更长的忙等待，FULL 同步；
+// - bulk-import：批量导入，关闭自动检查点和同步，由导入完成后手动检查点。
+//   它只在导入期间临时应用到导入所用的连接上（StorageManager::beginBulkImport），不能作为全局配置。
+struct StorageProfile {
+    QString name;         // 持久化使用的标识
+    QString displayName;  // 界面显示名称
+    QString description;
+    QString journalMode;  // WAL / DELETE
+    QString synchronous;  // OFF / NORMAL / FULL
+    int busyTimeoutMs = 5000;
+    int cacheSizeKb = 16384;
+    qint64 mmapSize = 0;
+    int walAutoCheckpoint = 1000; // 页数，0 表示关闭自动检查点
+    bool importOnly = false;      // 只用于单次导入，不能保存为全局配置
+
+    bool isValid() const { return !name.isEmpty(); }
+    bool autoCheckpointEnabled() const { return walAutoCheckpoint > 0; }
+
+    // 在连接上执行对应的 PRAGMA，任一失败返回 false（其余仍会执行）
+    bool apply(QSqlDatabase& db) const;
+
+    static StorageProfile desktop();
+    static StorageProfile sharedServer();
+    static StorageProfile bulkImport();
+
+    static QList<StorageProfile> all();
+    // 可以保存为全局配置的（不含 importOnly）
+    static QList<StorageProfile> selectable();
+    static QStringList names();
+    // 未知名称返回 desktop（含 importOnly 配置）
+    static StorageProfile byName(const QString& name);
+    static QString defaultName();
+};
+
+#endif // STORAGEPROFILE_H
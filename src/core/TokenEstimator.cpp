@@ -0,0 +1,51 @@
+#include "TokenEstimator.h"
+
+namespace {
+const QString ELLIPSIS = "……";
+}
+
+int TokenEstimator::estimate(const QString& text)
+{
+    int nonAscii = 0;
+    int ascii = 0;
+    for (const QChar ch : text) {
+        if (ch.unicode() < 0x80) {
+            ascii++;
+        } else if (!ch.isLowSurrogate()) {
+            nonAscii++;
+        }
+    }
+    return nonAscii + (ascii + 3) / 4;
+}
+
+QString TokenEstimator::clip(const QString& text, int maxTokens)
+{
+    if (estimate(text) <= maxTokens) {
+        return text;
+    }
+    const int budget = maxTokens - estimate(ELLIPSIS);
+    if (budget <= 0) {
+        return QString();
+    }
+
+    // 逐字累计，与 estimate() 的计法一致
+    int nonAscii = 0;
+    int ascii = 0;
+    int end = 0;
+    for (; end < text.size(); ++end) {
+        const QChar ch = text.at(end);
+        if (ch.unicode() < 0x80) {
+            ascii++;
+        } else if (!ch.isLowSurrogate()) {
+            nonAscii++;
+        }
+        if (nonAscii + (ascii + 3) / 4 > budget) {
+            break;
+        }
+    }
+    // 不把代理对拆开
+    if (end > 0 && text.at(end - 1).isHighSurrogate()) {
+        end--;
+    }
+    return text.left(end) + ELLIPSIS;
+}
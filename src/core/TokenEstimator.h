@@ -0,0 +1,16 @@
+#ifndef TOKENESTIMATOR_H
+#define TOKENESTIMATOR_H
+
+#include <QString>
+
+// 本地估算提示词的 token 数，用于在发请求前控制提示词大小，不调用分词服务。
+// 中文等非 ASCII 字符按 1 个 token，ASCII 约 4 个字符 1 个 token，略高于实际值，按预算截断时偏保守
+class TokenEstimator
+{
+public:
+    static int estimate(const QString& text);
+    // 截断到不超过 maxTokens，被截断时末尾加“……”
+    static QString clip(const QString& text, int maxTokens);
+};
+
+#endif // TOKENESTIMATOR_H
@@ -0,0 +1,108 @@
+#include "UserCache.h"
+#include <QMutexLocker>
+
+UserCache::UserCache(int capacity)
+    : m_capacity(qMax(1, capacity))
+    , m_hits(0)
+    , m_misses(0)
+{
+}
+
+bool UserCache::get(int userId, UserInfo& user)
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto it = m_users.constFind(userId);
+    if (it == m_users.constEnd()) {
+        ++m_misses;
+        return false;
+    }
+
+    ++m_hits;
+    user = it.value();
+    touch(userId);
+    return true;
+}
+
+bool UserCache::getByUsername(const QString& username, UserInfo& user)
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto idIt = m_idsByUsername.constFind(username);
+    if (idIt == m_idsByUsername.constEnd()) {
+        ++m_misses;
+        return false;
+    }
+
+    int userId = idIt.value();
+    ++m_hits;
+    user = m_users.value(userId);
+    touch(userId);
+    return true;
+}
+
+void UserCache::put(const UserInfo& user)
+{
+    if (user.id <= 0) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    // 同一用户重新写入时先移除旧条目（用户名可能已变化）
+    removeLocked(user.id);
+
+    while (m_users.size() >= m_capacity && !m_lru.isEmpty()) {
+        removeLocked(m_lru.first());
+    }
+
+    m_users.insert(user.id, user);
+    m_idsByUsername.insert(user.username, user.id);
+    m_lru.append(user.id);
+}
+
+void UserCache::invalidate(int userId)
+{
+    QMutexLocker locker(&m_mutex);
+    removeLocked(userId);
+}
+
+void UserCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_users.clear();
+    m_idsByUsername.clear();
+    m_lru.clear();
+}
+
+UserCache::Stats UserCache::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+
+    Stats stats;
+    stats.hits = m_hits.load();
+    stats.misses = m_misses.load();
+    stats.cachedUsers = m_users.size();
+    return stats;
+}
+
+void UserCache::touch(int userId)
+{
+    // 命中的用户移到末尾；缓存很小，线性查找即可
+    int index = m_lru.lastIndexOf(userId);
+    if (index >= 0 && index != m_lru.size() - 1) {
+        m_lru.move(index, m_lru.size() - 1);
+    }
+}
+
+void UserCache::removeLocked(int userId)
+{
+    auto it = m_users.find(userId);
+    if (it == m_users.end()) {
+        return;
+    }
+
+    m_idsByUsername.remove(it.value().username);
+    m_users.erase(it);
+    m_lru.removeOne(userId);
+}
@@ -0,0 +1,55 @@
+#ifndef USERCACHE_H
+#define USERCACHE_H
+
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <atomic>
+#include "DatabaseManager.h"
+
+// 用户信息缓存：按用户 ID 和用户名查找，容量有限，超出时淘汰最久未使用的用户。
+// 可在任意线程使用；用户信息被修改时由 DatabaseManager 负责使对应条目失效。
+class UserCache
+{
+public:
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        int cachedUsers = 0;
+
+        double hitRate() const {
+            quint64 total = hits + misses;
+            return total > 0 ? double(hits) / total : 0.0;
+        }
+    };
+
+    explicit UserCache(int capacity = 256);
+
+    // 命中时写入 user 并返回 true
+    bool get(int userId, UserInfo& user);
+    bool getByUsername(const QString& username, UserInfo& user);
+
+    void put(const UserInfo& user);
+    void invalidate(int userId);
+    void clear();
+
+    Stats stats() const;
+
+private:
+    UserCache(const UserCache&) = delete;
+    UserCache& operator=(const UserCache&) = delete;
+
+    void touch(int userId);
+    void removeLocked(int userId);
+
+    mutable QMutex m_mutex;
+    int m_capacity;
+    QHash<int, UserInfo> m_users;
+    QHash<QString, int> m_idsByUsername;
+    QList<int> m_lru; // 最近使用的在末尾
+    std::atomic<quint64> m_hits;
+    std::atomic<quint64> m_misses;
+};
+
+#endif // USERCACHE_H
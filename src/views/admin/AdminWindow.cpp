@@ -3,6 +3,7 @@
 #include "SystemStatsWidget.h"
 #include "SystemConfigWidget.h"
 #include "AuditLogWidget.h"
+#include "../../core/BackupManager.h"
 #include <QMessageBox>
 #include <QApplication>
 #include <QDesktopServices>
@@ -134,10 +135,32 @@ void AdminWindow::onBackupClicked()
         QMessageBox::Yes | QMessageBox::No
     );
     
-    if (reply == QMessageBox::Yes) {
-        // 这里可以调用实际的备份逻辑
-        QMessageBox::information(this, "备份完成", "数据备份已成功完成！\n备份文件已保存到系统默认位置。");
+    if (reply != QMessageBox::Yes) {
+        return;
+    }
+    
+    // 备份在后台线程进行，完成后提示结果；已有备份在进行时等它完成后提示
+    BackupManager* backup = BackupManager::instance();
+    m_actBackup->setEnabled(false);
+    connect(backup, &BackupManager::backupFinished, this, [this](const BackupRunStats& stats) {
+        m_actBackup->setEnabled(true);
+        if (stats.verified) {
+            QMessageBox::information(this, "备份完成",
+                                     QString("数据备份已完成并通过完整性检查。\n共 %1 个数据库，%2 MB，%3 MB/s\n保存位置：%4")
+                                         .arg(stats.files.size())
+                                         .arg(stats.bytes / 1048576.0, 0, 'f', 1)
+                                         .arg(stats.megabytesPerSecond(), 0, 'f', 1)
+                                         .arg(stats.directory));
+        } else {
+            QMessageBox::warning(this, "备份失败", "数据备份失败：" + stats.error);
+        }
+    }, Qt::SingleShotConnection);
+    
+    if (backup->isRunning()) {
+        QMessageBox::information(this, "数据备份", "已有备份正在进行，完成后会通知您。");
+        return;
     }
+    backup->backupNow();
 }
 
 void AdminWindow::onMaintenanceClicked()
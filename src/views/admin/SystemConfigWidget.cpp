@@ -1,7 +1,19 @@
 #include "SystemConfigWidget.h"
 #include "../common/UIStyleManager.h"
+#include "../../core/StorageManager.h"
+#include "../../core/StorageBenchmark.h"
+#include "../../core/AsyncDatabaseManager.h"
+#include "../../core/GroupCommitWriter.h"
+#include "../../core/ChatArchiver.h"
+#include "../../core/RetentionManager.h"
+#include "../../core/BackupManager.h"
+#include "../../core/AnswerCache.h"
 #include <QHeaderView>
 #include <QMessageBox>
+#include <QThread>
+#include <QPointer>
+#include <QSignalBlocker>
+#include <memory>
 
 SystemConfigWidget::SystemConfigWidget(QWidget *parent)
     : QWidget(parent)
@@ -328,6 +340,9 @@ void SystemConfigWidget::setupDepartmentTab()
     
     m_departmentTable->horizontalHeader()->setStretchLastSection(true);
     layout->addWidget(m_departmentTable);
+    
+    // 部门管理是唯一显示的选项卡，存储设置放在它下方
+    layout->addWidget(createStorageGroup());
 
     m_departmentTable->setStyleSheet(R"(
     QTableWidget {
@@ -381,9 +396,336 @@ void SystemConfigWidget::setupDepartmentTab()
 )");
 }
 
+QGroupBox* SystemConfigWidget::createStorageGroup()
+{
+    QGroupBox* storageGroup = new QGroupBox("存储设置");
+    UIStyleManager::applyGroupBoxStyle(storageGroup);
+    QVBoxLayout* storageLayout = new QVBoxLayout(storageGroup);
+    
+    QHBoxLayout* profileLayout = new QHBoxLayout;
+    profileLayout->addWidget(new QLabel("存储配置:"));
+    m_storageProfile = new QComboBox;
+    // bulk-import 只在导入期间临时使用，不提供为全局配置（性能测试中仍会比较）
+    for (const StorageProfile& profile : StorageProfile::selectable()) {
+        m_storageProfile->addItem(profile.displayName, profile.name);
+    }
+    profileLayout->addWidget(m_storageProfile);
+    
+    m_btnApplyStorage = new QPushButton("应用");
+    m_btnStorageBenchmark = new QPushButton("性能测试");
+    UIStyleManager::applyButtonStyle(m_btnApplyStorage, "primary");
+    UIStyleManager::applyButtonStyle(m_btnStorageBenchmark, "secondary");
+    profileLayout->addWidget(m_btnApplyStorage);
+    profileLayout->addWidget(m_btnStorageBenchmark);
+    profileLayout->addStretch();
+    storageLayout->addLayout(profileLayout);
+    
+    m_storageProfileInfo = new QLabel;
+    m_storageProfileInfo->setStyleSheet("font-size: 12px; color: #8E8E93;");
+    storageLayout->addWidget(m_storageProfileInfo);
+    
+    // 已结束会话的归档
+    QHBoxLayout* archiveLayout = new QHBoxLayout;
+    archiveLayout->addWidget(new QLabel("归档结束超过"));
+    m_archiveAfterDays = new QSpinBox;
+    m_archiveAfterDays->setRange(0, 3650);
+    m_archiveAfterDays->setSuffix(" 天");
+    m_archiveAfterDays->setSpecialValueText("不归档");
+    archiveLayout->addWidget(m_archiveAfterDays);
+    archiveLayout->addWidget(new QLabel("的会话"));
+    m_btnArchiveNow = new QPushButton("立即归档");
+    UIStyleManager::applyButtonStyle(m_btnArchiveNow, "secondary");
+    archiveLayout->addWidget(m_btnArchiveNow);
+    archiveLayout->addStretch();
+    storageLayout->addLayout(archiveLayout);
+    
+    // 保留策略：超出天数的记录由后台分块清除，0 表示永久保留
+    QHBoxLayout* retentionLayout = new QHBoxLayout;
+    retentionLayout->addWidget(new QLabel("保留天数:"));
+    for (const RetentionPolicy& policy : RetentionManager::policies()) {
+        retentionLayout->addWidget(new QLabel(policy.displayName));
+        QSpinBox* days = new QSpinBox;
+        days->setRange(0, 3650);
+        days->setSuffix(" 天");
+        days->setSpecialValueText("永久");
+        retentionLayout->addWidget(days);
+        m_retentionDays.insert(policy.name, days);
+        
+        const QString name = policy.name;
+        connect(days, &QSpinBox::valueChanged, [name](int value) {
+            RetentionManager::instance()->setPolicyDays(name, value);
+        });
+    }
+    m_btnPurgeNow = new QPushButton("立即清理");
+    UIStyleManager::applyButtonStyle(m_btnPurgeNow, "secondary");
+    retentionLayout->addWidget(m_btnPurgeNow);
+    retentionLayout->addStretch();
+    storageLayout->addLayout(retentionLayout);
+    
+    // 在线备份：后台生成快照并校验，不影响正在进行的聊天
+    QHBoxLayout* backupLayout = new QHBoxLayout;
+    m_backupEnabled = new QCheckBox("自动备份，间隔");
+    backupLayout->addWidget(m_backupEnabled);
+    m_backupIntervalHours = new QSpinBox;
+    m_backupIntervalHours->setRange(1, 24 * 30);
+    m_backupIntervalHours->setSuffix(" 小时");
+    backupLayout->addWidget(m_backupIntervalHours);
+    backupLayout->addWidget(new QLabel("保留"));
+    m_backupKeepCount = new QSpinBox;
+    m_backupKeepCount->setRange(1, 100);
+    m_backupKeepCount->setSuffix(" 份");
+    backupLayout->addWidget(m_backupKeepCount);
+    m_btnBackupNow = new QPushButton("立即备份");
+    UIStyleManager::applyButtonStyle(m_btnBackupNow, "secondary");
+    backupLayout->addWidget(m_btnBackupNow);
+    backupLayout->addStretch();
+    storageLayout->addLayout(backupLayout);
+    
+    // AI 回答缓存：常见问题直接从缓存回答，不再请求远程模型
+    QHBoxLayout* answerCacheLayout = new QHBoxLayout;
+    m_answerCacheEnabled = new QCheckBox("缓存常见问题回答，有效期");
+    answerCacheLayout->addWidget(m_answerCacheEnabled);
+    m_answerCacheTtlHours = new QSpinBox;
+    m_answerCacheTtlHours->setRange(1, 24 * 90);
+    m_answerCacheTtlHours->setSuffix(" 小时");
+    answerCacheLayout->addWidget(m_answerCacheTtlHours);
+    answerCacheLayout->addWidget(new QLabel("最多"));
+    m_answerCacheMaxEntries = new QSpinBox;
+    m_answerCacheMaxEntries->setRange(10, 100000);
+    m_answerCacheMaxEntries->setSuffix(" 条");
+    answerCacheLayout->addWidget(m_answerCacheMaxEntries);
+    m_btnClearAnswerCache = new QPushButton("清空缓存");
+    UIStyleManager::applyButtonStyle(m_btnClearAnswerCache, "secondary");
+    answerCacheLayout->addWidget(m_btnClearAnswerCache);
+    answerCacheLayout->addStretch();
+    storageLayout->addLayout(answerCacheLayout);
+    
+    m_answerCacheStats = new QLabel;
+    m_answerCacheStats->setStyleSheet("font-size: 12px; color: #8E8E93;");
+    storageLayout->addWidget(m_answerCacheStats);
+    
+    m_storageBenchmarkOutput = new QTextEdit;
+    m_storageBenchmarkOutput->setReadOnly(true);
+    m_storageBenchmarkOutput->setMaximumHeight(120);
+    m_storageBenchmarkOutput->setPlaceholderText("性能测试在临时数据库上进行，不影响现有数据");
+    UIStyleManager::applyTextEditStyle(m_storageBenchmarkOutput);
+    storageLayout->addWidget(m_storageBenchmarkOutput);
+    
+    connect(m_storageProfile, &QComboBox::currentIndexChanged,
+            this, &SystemConfigWidget::onStorageProfileSelected);
+    connect(m_btnApplyStorage, &QPushButton::clicked, this, &SystemConfigWidget::onApplyStorageProfile);
+    connect(m_btnStorageBenchmark, &QPushButton::clicked, this, &SystemConfigWidget::onRunStorageBenchmark);
+    connect(m_archiveAfterDays, &QSpinBox::valueChanged, [](int days) {
+        ChatArchiver::instance()->setArchiveAfterDays(days);
+    });
+    connect(m_btnArchiveNow, &QPushButton::clicked, this, &SystemConfigWidget::onArchiveNow);
+    connect(m_btnPurgeNow, &QPushButton::clicked, this, &SystemConfigWidget::onPurgeNow);
+    connect(RetentionManager::instance(), &RetentionManager::purgeFinished, this, [this](const PurgeRunStats& stats) {
+        m_storageBenchmarkOutput->setPlainText(
+            QString("清理完成：删除已标记消息 %1 条、过期记录 %2 条，归还 %3 个空闲页，分 %4 块执行，耗时 %5 ms")
+                .arg(stats.tombstoneRows).arg(stats.expiredRows).arg(stats.reclaimedPages)
+                .arg(stats.chunks).arg(stats.elapsedMs));
+        m_btnPurgeNow->setEnabled(true);
+    });
+    connect(m_backupIntervalHours, &QSpinBox::valueChanged, [](int hours) {
+        BackupManager::instance()->setIntervalHours(hours);
+    });
+    connect(m_backupKeepCount, &QSpinBox::valueChanged, [](int count) {
+        BackupManager::instance()->setKeepCount(count);
+    });
+    connect(m_backupEnabled, &QCheckBox::toggled, [](bool enabled) {
+        BackupManager::instance()->setEnabled(enabled);
+    });
+    connect(m_btnBackupNow, &QPushButton::clicked, this, &SystemConfigWidget::onBackupNow);
+    connect(m_answerCacheEnabled, &QCheckBox::toggled, [](bool enabled) {
+        AnswerCache::instance()->setEnabled(enabled);
+    });
+    connect(m_answerCacheTtlHours, &QSpinBox::valueChanged, [](int hours) {
+        AnswerCache::instance()->setTtlHours(hours);
+    });
+    connect(m_answerCacheMaxEntries, &QSpinBox::valueChanged, [](int count) {
+        AnswerCache::instance()->setMaxEntries(count);
+    });
+    connect(m_btnClearAnswerCache, &QPushButton::clicked, this, &SystemConfigWidget::onClearAnswerCache);
+    auto showAnswerCacheStats = [this](const AnswerCacheStats& stats) {
+        m_answerCacheStats->setText(
+            QString("回答缓存：%1 条，命中 %2 次、未命中 %3 次（命中率 %4%），过期 %5 条，淘汰 %6 条")
+                .arg(stats.entries).arg(stats.hits).arg(stats.misses)
+                .arg(stats.hitRate(), 0, 'f', 1).arg(stats.expired).arg(stats.evictions));
+    };
+    connect(AnswerCache::instance(), &AnswerCache::statsChanged, this, showAnswerCacheStats);
+    showAnswerCacheStats(AnswerCache::instance()->stats());
+    connect(BackupManager::instance(), &BackupManager::backupFinished, this, [this](const BackupRunStats& stats) {
+        QStringList lines;
+        if (stats.verified) {
+            lines << QString("备份完成：%1 个数据库，%2 MB，耗时 %3 ms，%4 MB/s")
+                         .arg(stats.files.size())
+                         .arg(stats.bytes / 1048576.0, 0, 'f', 1)
+                         .arg(stats.elapsedMs)
+                         .arg(stats.megabytesPerSecond(), 0, 'f', 1);
+            if (stats.pages > 0) {
+                lines << QString("分 %1 步复制 %2 页，期间因写入重新开始 %3 次")
+                             .arg(stats.steps).arg(stats.pages).arg(stats.restarts);
+            }
+            lines << QString("已通过完整性检查，保存在 %1").arg(stats.directory);
+        } else {
+            lines << "备份失败：" + stats.error;
+        }
+        m_storageBenchmarkOutput->setPlainText(lines.join("\n"));
+        m_btnBackupNow->setEnabled(true);
+    });
+    
+    return storageGroup;
+}
+
+void SystemConfigWidget::onStorageProfileSelected(int index)
+{
+    StorageProfile profile = StorageProfile::byName(m_storageProfile->itemData(index).toString());
+    m_storageProfileInfo->setText(profile.description);
+}
+
+void SystemConfigWidget::onApplyStorageProfile()
+{
+    const QString name = m_storageProfile->currentData().toString();
+    if (StorageManager::instance()->setProfile(name)) {
+        QMessageBox::information(this, "存储设置",
+                                 QString("已切换为「%1」，新打开的连接和各线程的现有连接都会使用该配置。")
+                                     .arg(m_storageProfile->currentText()));
+    } else {
+        QMessageBox::warning(this, "存储设置",
+                             "部分参数未能生效（例如其他实例仍在使用数据库时无法切换日志模式），详见日志。");
+    }
+}
+
+void SystemConfigWidget::onRunStorageBenchmark()
+{
+    m_btnStorageBenchmark->setEnabled(false);
+    m_storageBenchmarkOutput->setPlainText("正在测试各存储配置的并发读写性能...");
+    
+    // 每个配置阻塞数秒，放到独立线程执行
+    auto results = std::make_shared<QList<StorageBenchmarkResult>>();
+    QThread* thread = QThread::create([results]() {
+        *results = StorageBenchmark::runAll();
+    });
+    
+    QPointer<SystemConfigWidget> self(this);
+    connect(thread, &QThread::finished, thread, [self, results, thread]() {
+        thread->deleteLater();
+        if (!self) return;
+        
+        QStringList lines;
+        for (const StorageBenchmarkResult& result : *results) {
+            lines << QString("%1（%2 写 / %3 读线程）：写入 %4 条/秒，查询 %5 次/秒，锁冲突 %6 次")
+                         .arg(StorageProfile::byName(result.profileName).displayName)
+                         .arg(result.writerThreads)
+                         .arg(result.readerThreads)
+                         .arg(result.writesPerSecond(), 0, 'f', 0)
+                         .arg(result.readsPerSecond(), 0, 'f', 0)
+                         .arg(result.busyErrors);
+        }
+        
+        // 本进程聊天消息写入的组提交统计
+        GroupCommitWriter::Stats stats = AsyncDatabaseManager::instance()->groupCommitWriter()->stats();
+        lines << QString("组提交：%1 次提交（失败 %2 次，未写入 %3 条）")
+                     .arg(stats.commits).arg(stats.failedCommits).arg(stats.failedMessages)
+              << QString("  每批条数：%1").arg(stats.batchSize.toString("条"))
+              << QString("  提交耗时：%1").arg(stats.commitLatencyUs.toString("μs"))
+              << QString("  排队等待：%1").arg(stats.queueWaitUs.toString("μs"));
+        self->m_storageBenchmarkOutput->setPlainText(lines.join("\n"));
+        self->m_btnStorageBenchmark->setEnabled(true);
+    });
+    thread->start();
+}
+
+void SystemConfigWidget::onArchiveNow()
+{
+    const int days = m_archiveAfterDays->value();
+    if (days <= 0) {
+        QMessageBox::information(this, "存储设置", "请先设置归档天数。");
+        return;
+    }
+    
+    m_btnArchiveNow->setEnabled(false);
+    m_storageBenchmarkOutput->setPlainText(QString("正在归档结束超过 %1 天的会话...").arg(days));
+    
+    // 在数据库工作线程上执行，归档期间聊天写入排在其后
+    AsyncDatabaseManager::instance()->post(this, [days]() {
+        return ChatArchiver::instance()->archiveClosedSessions(days);
+    }, [this](const ArchiveRunStats& stats) {
+        // 归档搬走的消息在 Cyan.db 中留下的空闲页交给后台清理分批归还
+        if (stats.sessions > 0) {
+            RetentionManager::instance()->requestVacuum(StorageManager::MainStore);
+        }
+        QStringList lines;
+        lines << QString("归档 %1 个会话、%2 条消息，耗时 %3 ms")
+                     .arg(stats.sessions).arg(stats.messages).arg(stats.elapsedMs);
+        if (stats.messages > 0) {
+            lines << QString("消息正文 %1 KB，压缩后 %2 KB")
+                         .arg(stats.rawBytes / 1024.0, 0, 'f', 1)
+                         .arg(stats.storedBytes / 1024.0, 0, 'f', 1)
+                  << QString("归档库：%1").arg(stats.archiveFiles.join("，"));
+        }
+        m_storageBenchmarkOutput->setPlainText(lines.join("\n"));
+        m_btnArchiveNow->setEnabled(true);
+    });
+}
+
+void SystemConfigWidget::onPurgeNow()
+{
+    m_btnPurgeNow->setEnabled(false);
+    m_storageBenchmarkOutput->setPlainText("正在后台分块清理...");
+    RetentionManager::instance()->requestPurge();
+}
+
+void SystemConfigWidget::onBackupNow()
+{
+    if (BackupManager::instance()->isRunning()) {
+        return;
+    }
+    
+    m_btnBackupNow->setEnabled(false);
+    m_storageBenchmarkOutput->setPlainText("正在后台备份数据库，备份期间可以正常收发消息...");
+    BackupManager::instance()->backupNow();
+}
+
+void SystemConfigWidget::onClearAnswerCache()
+{
+    int ret = QMessageBox::question(this, "确认清空", "确定要清空 AI 回答缓存吗？\n之后的提问将重新请求 AI 服务。");
+    if (ret == QMessageBox::Yes) {
+        AnswerCache::instance()->clear();
+    }
+}
+
 void SystemConfigWidget::loadConfig()
 {
     // 从配置文件或数据库加载配置
+    int index = m_storageProfile->findData(StorageManager::instance()->currentProfile().name);
+    m_storageProfile->setCurrentIndex(qMax(0, index));
+    onStorageProfileSelected(m_storageProfile->currentIndex());
+    
+    QSignalBlocker blocker(m_archiveAfterDays);
+    m_archiveAfterDays->setValue(ChatArchiver::instance()->archiveAfterDays());
+    
+    for (auto it = m_retentionDays.constBegin(); it != m_retentionDays.constEnd(); ++it) {
+        QSignalBlocker retentionBlocker(it.value());
+        it.value()->setValue(RetentionManager::instance()->policyDays(it.key()));
+    }
+    
+    BackupManager* backup = BackupManager::instance();
+    QSignalBlocker enableBlocker(m_backupEnabled);
+    QSignalBlocker intervalBlocker(m_backupIntervalHours);
+    QSignalBlocker keepBlocker(m_backupKeepCount);
+    m_backupEnabled->setChecked(backup->isEnabled());
+    m_backupIntervalHours->setValue(backup->intervalHours());
+    m_backupKeepCount->setValue(backup->keepCount());
+    
+    AnswerCache* answerCache = AnswerCache::instance();
+    QSignalBlocker cacheEnableBlocker(m_answerCacheEnabled);
+    QSignalBlocker cacheTtlBlocker(m_answerCacheTtlHours);
+    QSignalBlocker cacheSizeBlocker(m_answerCacheMaxEntries);
+    m_answerCacheEnabled->setChecked(answerCache->isEnabled());
+    m_answerCacheTtlHours->setValue(answerCache->ttlHours());
+    m_answerCacheMaxEntries->setValue(answerCache->maxEntries());
 }
 
 void SystemConfigWidget::saveConfig()
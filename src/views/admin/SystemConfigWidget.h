@@ -16,6 +16,7 @@
 #include <QTableWidget>
 #include <QSlider>
 #include <QDialog>
+#include <QHash>
 
 class SystemConfigWidget : public QWidget
 {
@@ -35,6 +36,13 @@ private slots:
     void onAddDepartment();
     void onEditDepartment();
     void onDeleteDepartment();
+    void onStorageProfileSelected(int index);
+    void onApplyStorageProfile();
+    void onRunStorageBenchmark();
+    void onArchiveNow();
+    void onPurgeNow();
+    void onBackupNow();
+    void onClearAnswerCache();
 
 private:
     void setupUI();
@@ -42,6 +50,7 @@ private:
     void setupAIConfigTab();
     void setupFAQTab();
     void setupDepartmentTab();
+    QGroupBox* createStorageGroup();
     void loadConfig();
     void saveConfig();
 
@@ -94,6 +103,26 @@ private:
      QPushButton* m_btnSearchDept;
     QLineEdit* m_nameEdit;
     QLineEdit* m_descriptionEdit;
+    
+    // 存储设置
+    QComboBox* m_storageProfile;
+    QLabel* m_storageProfileInfo;
+    QPushButton* m_btnApplyStorage;
+    QPushButton* m_btnStorageBenchmark;
+    QTextEdit* m_storageBenchmarkOutput;
+    QSpinBox* m_archiveAfterDays;
+    QPushButton* m_btnArchiveNow;
+    QHash<QString, QSpinBox*> m_retentionDays; // 保留策略名 -> 天数
+    QPushButton* m_btnPurgeNow;
+    QCheckBox* m_backupEnabled;
+    QSpinBox* m_backupIntervalHours;
+    QSpinBox* m_backupKeepCount;
+    QPushButton* m_btnBackupNow;
+    QCheckBox* m_answerCacheEnabled;
+    QSpinBox* m_answerCacheTtlHours;
+    QSpinBox* m_answerCacheMaxEntries;
+    QPushButton* m_btnClearAnswerCache;
+    QLabel* m_answerCacheStats;
 };
 
 // FAQ编辑对话框
@@ -1,5 +1,6 @@
 #include "SystemStatsWidget.h"
 #include "../common/UIStyleManager.h"
+#include "../../core/StorageManager.h"
 #include <QHeaderView>
 #include <QMessageBox>
 #include <QFileDialog>
@@ -435,6 +436,15 @@ void SystemStatsWidget::onExportReport()
             out << "总对话数,799\n";
             out << "平均响应时间,3.25秒\n\n";
             
+            // 各渠道统计：一条跨库查询同时读取人工客服、AI 问答和问题统计
+            StorageActivityReport report = StorageManager::instance()->activityReport(
+                m_startDate->date().startOfDay());
+            out << "渠道统计,会话数,消息数\n";
+            out << "人工客服," << report.humanSessions << "," << report.humanMessages << "\n";
+            out << "AI问答," << report.aiSessions << "," << report.aiMessages << "\n";
+            out << "问题记录,," << report.questionRecords << "\n";
+            out << "聊天存档,," << report.archivedMessages << "\n\n";
+            
             QMessageBox::information(this, "导出成功", 
                                    QString("统计报表已导出到:\n%1").arg(fileName));
         }
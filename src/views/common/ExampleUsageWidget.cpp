@@ -6,6 +6,7 @@
 #include <QDateTime>
 #include <QGridLayout>
 #include <QSplitter>
+#include <QCoreApplication>
 
 ExampleUsageWidget::ExampleUsageWidget(QWidget *parent)
     : QWidget(parent)
@@ -20,6 +21,7 @@ ExampleUsageWidget::ExampleUsageWidget(QWidget *parent)
     , m_loadButton(nullptr)
     , m_clearButton(nullptr)
     , m_exportButton(nullptr)
+    , m_importButton(nullptr)
     , m_messagesList(nullptr)
     , m_statusLabel(nullptr)
     , m_styleDemoWidget(nullptr)
@@ -36,6 +38,8 @@ ExampleUsageWidget::ExampleUsageWidget(QWidget *parent)
     // 连接聊天存储信号
     connect(m_chatStorage, &ChatStorage::messageInserted,
             this, &ExampleUsageWidget::onMessageInserted);
+    connect(m_chatStorage, &ChatStorage::messagesInserted,
+            this, [this](const QList<Message> &) { updateMessagesList(); });
 }
 
 ExampleUsageWidget::~ExampleUsageWidget()
@@ -154,11 +158,15 @@ void ExampleUsageWidget::setupChatTab()
     m_exportButton = new QPushButton("💾 导出数据", actionGroup);
     UIStyleManager::applyButtonStyle(m_exportButton, "secondary");
     
+    m_importButton = new QPushButton("📥 导入数据", actionGroup);
+    UIStyleManager::applyButtonStyle(m_importButton, "secondary");
+    
     m_clearButton = new QPushButton("🗑️ 清空记录", actionGroup);
     UIStyleManager::applyButtonStyle(m_clearButton, "error");
     
     actionLayout->addWidget(m_loadButton);
     actionLayout->addWidget(m_exportButton);
+    actionLayout->addWidget(m_importButton);
     actionLayout->addWidget(m_clearButton);
     
     controlLayout->addWidget(actionGroup);
@@ -203,6 +211,7 @@ void ExampleUsageWidget::setupChatTab()
     connect(m_loadButton, &QPushButton::clicked, this, &ExampleUsageWidget::loadChatHistory);
     connect(m_clearButton, &QPushButton::clicked, this, &ExampleUsageWidget::clearChatHistory);
     connect(m_exportButton, &QPushButton::clicked, this, &ExampleUsageWidget::exportChatData);
+    connect(m_importButton, &QPushButton::clicked, this, &ExampleUsageWidget::importChatData);
     
     // 按回车发送消息
     connect(m_messageInput, &QLineEdit::returnPressed, this, &ExampleUsageWidget::sendTestMessage);
@@ -375,12 +384,27 @@ void ExampleUsageWidget::exportChatData()
                                                    "导出聊天数据",
                                                    QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + 
                                                    "/chat_export_" + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss") + ".json",
-                                                   "JSON files (*.json)");
+                                                   "JSON files (*.json);;NDJSON files (*.ndjson);;Gzip files (*.json.gz *.ndjson.gz)");
     
     if (!fileName.isEmpty()) {
-        QList<Message> messages = m_chatStorage->getAllMessages();
-        if (m_chatStorage->exportToFile(fileName, messages)) {
-            m_statusLabel->setText(QString("💾 已导出 %1 条记录").arg(messages.size()));
+        // 按扩展名选择格式，流式写出，不把全部记录读进内存
+        bool compress = fileName.endsWith(".gz", Qt::CaseInsensitive);
+        QString baseName = compress ? fileName.chopped(3) : fileName;
+        ExportFormat format = baseName.endsWith(".ndjson", Qt::CaseInsensitive)
+            ? ExportFormat::NdJson : ExportFormat::Json;
+        
+        qint64 exportedCount = 0;
+        QMetaObject::Connection progress = connect(m_chatStorage, &ChatStorage::exportProgress, this,
+            [this, &exportedCount](qint64 exported, qint64 total) {
+                exportedCount = exported;
+                m_statusLabel->setText(QString("💾 正在导出 %1/%2").arg(exported).arg(total));
+                QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+            });
+        bool ok = m_chatStorage->exportAllToFile(fileName, format, compress);
+        disconnect(progress);
+        
+        if (ok) {
+            m_statusLabel->setText(QString("💾 已导出 %1 条记录").arg(exportedCount));
             UIStyleManager::applyLabelStyle(m_statusLabel, "success");
         } else {
             m_statusLabel->setText("❌ 导出失败: " + m_chatStorage->getLastError());
@@ -389,6 +413,27 @@ void ExampleUsageWidget::exportChatData()
     }
 }
 
+void ExampleUsageWidget::importChatData()
+{
+    QString fileName = QFileDialog::getOpenFileName(this,
+                                                   "导入聊天数据",
+                                                   QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation),
+                                                   "JSON files (*.json)");
+    
+    if (!fileName.isEmpty()) {
+        int count = m_chatStorage->importFromFile(fileName);
+        if (count >= 0) {
+            BulkInsertStats stats = m_chatStorage->lastBulkInsertStats();
+            m_statusLabel->setText(QString("📥 已导入 %1 条记录 (%2 行/秒)")
+                                   .arg(count).arg(stats.rowsPerSecond, 0, 'f', 0));
+            UIStyleManager::applyLabelStyle(m_statusLabel, "success");
+        } else {
+            m_statusLabel->setText("❌ 导入失败: " + m_chatStorage->getLastError());
+            UIStyleManager::applyLabelStyle(m_statusLabel, "error");
+        }
+    }
+}
+
 void ExampleUsageWidget::updateMessagesList()
 {
     m_messagesList->clear();
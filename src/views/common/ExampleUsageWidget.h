@@ -31,6 +31,7 @@ private slots:
     void onMessageInserted(const Message &message);
     void clearChatHistory();
     void exportChatData();
+    void importChatData();
 
 private:
     void setupUI();
@@ -57,6 +58,7 @@ private:
     QPushButton *m_loadButton;
     QPushButton *m_clearButton;
     QPushButton *m_exportButton;
+    QPushButton *m_importButton;
     QListWidget *m_messagesList;
     QLabel *m_statusLabel;
     
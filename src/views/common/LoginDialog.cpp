@@ -1,5 +1,6 @@
 #include "LoginDialog.h"
 #include "RegisterDialog.h"
+#include "../../core/AsyncDatabaseManager.h"
 #include <QPainter>
 #include <QBrush>
 #include <QPen>
@@ -14,6 +15,7 @@
 LoginDialog::LoginDialog(QWidget *parent)
     : QDialog(parent)
     , m_loginSuccess(false)
+    , m_loginPending(false)
 {
     setWindowTitle("青蓝公司HR制度智能问答系统");
     setFixedSize(800, 600);
@@ -382,6 +384,11 @@ void LoginDialog::showEvent(QShowEvent *event)
 
 void LoginDialog::onLoginClicked()
 {
+    // 上一次登录请求尚未返回
+    if (m_loginPending) {
+        return;
+    }
+
     if (!validateInput()) {
         return;
     }
@@ -391,24 +398,34 @@ void LoginDialog::onLoginClicked()
     QString username = m_usernameEdit->text().trimmed();
     QString password = m_passwordEdit->text();
     
-    // 尝试登录
-    DatabaseManager* db = DatabaseManager::instance();
-    if (db->loginUser(username, password, m_currentUser)) {
+    // 尝试登录（在数据库线程执行，避免数据库繁忙时卡住界面）
+    m_loginPending = true;
+    m_loginButton->setEnabled(false);
+    AsyncDatabaseManager::instance()->loginUser(username, password, this,
+        [this](bool ok, const UserInfo& user) {
+        m_loginPending = false;
+        m_loginButton->setEnabled(true);
+
+        if (!ok) {
+            showMessage("用户名或密码错误！", true);
+            return;
+        }
+
+        m_currentUser = user;
+
         // 验证角色
         QString selectedRole = m_roleCombo->currentData().toString();
         if (m_currentUser.role != selectedRole) {
             showMessage("登录身份与账户角色不匹配！", true);
             return;
         }
-        
+
         m_loginSuccess = true;
         showMessage("登录成功！正在跳转...", false);
-        
+
         // 延迟关闭对话框，让用户看到成功消息
         QTimer::singleShot(1000, this, &QDialog::accept);
-    } else {
-        showMessage("用户名或密码错误！", true);
-    }
+    });
 }
 
 void LoginDialog::onRegisterClicked()
@@ -88,6 +88,7 @@ private:
     // 数据
     UserInfo m_currentUser;
     bool m_loginSuccess;
+    bool m_loginPending;
 };
 
 #endif // LOGINDIALOG_H 
\ No newline at end of file
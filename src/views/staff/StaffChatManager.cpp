@@ -1,11 +1,21 @@
 #include "StaffChatManager.h"
 #include "../common/UIStyleManager.h"
+#include "../../core/AsyncDatabaseManager.h"
+#include "../../core/ChatChangeNotifier.h"
+#include "../../core/MessageOutbox.h"
 #include <QMessageBox>
 #include <QScrollBar>
 #include <QApplication>
 #include <QKeyEvent>
 #include <QSplitter>
 
+namespace {
+const int HISTORY_PAGE_SIZE = 50;
+const int SYNC_BATCH_SIZE = 200;
+const int SEARCH_DELAY_MS = 300;
+const int SEARCH_RESULT_LIMIT = 50;
+}
+
 StaffChatManager::StaffChatManager(QWidget *parent)
     : QWidget(parent)
     , m_mainLayout(nullptr)
@@ -14,6 +24,12 @@ StaffChatManager::StaffChatManager(QWidget *parent)
     , m_rightPanel(nullptr)
     , m_activeSessionsList(nullptr)
     , m_waitingSessionsList(nullptr)
+    , m_searchGroup(nullptr)
+    , m_searchInput(nullptr)
+    , m_searchCurrentOnly(nullptr)
+    , m_searchResultsList(nullptr)
+    , m_searchTimer(nullptr)
+    , m_searchGeneration(0)
     , m_messageScrollArea(nullptr)
     , m_messageContainer(nullptr)
     , m_messageLayout(nullptr)
@@ -22,31 +38,36 @@ StaffChatManager::StaffChatManager(QWidget *parent)
     , m_closeSessionButton(nullptr)
     , m_currentSessionId(-1)
     , m_dbManager(DatabaseManager::instance())
-    , m_sessionCheckTimer(new QTimer(this))
-    , m_messageCheckTimer(new QTimer(this))
+    , m_asyncDb(AsyncDatabaseManager::instance())
+    , m_syncCursor(-1)
+    , m_oldestMessageId(0)
+    , m_hasMoreHistory(false)
+    , m_loadingHistory(false)
 {
     setupUI();
     
     // 连接数据库信号
     connect(m_dbManager, &DatabaseManager::newMessageReceived, 
             this, &StaffChatManager::onMessageReceived);
-    connect(m_dbManager, &DatabaseManager::sessionCreated, 
-            this, &StaffChatManager::onSessionCreated);
-    connect(m_dbManager, &DatabaseManager::sessionUpdated, 
-            this, &StaffChatManager::onSessionUpdated);
-    
-    // 定时检查新会话和消息
-    connect(m_sessionCheckTimer, &QTimer::timeout, this, &StaffChatManager::checkForNewSessions);
-    connect(m_messageCheckTimer, &QTimer::timeout, this, &StaffChatManager::checkForNewMessages);
     
-    m_sessionCheckTimer->start(3000); // 每3秒检查新会话
-    m_messageCheckTimer->start(2000); // 每2秒检查新消息
+    // 变更通知：只有当前会话有新消息时才拉取，会话列表变化时才重建列表
+    ChatChangeNotifier* notifier = ChatChangeNotifier::instance();
+    connect(notifier, &ChatChangeNotifier::messagesChanged,
+            this, &StaffChatManager::onSessionMessagesChanged);
+    connect(notifier, &ChatChangeNotifier::sessionListChanged,
+            this, &StaffChatManager::refreshSessionList);
+    
+    // 发件箱：消息写入数据库或重试时更新气泡上的发送状态
+    MessageOutbox* outbox = MessageOutbox::instance();
+    connect(outbox, &MessageOutbox::messageSent, this, &StaffChatManager::onOutboxMessageSent);
+    connect(outbox, &MessageOutbox::messageRetrying, this, &StaffChatManager::onOutboxMessageRetrying);
+    connect(outbox, &MessageOutbox::messageFailed, this, &StaffChatManager::onOutboxMessageFailed);
 }
 
 StaffChatManager::~StaffChatManager()
 {
     if (m_currentUser.id > 0) {
-        m_dbManager->updateUserOnlineStatus(m_currentUser.id, false);
+        m_asyncDb->updateUserOnlineStatus(m_currentUser.id, false);
     }
 }
 
@@ -113,6 +134,42 @@ void StaffChatManager::setupSessionList()
             this, &StaffChatManager::onSessionSelectionChanged);
     
     m_leftLayout->addWidget(m_activeSessionsGroup);
+    
+    setupSearchPanel();
+}
+
+void StaffChatManager::setupSearchPanel()
+{
+    // 聊天记录检索
+    m_searchGroup = new QGroupBox("聊天记录搜索", this);
+    UIStyleManager::applyGroupBoxStyle(m_searchGroup);
+    QVBoxLayout* searchLayout = new QVBoxLayout(m_searchGroup);
+    
+    m_searchInput = new QLineEdit(this);
+    m_searchInput->setPlaceholderText("输入关键词，多个词用空格分隔");
+    m_searchInput->setClearButtonEnabled(true);
+    UIStyleManager::applyLineEditStyle(m_searchInput);
+    searchLayout->addWidget(m_searchInput);
+    
+    m_searchCurrentOnly = new QCheckBox("仅当前会话", this);
+    searchLayout->addWidget(m_searchCurrentOnly);
+    
+    m_searchResultsList = new QListWidget(this);
+    m_searchResultsList->setWordWrap(true);
+    searchLayout->addWidget(m_searchResultsList);
+    
+    m_searchTimer = new QTimer(this);
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(SEARCH_DELAY_MS);
+    
+    connect(m_searchTimer, &QTimer::timeout, this, &StaffChatManager::runSearch);
+    connect(m_searchInput, &QLineEdit::textChanged, m_searchTimer, qOverload<>(&QTimer::start));
+    connect(m_searchInput, &QLineEdit::returnPressed, this, &StaffChatManager::runSearch);
+    connect(m_searchCurrentOnly, &QCheckBox::toggled, this, &StaffChatManager::runSearch);
+    connect(m_searchResultsList, &QListWidget::itemDoubleClicked,
+            this, &StaffChatManager::onSearchResultActivated);
+    
+    m_leftLayout->addWidget(m_searchGroup);
 }
 
 void StaffChatManager::setupChatArea()
@@ -143,6 +200,10 @@ void StaffChatManager::setupChatArea()
     m_messageScrollArea->setWidget(m_messageContainer);
     UIStyleManager::applyScrollAreaStyle(m_messageScrollArea);
     
+    // 滚动到顶部时加载更早的消息
+    connect(m_messageScrollArea->verticalScrollBar(), &QScrollBar::valueChanged,
+            this, &StaffChatManager::onMessageScrollChanged);
+    
     m_rightLayout->addWidget(m_messageScrollArea);
     
     // 输入区域
@@ -204,7 +265,10 @@ void StaffChatManager::setCurrentUser(const UserInfo& user)
     m_currentUser = user;
     
     // 更新在线状态
-    m_dbManager->updateUserOnlineStatus(user.id, true);
+    m_asyncDb->updateUserOnlineStatus(user.id, true);
+    
+    // 继续投递上次未写入数据库的消息
+    MessageOutbox::instance()->resume(user.id);
     
     // 更新统计标签
     // m_statsLabel->setText(QString("客服工作台 - %1").arg(user.realName.isEmpty() ? user.username : user.realName));
@@ -213,19 +277,27 @@ void StaffChatManager::setCurrentUser(const UserInfo& user)
     loadSessionList();
 }
 
-void StaffChatManager::loadSessionList()
+void StaffChatManager::loadSessionList(std::function<void()> onLoaded)
 {
     if (m_currentUser.id <= 0) return;
     
+    // 获取活跃会话
+    m_asyncDb->getActiveSessions(m_currentUser.id, this, [this, onLoaded](const QList<ChatSession>& activeSessions) {
+        populateSessionList(activeSessions);
+        if (onLoaded) {
+            onLoaded();
+        }
+    });
+}
+
+void StaffChatManager::populateSessionList(const QList<ChatSession>& activeSessions)
+{
     // 清空列表
     m_activeSessionsList->clear();
     m_waitingSessionsList->clear();
     m_itemToSessionId.clear();
     m_sessions.clear();
     
-    // 获取活跃会话
-    QList<ChatSession> activeSessions = m_dbManager->getActiveSessions();
-    
     for (const ChatSession& session : activeSessions) {
         m_sessions[session.id] = session;
         
@@ -253,16 +325,25 @@ QListWidgetItem* StaffChatManager::createSessionItem(const ChatSession& session)
 {
     QListWidgetItem* item = new QListWidgetItem;
     
-    QString text = QString("%1\n最后消息: %2")
-                   .arg(session.visitorName)
-                   .arg(formatTime(session.lastMessageAt));
-    
-    item->setText(text);
+    item->setText(sessionItemText(session));
     updateSessionItemStyle(item, session);
     
     return item;
 }
 
+QString StaffChatManager::sessionItemText(const ChatSession& session)
+{
+    QString name = session.visitorName;
+    if (session.unreadCount > 0) {
+        name += QString("  (%1 条未读)").arg(session.unreadCount);
+    }
+    
+    return QString("%1\n最后消息: %2 · 共 %3 条")
+           .arg(name)
+           .arg(formatTime(session.lastMessageAt))
+           .arg(session.messageCount);
+}
+
 void StaffChatManager::updateSessionItemStyle(QListWidgetItem* item, const ChatSession& session)
 {
     if (session.status == 2) {
@@ -287,6 +368,13 @@ void StaffChatManager::onSessionSelectionChanged()
     m_currentSessionId = sessionId;
     ChatSession session = m_sessions.value(sessionId);
     
+    // 打开会话即读到最后一条，先在本地清掉未读数
+    if (session.unreadCount > 0) {
+        m_sessions[sessionId].unreadCount = 0;
+        session.unreadCount = 0;
+        currentItem->setText(sessionItemText(session));
+    }
+    
     // 更新聊天标题
     m_chatTitleLabel->setText(QString("与 %1 的对话").arg(session.visitorName));
     
@@ -303,39 +391,88 @@ void StaffChatManager::onSessionSelectionChanged()
         delete child;
     }
     m_messageLayout->addStretch();
+    m_displayedMessageIds.clear();
+    m_pendingStatusLabels.clear();
+    m_syncCursor = -1;
+    m_oldestMessageId = 0;
+    m_hasMoreHistory = false;
     
     // 加载聊天历史
     loadChatHistory(sessionId);
     
     // 标记消息为已读
-    m_dbManager->markSessionAsRead(sessionId, m_currentUser.id);
+    m_asyncDb->markSessionAsRead(sessionId, m_currentUser.id);
 }
 
 void StaffChatManager::loadChatHistory(int sessionId)
 {
-    QList<ChatMessage> messages = m_dbManager->getChatMessages(sessionId);
-    
-    for (const ChatMessage& message : messages) {
-        addMessage(message);
+    m_loadingHistory = true;
+    m_asyncDb->getChatMessages(sessionId, HISTORY_PAGE_SIZE, this, [this, sessionId](const QList<ChatMessage>& messages) {
+        // 加载期间已切换到其他会话
+        if (sessionId != m_currentSessionId) return;
+        
+        m_loadingHistory = false;
+        m_hasMoreHistory = messages.size() >= HISTORY_PAGE_SIZE;
+        if (!messages.isEmpty()) {
+            m_oldestMessageId = messages.first().id;
+        }
+        
+        for (const ChatMessage& message : messages) {
+            addMessage(message);
+        }
+        showPendingMessages(sessionId);
+        
+        // 最新一页是连续的，从它的最后一条开始增量同步，并补上加载期间到达的消息
+        m_syncCursor = messages.isEmpty() ? 0 : messages.last().id;
+        checkForNewMessages();
+    });
+}
+
+void StaffChatManager::onMessageScrollChanged(int value)
+{
+    if (value == m_messageScrollArea->verticalScrollBar()->minimum()) {
+        loadOlderMessages();
     }
 }
 
+void StaffChatManager::loadOlderMessages()
+{
+    if (m_currentSessionId <= 0 || m_loadingHistory || !m_hasMoreHistory || m_oldestMessageId <= 0) {
+        return;
+    }
+    
+    int sessionId = m_currentSessionId;
+    m_loadingHistory = true;
+    m_asyncDb->getChatMessagesBefore(sessionId, m_oldestMessageId, HISTORY_PAGE_SIZE, this,
+                                     [this, sessionId](const QList<ChatMessage>& messages) {
+        if (sessionId != m_currentSessionId) return;
+        
+        m_loadingHistory = false;
+        m_hasMoreHistory = messages.size() >= HISTORY_PAGE_SIZE;
+        if (messages.isEmpty()) return;
+        
+        m_oldestMessageId = messages.first().id;
+        prependMessages(messages);
+    });
+}
+
 void StaffChatManager::onAcceptSession(int sessionId)
 {
-    if (m_dbManager->updateChatSession(sessionId, m_currentUser.id)) {
-        // 刷新会话列表
-        refreshSessionList();
+    m_asyncDb->updateChatSession(sessionId, m_currentUser.id, this, [this, sessionId](bool ok) {
+        if (!ok) return;
         
-        // 自动选择这个会话
-        for (int i = 0; i < m_activeSessionsList->count(); ++i) {
-            QListWidgetItem* item = m_activeSessionsList->item(i);
-            if (m_itemToSessionId.value(item) == sessionId) {
-                m_activeSessionsList->setCurrentItem(item);
-                onSessionSelectionChanged();
-                break;
+        // 刷新会话列表，完成后自动选择这个会话
+        loadSessionList([this, sessionId]() {
+            for (int i = 0; i < m_activeSessionsList->count(); ++i) {
+                QListWidgetItem* item = m_activeSessionsList->item(i);
+                if (m_itemToSessionId.value(item) == sessionId) {
+                    m_activeSessionsList->setCurrentItem(item);
+                    onSessionSelectionChanged();
+                    break;
+                }
             }
-        }
-    }
+        });
+    });
 }
 
 void StaffChatManager::onCloseSession(int sessionId)
@@ -344,7 +481,13 @@ void StaffChatManager::onCloseSession(int sessionId)
                                    QMessageBox::Yes | QMessageBox::No);
     
     if (ret == QMessageBox::Yes) {
-        if (m_dbManager->closeChatSession(sessionId)) {
+        m_asyncDb->closeChatSession(sessionId, this, [this, sessionId](bool ok) {
+            if (!ok) return;
+            if (sessionId != m_currentSessionId) {
+                refreshSessionList();
+                return;
+            }
+            
             // 清空当前选择
             m_currentSessionId = -1;
             m_chatTitleLabel->setText("普通会话");
@@ -360,10 +503,15 @@ void StaffChatManager::onCloseSession(int sessionId)
                 delete child;
             }
             m_messageLayout->addStretch();
+            m_displayedMessageIds.clear();
+            m_pendingStatusLabels.clear();
+            m_syncCursor = -1;
+            m_oldestMessageId = 0;
+            m_hasMoreHistory = false;
             
             // 刷新会话列表
             refreshSessionList();
-        }
+        });
     }
 }
 
@@ -374,70 +522,56 @@ void StaffChatManager::onSendMessage()
         return;
     }
     
-    // 发送消息到数据库
-    int messageId = m_dbManager->sendMessage(m_currentSessionId, m_currentUser.id, content);
-    
-    if (messageId > 0) {
-        m_messageInput->clear();
-        
-        // 立即显示自己的消息
-        ChatMessage message;
-        message.id = messageId;
-        message.sessionId = m_currentSessionId;
-        message.senderId = m_currentUser.id;
-        message.senderName = m_currentUser.realName.isEmpty() ? m_currentUser.username : m_currentUser.realName;
-        message.senderRole = m_currentUser.role;
-        message.content = content;
-        message.timestamp = QDateTime::currentDateTime();
-        message.messageType = 0;
-        message.isRead = 1;
-        
-        addMessage(message);
-    }
+    // 先写入本地发件箱并立即显示，数据库被锁时由发件箱重试
+    m_messageInput->clear();
+    OutboxMessage message = MessageOutbox::instance()->enqueue(m_currentSessionId, m_currentUser.id, content);
+    addPendingMessage(message);
 }
 
 void StaffChatManager::onMessageReceived(const ChatMessage& message)
 {
-    // 如果是当前会话的消息且不是自己发送的，显示消息
+    // 本进程内发送的消息直接显示，会话列表由变更通知刷新
     if (message.sessionId == m_currentSessionId && message.senderId != m_currentUser.id) {
         addMessage(message);
-        m_dbManager->markMessageAsRead(message.id);
+        m_asyncDb->markReadUpTo(message.sessionId, m_currentUser.id, message.id);
     }
-    
-    // 刷新会话列表以更新最后消息时间
-    refreshSessionList();
-}
-
-void StaffChatManager::onSessionCreated(const ChatSession& session)
-{
-    // 新会话创建，刷新列表
-    refreshSessionList();
 }
 
-void StaffChatManager::onSessionUpdated(const ChatSession& session)
+void StaffChatManager::onSessionMessagesChanged(int sessionId)
 {
-    // 会话更新，刷新列表
-    refreshSessionList();
-}
-
-void StaffChatManager::checkForNewSessions()
-{
-    refreshSessionList();
+    // 其他会话的未读数由同一批变更的 sessionListChanged 统一刷新一次
+    if (sessionId == m_currentSessionId) {
+        checkForNewMessages();
+    }
 }
 
 void StaffChatManager::checkForNewMessages()
 {
-    if (m_currentSessionId <= 0) return;
-    
-    // 获取未读消息
-    QList<ChatMessage> unreadMessages = m_dbManager->getUnreadMessages(m_currentUser.id);
-    
-    for (const ChatMessage& message : unreadMessages) {
-        if (message.sessionId == m_currentSessionId && message.senderId != m_currentUser.id) {
+    // 游标为 -1 表示历史消息还没加载完，加载完成后游标才有意义
+    if (m_currentSessionId <= 0 || m_syncCursor < 0) return;
+    
+    // 只读取当前会话中游标之后的增量
+    int sessionId = m_currentSessionId;
+    m_asyncDb->getMessagesSince(sessionId, m_syncCursor, SYNC_BATCH_SIZE, this,
+                                [this, sessionId](const QList<ChatMessage>& messages) {
+        if (sessionId != m_currentSessionId || messages.isEmpty()) return;
+        for (const ChatMessage& message : messages) {
+            m_syncCursor = qMax(m_syncCursor, message.id);
+            if (m_pendingStatusLabels.contains(message.clientMsgId)) {
+                // 本窗口经发件箱发送、已以"发送中"显示的消息
+                onOutboxMessageSent(message.clientMsgId, message.id);
+                continue;
+            }
             addMessage(message);
-            m_dbManager->markMessageAsRead(message.id);
         }
-    }
+        // 整批只需前移一次水位
+        m_asyncDb->markReadUpTo(sessionId, m_currentUser.id, m_syncCursor);
+        
+        // 增量超过一批时继续读取
+        if (messages.size() >= SYNC_BATCH_SIZE) {
+            checkForNewMessages();
+        }
+    });
 }
 
 void StaffChatManager::refreshSessionList()
@@ -445,11 +579,9 @@ void StaffChatManager::refreshSessionList()
     // 保存当前选择
     int currentSelectedId = m_currentSessionId;
     
-    // 重新加载
-    loadSessionList();
-    
-    // 恢复选择
-    if (currentSelectedId > 0) {
+    // 重新加载，完成后恢复选择
+    loadSessionList([this, currentSelectedId]() {
+        if (currentSelectedId <= 0) return;
         for (int i = 0; i < m_activeSessionsList->count(); ++i) {
             QListWidgetItem* item = m_activeSessionsList->item(i);
             if (m_itemToSessionId.value(item) == currentSelectedId) {
@@ -457,11 +589,86 @@ void StaffChatManager::refreshSessionList()
                 break;
             }
         }
+    });
+}
+
+void StaffChatManager::runSearch()
+{
+    m_searchTimer->stop();
+    const int generation = ++m_searchGeneration;
+    
+    const QString text = m_searchInput->text().trimmed();
+    const bool currentOnly = m_searchCurrentOnly->isChecked();
+    if (text.isEmpty() || (currentOnly && m_currentSessionId <= 0)) {
+        m_searchResultsList->clear();
+        return;
+    }
+    
+    m_asyncDb->searchMessages(text, currentOnly ? m_currentSessionId : 0, SEARCH_RESULT_LIMIT, this,
+                              [this, generation](const QList<ChatSearchResult>& results) {
+        // 结果返回前又输入了新的关键词
+        if (generation != m_searchGeneration) return;
+        showSearchResults(results);
+    });
+}
+
+void StaffChatManager::showSearchResults(const QList<ChatSearchResult>& results)
+{
+    m_searchResultsList->clear();
+    
+    if (results.isEmpty()) {
+        QListWidgetItem* item = new QListWidgetItem("没有找到相关消息", m_searchResultsList);
+        item->setFlags(Qt::NoItemFlags);
+        return;
+    }
+    
+    for (const ChatSearchResult& result : results) {
+        const ChatMessage& message = result.message;
+        
+        QListWidgetItem* item = new QListWidgetItem(m_searchResultsList);
+        item->setData(Qt::UserRole, message.sessionId);
+        item->setToolTip(message.content);
+        
+        QLabel* label = new QLabel(QString("<span style=\"color:#888888;\">会话 #%1 · %2 · %3</span><br>%4")
+                                       .arg(message.sessionId)
+                                       .arg(message.senderName.toHtmlEscaped(),
+                                            formatTime(message.timestamp),
+                                            result.snippetHtml));
+        label->setTextFormat(Qt::RichText);
+        label->setWordWrap(true);
+        label->setContentsMargins(6, 4, 6, 4);
+        item->setSizeHint(label->sizeHint());
+        m_searchResultsList->setItemWidget(item, label);
+    }
+}
+
+void StaffChatManager::onSearchResultActivated(QListWidgetItem* item)
+{
+    const int sessionId = item->data(Qt::UserRole).toInt();
+    if (sessionId <= 0) return;
+    
+    // 进行中的会话直接切换过去
+    for (auto it = m_itemToSessionId.constBegin(); it != m_itemToSessionId.constEnd(); ++it) {
+        if (it.value() == sessionId && m_activeSessionsList->row(it.key()) >= 0) {
+            m_activeSessionsList->setCurrentItem(it.key());
+            onSessionSelectionChanged();
+            return;
+        }
     }
+    
+    QMessageBox::information(this, "聊天记录",
+                             QString("会话 #%1 已结束或不在当前对话列表中。\n\n%2")
+                                 .arg(sessionId).arg(item->toolTip()));
 }
 
 void StaffChatManager::addMessage(const ChatMessage& message)
 {
+    // 同一条消息可能同时来自进程内信号和变更通知
+    if (message.id > 0) {
+        if (m_displayedMessageIds.contains(message.id)) return;
+        m_displayedMessageIds.insert(message.id);
+    }
+    
     QWidget* messageBubble = createMessageBubble(message);
     
     // 移除stretch，添加消息，再添加stretch
@@ -473,7 +680,109 @@ void StaffChatManager::addMessage(const ChatMessage& message)
     QTimer::singleShot(50, this, &StaffChatManager::scrollToBottom);
 }
 
-QWidget* StaffChatManager::createMessageBubble(const ChatMessage& message)
+void StaffChatManager::addPendingMessage(const OutboxMessage& pending)
+{
+    if (pending.sessionId != m_currentSessionId || m_pendingStatusLabels.contains(pending.clientMsgId)) {
+        return;
+    }
+    
+    ChatMessage message;
+    message.id = 0;
+    message.sessionId = pending.sessionId;
+    message.senderId = pending.senderId;
+    message.senderName = m_currentUser.realName.isEmpty() ? m_currentUser.username : m_currentUser.realName;
+    message.senderRole = m_currentUser.role;
+    message.content = pending.content;
+    message.timestamp = pending.createdAt;
+    message.messageType = pending.messageType;
+    message.isRead = 1;
+    
+    QLabel* statusLabel = nullptr;
+    QWidget* messageBubble = createMessageBubble(message, &statusLabel);
+    m_pendingStatusLabels.insert(pending.clientMsgId, statusLabel);
+    
+    // 最终失败时状态后附"重新发送"链接
+    const QString clientMsgId = pending.clientMsgId;
+    connect(statusLabel, &QLabel::linkActivated, this, [this, clientMsgId]() {
+        QPointer<QLabel> label = m_pendingStatusLabels.value(clientMsgId);
+        if (!label) return;
+        label->setText(MessageOutbox::instance()->resend(clientMsgId) ? "发送中..." : "发送失败");
+    });
+    if (pending.failed) {
+        onOutboxMessageFailed(clientMsgId);
+    } else {
+        statusLabel->setText(pending.attempts > 0
+                             ? QString("发送失败，正在重试（第 %1 次）").arg(pending.attempts)
+                             : QString("发送中..."));
+    }
+    
+    QLayoutItem* stretch = m_messageLayout->takeAt(m_messageLayout->count() - 1);
+    m_messageLayout->addWidget(messageBubble);
+    m_messageLayout->addItem(stretch);
+    
+    QTimer::singleShot(50, this, &StaffChatManager::scrollToBottom);
+}
+
+void StaffChatManager::showPendingMessages(int sessionId)
+{
+    for (const OutboxMessage& pending : MessageOutbox::instance()->pendingMessages(sessionId)) {
+        if (pending.senderId == m_currentUser.id) {
+            addPendingMessage(pending);
+        }
+    }
+}
+
+void StaffChatManager::onOutboxMessageSent(const QString& clientMsgId, int messageId)
+{
+    QPointer<QLabel> statusLabel = m_pendingStatusLabels.take(clientMsgId);
+    if (!statusLabel) return;
+    
+    // 气泡已经显示，之后从数据库读到同一条消息时跳过
+    m_displayedMessageIds.insert(messageId);
+    statusLabel->setText("已发送");
+}
+
+void StaffChatManager::onOutboxMessageRetrying(const QString& clientMsgId, int attempts, qint64 retryInMs)
+{
+    QPointer<QLabel> statusLabel = m_pendingStatusLabels.value(clientMsgId);
+    if (!statusLabel) return;
+    
+    statusLabel->setText(QString("发送失败，%1 秒后重试（第 %2 次）")
+                         .arg(qMax<qint64>(1, (retryInMs + 999) / 1000))
+                         .arg(attempts));
+}
+
+void StaffChatManager::onOutboxMessageFailed(const QString& clientMsgId)
+{
+    QPointer<QLabel> statusLabel = m_pendingStatusLabels.value(clientMsgId);
+    if (!statusLabel) return;
+    
+    // 消息仍在发件箱中时保留状态标签，重发成功后继续更新
+    statusLabel->setText("发送失败 <a href=\"resend\" style=\"color: inherit;\">重新发送</a>");
+}
+
+void StaffChatManager::prependMessages(const QList<ChatMessage>& messages)
+{
+    QScrollBar* scrollBar = m_messageScrollArea->verticalScrollBar();
+    int distanceFromBottom = scrollBar->maximum() - scrollBar->value();
+    
+    int index = 0;
+    for (const ChatMessage& message : messages) {
+        if (message.id > 0) {
+            if (m_displayedMessageIds.contains(message.id)) continue;
+            m_displayedMessageIds.insert(message.id);
+        }
+        m_messageLayout->insertWidget(index++, createMessageBubble(message));
+    }
+    
+    // 保持当前可见的消息不动，而不是跳到新插入内容的顶部
+    QTimer::singleShot(0, this, [this, distanceFromBottom]() {
+        QScrollBar* scrollBar = m_messageScrollArea->verticalScrollBar();
+        scrollBar->setValue(scrollBar->maximum() - distanceFromBottom);
+    });
+}
+
+QWidget* StaffChatManager::createMessageBubble(const ChatMessage& message, QLabel** statusLabel)
 {
     QWidget* bubble = new QWidget;
     QHBoxLayout* layout = new QHBoxLayout(bubble);
@@ -514,6 +823,13 @@ QWidget* StaffChatManager::createMessageBubble(const ChatMessage& message)
         contentLabel->setStyleSheet("color: white; font-size: 14px;");
         headerLabel->setStyleSheet("font-size: 11px; color: rgba(255,255,255,0.8);");
         
+        if (statusLabel) {
+            *statusLabel = new QLabel;
+            (*statusLabel)->setAlignment(Qt::AlignRight);
+            (*statusLabel)->setStyleSheet("font-size: 10px; color: rgba(255,255,255,0.7);");
+            frameLayout->addWidget(*statusLabel);
+        }
+        
     } else if (message.messageType == 1) {
         // 系统消息 - 居中，灰色
         layout->addStretch();
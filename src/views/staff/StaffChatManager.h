@@ -11,12 +11,21 @@
 #include <QLabel>
 #include <QTextEdit>
 #include <QPushButton>
+#include <QLineEdit>
+#include <QCheckBox>
 #include <QFrame>
 #include <QTimer>
 #include <QGroupBox>
 #include <QDateTime>
+#include <QSet>
+#include <QHash>
+#include <QPointer>
+#include <functional>
 #include "../../core/DatabaseManager.h"
 
+class AsyncDatabaseManager;
+struct OutboxMessage;
+
 class StaffChatManager : public QWidget
 {
     Q_OBJECT
@@ -36,23 +45,36 @@ private slots:
     void onAcceptSession(int sessionId);
     void onCloseSession(int sessionId);
     void onMessageReceived(const ChatMessage& message);
-    void onSessionCreated(const ChatSession& session);
-    void onSessionUpdated(const ChatSession& session);
-    void checkForNewSessions();
+    void onSessionMessagesChanged(int sessionId);
     void checkForNewMessages();
+    void onOutboxMessageSent(const QString& clientMsgId, int messageId);
+    void onOutboxMessageRetrying(const QString& clientMsgId, int attempts, qint64 retryInMs);
+    void onOutboxMessageFailed(const QString& clientMsgId);
     void refreshSessionList();
+    void onMessageScrollChanged(int value);
+    void runSearch();
+    void onSearchResultActivated(QListWidgetItem* item);
 
 private:
     void setupUI();
     void setupSessionList();
     void setupChatArea();
     void setupWaitingList();
-    void loadSessionList();
+    void setupSearchPanel();
+    void showSearchResults(const QList<ChatSearchResult>& results);
+    void loadSessionList(std::function<void()> onLoaded = nullptr);
+    void populateSessionList(const QList<ChatSession>& activeSessions);
     void loadChatHistory(int sessionId);
+    void loadOlderMessages();
     void addMessage(const ChatMessage& message);
+    // 发件箱中尚未写入数据库的消息，带发送状态
+    void addPendingMessage(const OutboxMessage& message);
+    void showPendingMessages(int sessionId);
+    void prependMessages(const QList<ChatMessage>& messages);
     void scrollToBottom();
-    QWidget* createMessageBubble(const ChatMessage& message);
+    QWidget* createMessageBubble(const ChatMessage& message, QLabel** statusLabel = nullptr);
     QListWidgetItem* createSessionItem(const ChatSession& session);
+    QString sessionItemText(const ChatSession& session);
     QString formatTime(const QDateTime& time);
     void updateSessionItemStyle(QListWidgetItem* item, const ChatSession& session);
 
@@ -69,6 +91,14 @@ private:
     QListWidget* m_waitingSessionsList;
     QLabel* m_statsLabel;
     
+    // 聊天记录检索
+    QGroupBox* m_searchGroup;
+    QLineEdit* m_searchInput;
+    QCheckBox* m_searchCurrentOnly;
+    QListWidget* m_searchResultsList;
+    QTimer* m_searchTimer;       // 输入停顿后再检索
+    int m_searchGeneration;      // 丢弃过期的检索结果
+    
     // 右侧聊天区域
     QWidget* m_rightPanel;
     QVBoxLayout* m_rightLayout;
@@ -84,8 +114,15 @@ private:
     UserInfo m_currentUser;
     int m_currentSessionId;
     DatabaseManager* m_dbManager;
-    QTimer* m_sessionCheckTimer;
-    QTimer* m_messageCheckTimer;
+    AsyncDatabaseManager* m_asyncDb;
+    QSet<int> m_displayedMessageIds;
+    QHash<QString, QPointer<QLabel>> m_pendingStatusLabels; // clientMsgId -> 发送状态
+    int m_syncCursor; // 当前会话已同步到的最大消息 ID，-1 表示尚未加载
+    
+    // 向上翻页：已显示的最早一条消息作为游标
+    int m_oldestMessageId;
+    bool m_hasMoreHistory;
+    bool m_loadingHistory;
     
     // 会话映射
     QMap<int, ChatSession> m_sessions;
@@ -1,4 +1,6 @@
 #include "StatsWidget.h"
+#include "../../core/StorageManager.h"
+#include "../../core/EpochTime.h"
 #include <QTableWidgetItem>
 #include <QHeaderView>
 #include <QMessageBox>
@@ -42,9 +44,7 @@ StatsWidget::StatsWidget(QWidget *parent)
 
 StatsWidget::~StatsWidget()
 {
-    if (m_database.isOpen()) {
-        m_database.close();
-    }
+    // 连接由 StorageManager 持有，多个统计窗口共享
 }
 
 void StatsWidget::setupUI()
@@ -266,28 +266,14 @@ void StatsWidget::setupExportArea()
 
 void StatsWidget::initDatabase()
 {
-    // 初始化数据库连接
-    QString dbPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    QDir().mkpath(dbPath);
-    
-    m_database = QSqlDatabase::addDatabase("QSQLITE", "stats_db");
-    m_database.setDatabaseName(dbPath + "/question_stats.db");
+    // question_stats.db 的共享连接，表结构由 StorageManager 在首次打开时创建
+    m_database = StorageManager::instance()->connection(StorageManager::StatsStore);
     
-    if (!m_database.open()) {
+    if (!m_database.isOpen()) {
         qWarning() << "Failed to open database:" << m_database.lastError().text();
         return;
     }
     
-    // 创建表结构
-    QSqlQuery query(m_database);
-    query.exec("CREATE TABLE IF NOT EXISTS question_records ("
-              "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-              "user_id TEXT,"
-              "question TEXT,"
-              "keywords TEXT,"
-              "category TEXT,"
-              "timestamp TEXT)");
-    
     // 插入模拟数据
     loadMockData();
 }
@@ -338,7 +324,7 @@ void StatsWidget::loadMockData()
         query.bindValue(1, question);
         query.bindValue(2, extractKeywords(question).join(","));
         query.bindValue(3, category);
-        // query.bindValue(4, timestamp.toString(Qt::ISODate));
+        // query.bindValue(4, EpochTime::toMs(timestamp));
         query.exec();
     }
 }
@@ -379,8 +365,8 @@ void StatsWidget::loadQuestionStats()
                  "ORDER BY count DESC "
                  "LIMIT ?");
     
-    query.bindValue(0, startTime.toString(Qt::ISODate));
-    query.bindValue(1, endTime.toString(Qt::ISODate));
+    query.bindValue(0, EpochTime::toMs(startTime));
+    query.bindValue(1, EpochTime::toMs(endTime));
     query.bindValue(2, MAX_DISPLAY_ROWS);
     
     m_progressBar->setValue(40);
@@ -390,8 +376,8 @@ void StatsWidget::loadQuestionStats()
             QuestionStats stats;
             stats.question = query.value("question").toString();
             stats.count = query.value("count").toInt();
-            stats.firstOccurrence = QDateTime::fromString(query.value("first_time").toString(), Qt::ISODate);
-            stats.lastOccurrence = QDateTime::fromString(query.value("last_time").toString(), Qt::ISODate);
+            stats.firstOccurrence = EpochTime::fromColumn(query.value("first_time"));
+            stats.lastOccurrence = EpochTime::fromColumn(query.value("last_time"));
             stats.keywords = extractKeywords(stats.question);
             
             m_questionStats.append(stats);
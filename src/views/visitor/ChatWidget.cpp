@@ -1,4 +1,6 @@
 #include "ChatWidget.h"
+#include "../../core/StorageManager.h"
+#include "../../core/EpochTime.h"
 #include <QGroupBox>
 #include <QScrollBar>
 #include <QApplication>
@@ -41,6 +43,7 @@ ChatWidget::ChatWidget(QWidget *parent)
     , m_messageCount(0)
     , m_dbManager(nullptr)
     , m_aiApiClient(new AIApiClient(this))
+    , m_conversationMemory(new ConversationMemory(this))
     , m_networkManager(nullptr)
     , m_audioSource(nullptr)
     , m_audioBuffer(nullptr)
@@ -72,16 +75,23 @@ ChatWidget::ChatWidget(QWidget *parent)
             this, &ChatWidget::onAIChatResponse);
     connect(m_aiApiClient, &AIApiClient::apiError,
             this, &ChatWidget::onAIApiError);
-    connect(m_aiApiClient, &AIApiClient::requestStarted, [this]() {
+    connect(m_aiApiClient, &AIApiClient::chatChunkReceived,
+            this, &ChatWidget::onAIChatChunk);
+    // 请求按ID对应，分析进行中访客仍可继续提问，新问题在客户端排队
+    connect(m_aiApiClient, &AIApiClient::requestStarted, this, [this](int) {
         m_isAITyping = true;
         m_statusLabel->setText("智能HR助手正在分析中...");
-        m_btnSend->setEnabled(false);
-    });
-    connect(m_aiApiClient, &AIApiClient::requestFinished, [this]() {
-        m_isAITyping = false;
-        m_statusLabel->setText("智能HR助手");
-        m_btnSend->setEnabled(true);
     });
+    auto onRequestDone = [this](int requestId) {
+        m_aiRequestQuestions.remove(requestId);
+        m_streamingBubbles.remove(requestId);
+        // 取消的请求没有回答，挂起的问题不再写入记忆
+        m_conversationMemory->dropQuestion(m_currentSessionId, requestId);
+        m_isAITyping = !m_aiRequestQuestions.isEmpty();
+        m_statusLabel->setText(m_isAITyping ? "智能HR助手正在分析中..." : "智能HR助手");
+    };
+    connect(m_aiApiClient, &AIApiClient::requestFinished, this, onRequestDone);
+    connect(m_aiApiClient, &AIApiClient::requestCancelled, this, onRequestDone);
 
     // 发送欢迎消息
     QTimer::singleShot(500, [this]() {
@@ -96,9 +106,9 @@ ChatWidget::ChatWidget(QWidget *parent)
 
 ChatWidget::~ChatWidget()
 {
+    // 连接由 StorageManager 持有，这里只保存记录
     if (m_database.isOpen()) {
         saveChatHistory();
-        m_database.close();
     }
     if (m_audioSource) {
         m_audioSource->stop();
@@ -791,7 +801,7 @@ void ChatWidget::addTransferOption()
 void ChatWidget::onSendMessage()
 {
     QString text = m_messageInput->toPlainText().trimmed();
-    if (text.isEmpty() || m_isAITyping) {
+    if (text.isEmpty()) {
         return;
     }
     
@@ -821,20 +831,13 @@ void ChatWidget::onSendMessage()
         return;
     }
     
-    // 构建对话历史
-    QString conversationHistory;
-    int recentMsgCount = qMin(5, m_chatHistory.size()); // 只取最近5条消息作为上下文
-    for (int i = m_chatHistory.size() - recentMsgCount; i < m_chatHistory.size(); i++) {
-        const AIMessage& msg = m_chatHistory[i];
-        if (msg.type == MessageType::User) {
-            conversationHistory += "访客：" + msg.content + "\n";
-        } else if (msg.type == MessageType::Robot) {
-            conversationHistory += "AI助手：" + msg.content + "\n";
-        }
-    }
+    // 对话历史：摘要 + 最近几轮（含仍在等待回答的提问），合计不超过预算；本轮问题单独作为提问发送
+    QString conversationHistory = m_conversationMemory->context(m_currentSessionId);
     
-    // 使用真实的AI API进行HR
-    m_aiApiClient->sendChatRequest(text, conversationHistory);
+    // 使用真实的AI API进行HR；问题挂起到回答到达，问答成对写入记忆
+    int requestId = m_aiApiClient->sendChatRequest(text, conversationHistory);
+    m_aiRequestQuestions.insert(requestId, text);
+    m_conversationMemory->beginQuestion(m_currentSessionId, requestId, text);
 }
 // 添加显示图片的函数
 void ChatWidget::addImageMessage(const QString& imagePath, const QString& altText)
@@ -1022,8 +1025,13 @@ QString ChatWidget::generateAIResponse(const QString& userInput)
 // 实现其他必要的方法
 void ChatWidget::addMessage(const AIMessage& message)
 {
-    m_chatHistory.append(message);
+    recordMessage(message);
     displayMessage(message);
+}
+
+void ChatWidget::recordMessage(const AIMessage& message)
+{
+    m_chatHistory.append(message);
     m_messageCount++;
     
     // 自动保存每10条消息
@@ -1032,7 +1040,7 @@ void ChatWidget::addMessage(const AIMessage& message)
     }
 }
 
-void ChatWidget::displayMessage(const AIMessage& message)
+QLabel* ChatWidget::displayMessage(const AIMessage& message)
 {
     QWidget* messageWidget = new QWidget;
     QHBoxLayout* messageLayout = new QHBoxLayout(messageWidget);
@@ -1127,6 +1135,7 @@ void ChatWidget::displayMessage(const AIMessage& message)
     
     // 滚动到底部
     QTimer::singleShot(100, this, &ChatWidget::scrollToBottom);
+    return bubbleLabel;
 }
 
 void ChatWidget::scrollToBottom()
@@ -1234,7 +1243,7 @@ void ChatWidget::clearInteractionComponents()
 void ChatWidget::onInputTextChanged()
 {
     bool hasText = !m_messageInput->toPlainText().trimmed().isEmpty();
-    m_btnSend->setEnabled(hasText && !m_isAITyping);
+    m_btnSend->setEnabled(hasText);
 }
 
 void ChatWidget::onActionButtonClicked()
@@ -1267,8 +1276,12 @@ void ChatWidget::onClearChatClicked()
             delete item;
         }
         
+        // 未完成的AI回复不再显示到清空后的会话中
+        m_aiApiClient->cancelAllRequests();
+
         // 清空历史记录
         m_chatHistory.clear();
+        m_conversationMemory->clearSession(m_currentSessionId);
         m_messageCount = 0;
         
         // 重新发送欢迎消息
@@ -1296,21 +1309,8 @@ void ChatWidget::onSettingsClicked()
 // 数据库相关方法的简单实现
 void ChatWidget::initDatabase()
 {
-    QString dbPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    QDir().mkpath(dbPath);
-    
-    m_database = QSqlDatabase::addDatabase("QSQLITE", "ai_chat_db");
-    m_database.setDatabaseName(dbPath + "/ai_chat_history.db");
-    
-    if (m_database.open()) {
-        QSqlQuery query(m_database);
-        query.exec("CREATE TABLE IF NOT EXISTS ai_chat_messages ("
-                  "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-                  "session_id TEXT,"
-                  "content TEXT,"
-                  "message_type INTEGER,"
-                  "timestamp TEXT)");
-    }
+    // ai_chat_history.db 的共享连接，表结构由 StorageManager 在首次打开时创建
+    m_database = StorageManager::instance()->connection(StorageManager::AIChatStore);
 }
 
 void ChatWidget::saveChatHistory()
@@ -1325,7 +1325,7 @@ void ChatWidget::saveChatHistory()
         query.bindValue(0, msg.sessionId);
         query.bindValue(1, msg.content);
         query.bindValue(2, static_cast<int>(msg.type));
-        query.bindValue(3, msg.timestamp.toString(Qt::ISODate));
+        query.bindValue(3, EpochTime::toMs(msg.timestamp));
         query.exec();
     }
 }
@@ -1358,7 +1358,15 @@ void ChatWidget::onAIChatResponse(const AIAnalysisResult& result)
     aiMsg.timestamp = QDateTime::currentDateTime();
     aiMsg.sessionId = m_currentSessionId;
     
-    addMessage(aiMsg);
+    // 流式回复已经显示在气泡中，只需补全内容并写入历史
+    QPointer<QLabel> liveBubble = m_streamingBubbles.value(result.requestId).label;
+    if (liveBubble) {
+        liveBubble->setText(result.aiResponse);
+        recordMessage(aiMsg);
+    } else {
+        addMessage(aiMsg);
+    }
+    m_conversationMemory->finishQuestion(m_currentSessionId, result.requestId, result.aiResponse);
     
     // 根据诊断结果添加交互组件
     QStringList actionButtons;
@@ -1383,18 +1391,53 @@ void ChatWidget::onAIChatResponse(const AIAnalysisResult& result)
              << "需要人工:" << result.needsHumanConsult;
 }
 
-void ChatWidget::onAIApiError(const QString& error)
+void ChatWidget::onAIChatChunk(int requestId, const QString& delta)
+{
+    // 已取消或已结束的请求不再显示
+    if (!m_aiRequestQuestions.contains(requestId)) {
+        return;
+    }
+
+    StreamingBubble& bubble = m_streamingBubbles[requestId];
+    bubble.content += delta;
+    if (!bubble.label) {
+        // 首个分片：创建气泡，后续分片直接追加
+        AIMessage liveMsg;
+        liveMsg.content = bubble.content;
+        liveMsg.type = MessageType::Robot;
+        liveMsg.timestamp = QDateTime::currentDateTime();
+        liveMsg.sessionId = m_currentSessionId;
+        bubble.label = displayMessage(liveMsg);
+        m_statusLabel->setText("智能HR助手正在输入...");
+    } else {
+        bubble.label->setText(bubble.content);
+        QTimer::singleShot(0, this, &ChatWidget::scrollToBottom);
+    }
+}
+
+void ChatWidget::onAIApiError(int requestId, const QString& error)
 {
-    qDebug() << "AI API错误:" << error;
+    qDebug() << "AI API错误:" << requestId << error;
     
-    // 显示错误消息并回退到本地逻辑
+    // 显示错误消息并回退到本地逻辑，按出错请求对应的问题生成建议
+    const QString question = m_aiRequestQuestions.value(requestId, m_currentContext);
     AIMessage errorMsg;
-    errorMsg.content = "抱歉，AI服务暂时不可用，为您提供基础HR建议：\n\n" + generateAIResponse(m_currentContext);
+    errorMsg.content = "抱歉，AI服务暂时不可用，为您提供基础HR建议：\n\n" + generateAIResponse(question);
     errorMsg.type = MessageType::Robot;
     errorMsg.timestamp = QDateTime::currentDateTime();
     errorMsg.sessionId = m_currentSessionId;
     
-    addMessage(errorMsg);
+    // 访客的问题仍记入记忆，本地备用回答不计入
+    m_conversationMemory->finishQuestion(m_currentSessionId, requestId, QString());
+    
+    // 流式回复中途失败时，用备用回答替换已显示的半截内容，不再另起一个气泡
+    QPointer<QLabel> liveBubble = m_streamingBubbles.take(requestId).label;
+    if (liveBubble) {
+        liveBubble->setText(errorMsg.content);
+        recordMessage(errorMsg);
+    } else {
+        addMessage(errorMsg);
+    }
     
     // 添加基础交互按钮
     addActionButtons({"🔍 品质自查", "📅 预约面试", "👤 转人工客服"});
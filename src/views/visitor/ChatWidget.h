@@ -18,8 +18,10 @@
 #include <QSqlQuery>
 #include <QButtonGroup>
 #include <QGroupBox>
+#include <QPointer>
 #include "../../core/DatabaseManager.h"
 #include "../../core/AIApiClient.h"
+#include "../../core/ConversationMemory.h"
 #include <QAudioInput>
 #include <QMediaDevices>
 #include <QAudioDevice>
@@ -82,7 +84,8 @@ private slots:
     void onAIResponseReady();
     void simulateTyping();
     void onAIChatResponse(const AIAnalysisResult& result);
-    void onAIApiError(const QString& error);
+    void onAIApiError(int requestId, const QString& error);
+    void onAIChatChunk(int requestId, const QString& delta);
     
     // 交互按钮相关
     void onActionButtonClicked();
@@ -104,7 +107,8 @@ private:
      void displayImageMessage(const QString& imagePath, const QString& caption = "");
     // 消息处理
     void addMessage(const AIMessage& message);
-    void displayMessage(const AIMessage& message);
+    void recordMessage(const AIMessage& message);     // 只写入历史，不显示
+    QLabel* displayMessage(const AIMessage& message); // 返回消息气泡
     void scrollToBottom();
     
     // AIHR逻辑
@@ -198,6 +202,14 @@ private:
     QString m_pendingResponse;   // 待发送的AI响应
     bool m_isAITyping;          // AI是否正在输入
     AIApiClient* m_aiApiClient;  // AI API客户端
+    ConversationMemory* m_conversationMemory;  // 放进提示词的对话历史
+    QHash<int, QString> m_aiRequestQuestions;  // 未完成的AI请求ID -> 访客问题
+    // 流式回复中的气泡：请求ID -> 气泡及已收到的内容
+    struct StreamingBubble {
+        QPointer<QLabel> label;
+        QString content;
+    };
+    QHash<int, StreamingBubble> m_streamingBubbles;
     
     // 数据存储
     QList<AIMessage> m_chatHistory;
@@ -1,10 +1,17 @@
 #include "RealChatWidget.h"
 #include "../common/UIStyleManager.h"
+#include "../../core/AsyncDatabaseManager.h"
+#include "../../core/ChatChangeNotifier.h"
+#include "../../core/MessageOutbox.h"
 #include <QMessageBox>
 #include <QScrollBar>
 #include <QApplication>
 #include <QKeyEvent>
 
+namespace {
+const int SYNC_BATCH_SIZE = 200;
+}
+
 RealChatWidget::RealChatWidget(QWidget *parent)
     : QWidget(parent)
     , m_mainLayout(nullptr)
@@ -17,8 +24,9 @@ RealChatWidget::RealChatWidget(QWidget *parent)
     , m_startChatButton(nullptr)
     , m_currentSessionId(-1)
     , m_dbManager(DatabaseManager::instance())
-    , m_messageCheckTimer(new QTimer(this))
+    , m_asyncDb(AsyncDatabaseManager::instance())
     , m_typingTimer(new QTimer(this))
+    , m_syncCursor(-1)
     , m_isConnected(false)
     , m_isTyping(false)
 {
@@ -32,9 +40,24 @@ RealChatWidget::RealChatWidget(QWidget *parent)
     connect(m_dbManager, &DatabaseManager::sessionUpdated, 
             this, &RealChatWidget::onSessionUpdated);
     
-    // 定时检查新消息
-    connect(m_messageCheckTimer, &QTimer::timeout, this, &RealChatWidget::checkForNewMessages);
-    m_messageCheckTimer->start(2000); // 每2秒检查一次
+    // 变更通知：只有本会话变化时才查询数据库
+    ChatChangeNotifier* notifier = ChatChangeNotifier::instance();
+    connect(notifier, &ChatChangeNotifier::messagesChanged, this, [this](int sessionId) {
+        if (sessionId == m_currentSessionId) {
+            checkForNewMessages();
+        }
+    });
+    connect(notifier, &ChatChangeNotifier::sessionChanged, this, [this](int sessionId) {
+        if (sessionId == m_currentSessionId) {
+            updateConnectionStatus();
+        }
+    });
+    
+    // 发件箱：消息写入数据库或重试时更新气泡上的发送状态
+    MessageOutbox* outbox = MessageOutbox::instance();
+    connect(outbox, &MessageOutbox::messageSent, this, &RealChatWidget::onOutboxMessageSent);
+    connect(outbox, &MessageOutbox::messageRetrying, this, &RealChatWidget::onOutboxMessageRetrying);
+    connect(outbox, &MessageOutbox::messageFailed, this, &RealChatWidget::onOutboxMessageFailed);
     
     // 用户输入计时器
     connect(m_typingTimer, &QTimer::timeout, this, &RealChatWidget::onUserInput);
@@ -44,7 +67,7 @@ RealChatWidget::RealChatWidget(QWidget *parent)
 RealChatWidget::~RealChatWidget()
 {
     if (m_currentUser.id > 0) {
-        m_dbManager->updateUserOnlineStatus(m_currentUser.id, false);
+        m_asyncDb->updateUserOnlineStatus(m_currentUser.id, false);
     }
 }
 
@@ -147,9 +170,10 @@ void RealChatWidget::setCurrentUser(const UserInfo& user)
     m_currentUser = user;
     
     // 更新在线状态
-    if (m_dbManager) {
-        m_dbManager->updateUserOnlineStatus(user.id, true);
-    }
+    m_asyncDb->updateUserOnlineStatus(user.id, true);
+    
+    // 继续投递上次未写入数据库的消息
+    MessageOutbox::instance()->resume(user.id);
     
     // 加载聊天历史
     loadChatHistory();
@@ -180,7 +204,18 @@ void RealChatWidget::startNewChat()
     }
     
     // 创建新的聊天会话
-    m_currentSessionId = m_dbManager->createChatSession(m_currentUser.id);
+    m_startChatButton->setEnabled(false);
+    m_asyncDb->createChatSession(m_currentUser.id, 0, this, [this](int sessionId) {
+        m_startChatButton->setEnabled(true);
+        onChatSessionStarted(sessionId);
+    });
+}
+
+void RealChatWidget::onChatSessionStarted(int sessionId)
+{
+    m_currentSessionId = sessionId;
+    // 新会话没有历史消息，从头同步
+    m_syncCursor = 0;
     
     if (m_currentSessionId > 0) {
         m_isConnected = true;
@@ -214,27 +249,11 @@ void RealChatWidget::onSendMessage()
         return;
     }
     
-    // 发送消息到数据库
-    int messageId = m_dbManager->sendMessage(m_currentSessionId, m_currentUser.id, content);
-    
-    if (messageId > 0) {
-        m_messageInput->clear();
-        m_isTyping = false;
-        
-        // 立即显示自己的消息
-        ChatMessage message;
-        message.id = messageId;
-        message.sessionId = m_currentSessionId;
-        message.senderId = m_currentUser.id;
-        message.senderName = m_currentUser.realName.isEmpty() ? m_currentUser.username : m_currentUser.realName;
-        message.senderRole = m_currentUser.role;
-        message.content = content;
-        message.timestamp = QDateTime::currentDateTime();
-        message.messageType = 0;
-        message.isRead = 1;
-        
-        addMessage(message);
-    }
+    // 先写入本地发件箱并立即显示，数据库被锁时由发件箱重试
+    m_messageInput->clear();
+    m_isTyping = false;
+    OutboxMessage message = MessageOutbox::instance()->enqueue(m_currentSessionId, m_currentUser.id, content);
+    addPendingMessage(message);
 }
 
 void RealChatWidget::onMessageReceived(const ChatMessage& message)
@@ -243,8 +262,8 @@ void RealChatWidget::onMessageReceived(const ChatMessage& message)
     if (message.sessionId == m_currentSessionId && message.senderId != m_currentUser.id) {
         addMessage(message);
         
-        // 标记消息为已读
-        m_dbManager->markMessageAsRead(message.id);
+        // 已读水位前移到这条消息
+        m_asyncDb->markReadUpTo(message.sessionId, m_currentUser.id, message.id);
     }
 }
 
@@ -264,20 +283,31 @@ void RealChatWidget::onSessionUpdated(const ChatSession& session)
 
 void RealChatWidget::checkForNewMessages()
 {
-    if (m_currentSessionId <= 0) return;
-    
-    // 获取未读消息
-    QList<ChatMessage> unreadMessages = m_dbManager->getUnreadMessages(m_currentUser.id);
-    
-    for (const ChatMessage& message : unreadMessages) {
-        if (message.sessionId == m_currentSessionId && message.senderId != m_currentUser.id) {
+    // 游标为 -1 表示历史消息还没加载完，加载完成后游标才有意义
+    if (m_currentSessionId <= 0 || m_syncCursor < 0) return;
+    
+    // 只读取当前会话中游标之后的增量
+    int sessionId = m_currentSessionId;
+    m_asyncDb->getMessagesSince(sessionId, m_syncCursor, SYNC_BATCH_SIZE, this,
+                                [this, sessionId](const QList<ChatMessage>& messages) {
+        if (sessionId != m_currentSessionId || messages.isEmpty()) return;
+        for (const ChatMessage& message : messages) {
+            m_syncCursor = qMax(m_syncCursor, message.id);
+            if (m_pendingStatusLabels.contains(message.clientMsgId)) {
+                // 本窗口经发件箱发送、已以"发送中"显示的消息
+                onOutboxMessageSent(message.clientMsgId, message.id);
+                continue;
+            }
             addMessage(message);
-            m_dbManager->markMessageAsRead(message.id);
         }
-    }
-    
-    // 同时检查会话状态是否有变化
-    updateConnectionStatus();
+        // 整批只需前移一次水位
+        m_asyncDb->markReadUpTo(sessionId, m_currentUser.id, m_syncCursor);
+        
+        // 增量超过一批时继续读取
+        if (messages.size() >= SYNC_BATCH_SIZE) {
+            checkForNewMessages();
+        }
+    });
 }
 
 void RealChatWidget::onUserInput()
@@ -287,6 +317,12 @@ void RealChatWidget::onUserInput()
 
 void RealChatWidget::addMessage(const ChatMessage& message)
 {
+    // 同一条消息可能同时来自进程内信号和变更通知
+    if (message.id > 0) {
+        if (m_displayedMessageIds.contains(message.id)) return;
+        m_displayedMessageIds.insert(message.id);
+    }
+    
     QWidget* messageBubble = createMessageBubble(message);
     
     // 移除stretch，添加消息，再添加stretch
@@ -305,7 +341,88 @@ void RealChatWidget::addMessage(const ChatMessage& message)
     }
 }
 
-QWidget* RealChatWidget::createMessageBubble(const ChatMessage& message)
+void RealChatWidget::addPendingMessage(const OutboxMessage& pending)
+{
+    if (pending.sessionId != m_currentSessionId || m_pendingStatusLabels.contains(pending.clientMsgId)) {
+        return;
+    }
+    
+    ChatMessage message;
+    message.id = 0;
+    message.sessionId = pending.sessionId;
+    message.senderId = pending.senderId;
+    message.senderName = m_currentUser.realName.isEmpty() ? m_currentUser.username : m_currentUser.realName;
+    message.senderRole = m_currentUser.role;
+    message.content = pending.content;
+    message.timestamp = pending.createdAt;
+    message.messageType = pending.messageType;
+    message.isRead = 1;
+    
+    QLabel* statusLabel = nullptr;
+    QWidget* messageBubble = createMessageBubble(message, &statusLabel);
+    m_pendingStatusLabels.insert(pending.clientMsgId, statusLabel);
+    
+    // 最终失败时状态后附"重新发送"链接
+    const QString clientMsgId = pending.clientMsgId;
+    connect(statusLabel, &QLabel::linkActivated, this, [this, clientMsgId]() {
+        QPointer<QLabel> label = m_pendingStatusLabels.value(clientMsgId);
+        if (!label) return;
+        label->setText(MessageOutbox::instance()->resend(clientMsgId) ? "发送中..." : "发送失败");
+    });
+    if (pending.failed) {
+        onOutboxMessageFailed(clientMsgId);
+    } else {
+        statusLabel->setText(pending.attempts > 0
+                             ? QString("发送失败，正在重试（第 %1 次）").arg(pending.attempts)
+                             : QString("发送中..."));
+    }
+    
+    QLayoutItem* stretch = m_messageLayout->takeAt(m_messageLayout->count() - 1);
+    m_messageLayout->addWidget(messageBubble);
+    m_messageLayout->addItem(stretch);
+    
+    QTimer::singleShot(50, this, &RealChatWidget::scrollToBottom);
+}
+
+void RealChatWidget::showPendingMessages(int sessionId)
+{
+    for (const OutboxMessage& pending : MessageOutbox::instance()->pendingMessages(sessionId)) {
+        if (pending.senderId == m_currentUser.id) {
+            addPendingMessage(pending);
+        }
+    }
+}
+
+void RealChatWidget::onOutboxMessageSent(const QString& clientMsgId, int messageId)
+{
+    QPointer<QLabel> statusLabel = m_pendingStatusLabels.take(clientMsgId);
+    if (!statusLabel) return;
+    
+    // 气泡已经显示，之后从数据库读到同一条消息时跳过
+    m_displayedMessageIds.insert(messageId);
+    statusLabel->setText("已发送");
+}
+
+void RealChatWidget::onOutboxMessageRetrying(const QString& clientMsgId, int attempts, qint64 retryInMs)
+{
+    QPointer<QLabel> statusLabel = m_pendingStatusLabels.value(clientMsgId);
+    if (!statusLabel) return;
+    
+    statusLabel->setText(QString("发送失败，%1 秒后重试（第 %2 次）")
+                         .arg(qMax<qint64>(1, (retryInMs + 999) / 1000))
+                         .arg(attempts));
+}
+
+void RealChatWidget::onOutboxMessageFailed(const QString& clientMsgId)
+{
+    QPointer<QLabel> statusLabel = m_pendingStatusLabels.value(clientMsgId);
+    if (!statusLabel) return;
+    
+    // 消息仍在发件箱中时保留状态标签，重发成功后继续更新
+    statusLabel->setText("发送失败 <a href=\"resend\" style=\"color: inherit;\">重新发送</a>");
+}
+
+QWidget* RealChatWidget::createMessageBubble(const ChatMessage& message, QLabel** statusLabel)
 {
     QWidget* bubble = new QWidget;
     bubble->setStyleSheet(R"(
@@ -350,6 +467,13 @@ QWidget* RealChatWidget::createMessageBubble(const ChatMessage& message)
         contentLabel->setStyleSheet("color: white; font-size: 14px;");
         headerLabel->setStyleSheet("font-size: 11px; color: rgba(255,255,255,0.8);");
         
+        if (statusLabel) {
+            *statusLabel = new QLabel;
+            (*statusLabel)->setAlignment(Qt::AlignRight);
+            (*statusLabel)->setStyleSheet("font-size: 10px; color: rgba(255,255,255,0.7);");
+            frameLayout->addWidget(*statusLabel);
+        }
+        
     } else if (message.messageType == 1) {
         // 系统消息 - 居中，灰色
         layout->addStretch();
@@ -396,8 +520,16 @@ void RealChatWidget::updateConnectionStatus()
         return;
     }
     
-    ChatSession session = m_dbManager->getChatSession(m_currentSessionId);
-    
+    int sessionId = m_currentSessionId;
+    m_asyncDb->getChatSession(sessionId, this, [this, sessionId](const ChatSession& session) {
+        if (sessionId == m_currentSessionId) {
+            showSessionStatus(session);
+        }
+    });
+}
+
+void RealChatWidget::showSessionStatus(const ChatSession& session)
+{
     switch (session.status) {
         case 0:
             m_statusLabel->setText(" 客服聊天 - 会话已结束");
@@ -423,9 +555,9 @@ void RealChatWidget::loadChatHistory()
     if (m_currentUser.id <= 0) return;
     
     // 获取用户的最近会话
-    QList<ChatSession> sessions = m_dbManager->getvisitorSessions(m_currentUser.id);
-    
-    if (!sessions.isEmpty()) {
+    m_asyncDb->getvisitorSessions(m_currentUser.id, this, [this](const QList<ChatSession>& sessions) {
+        if (sessions.isEmpty()) return;
+        
         ChatSession lastSession = sessions.first();
         if (lastSession.status > 0) {
             // 如果有进行中的会话，自动加载
@@ -435,14 +567,25 @@ void RealChatWidget::loadChatHistory()
             m_mainLayout->itemAt(m_mainLayout->count() - 1)->widget()->setVisible(true);
             
             // 加载消息历史
-            QList<ChatMessage> messages = m_dbManager->getChatMessages(m_currentSessionId);
-            for (const ChatMessage& message : messages) {
-                addMessage(message);
-            }
+            int sessionId = m_currentSessionId;
+            m_asyncDb->getChatMessages(sessionId, 50, this, [this, sessionId](const QList<ChatMessage>& messages) {
+                if (sessionId != m_currentSessionId) return;
+                for (const ChatMessage& message : messages) {
+                    addMessage(message);
+                }
+                if (!messages.isEmpty()) {
+                    m_asyncDb->markReadUpTo(sessionId, m_currentUser.id, messages.last().id);
+                }
+                showPendingMessages(sessionId);
+                
+                // 从最新一页的最后一条开始增量同步，并补上加载期间到达的消息
+                m_syncCursor = messages.isEmpty() ? 0 : messages.last().id;
+                checkForNewMessages();
+            });
             
             updateConnectionStatus();
         }
-    }
+    });
 }
 
 QString RealChatWidget::formatTime(const QDateTime& time)
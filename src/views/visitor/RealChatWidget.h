@@ -13,8 +13,14 @@
 #include <QListWidget>
 #include <QListWidgetItem>
 #include <QDateTime>
+#include <QSet>
+#include <QHash>
+#include <QPointer>
 #include "../../core/DatabaseManager.h"
 
+class AsyncDatabaseManager;
+struct OutboxMessage;
+
 class RealChatWidget : public QWidget
 {
     Q_OBJECT
@@ -36,6 +42,9 @@ private slots:
     void onSessionCreated(const ChatSession& session);
     void onSessionUpdated(const ChatSession& session);
     void checkForNewMessages();
+    void onOutboxMessageSent(const QString& clientMsgId, int messageId);
+    void onOutboxMessageRetrying(const QString& clientMsgId, int attempts, qint64 retryInMs);
+    void onOutboxMessageFailed(const QString& clientMsgId);
     void onUserInput();
 
 private:
@@ -43,11 +52,16 @@ private:
     void setupMessageArea();
     void setupInputArea();
     void addMessage(const ChatMessage& message);
+    // 发件箱中尚未写入数据库的消息，带发送状态
+    void addPendingMessage(const OutboxMessage& message);
+    void showPendingMessages(int sessionId);
     void scrollToBottom();
     void updateConnectionStatus();
+    void showSessionStatus(const ChatSession& session);
+    void onChatSessionStarted(int sessionId);
     void loadChatHistory();
     QString formatTime(const QDateTime& time);
-    QWidget* createMessageBubble(const ChatMessage& message);
+    QWidget* createMessageBubble(const ChatMessage& message, QLabel** statusLabel = nullptr);
 
     // UI 组件
     QVBoxLayout* m_mainLayout;
@@ -63,8 +77,11 @@ private:
     UserInfo m_currentUser;
     int m_currentSessionId;
     DatabaseManager* m_dbManager;
-    QTimer* m_messageCheckTimer;
+    AsyncDatabaseManager* m_asyncDb;
     QTimer* m_typingTimer;
+    QSet<int> m_displayedMessageIds;
+    QHash<QString, QPointer<QLabel>> m_pendingStatusLabels; // clientMsgId -> 发送状态
+    int m_syncCursor; // 当前会话已同步到的最大消息 ID，-1 表示尚未加载
     
     // 状态
     bool m_isConnected;